@@ -0,0 +1,280 @@
+/**
+ * @file ansi.c
+ * @brief Minimal-byte ANSI terminal output
+ */
+
+#include "ansi.h"
+
+#include <string.h>
+#include <unistd.h>
+
+/// Screen the graphics functions draw into instead of ncurses, if any
+static AnsiScreen_t *attached = NULL;
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Makes the graphics functions draw into an ANSI screen
+ * @param[in] *screen ANSI screen, NULL to draw with ncurses
+ */
+void ansi_attach(AnsiScreen_t *screen) { attached = screen; }
+
+/**
+ * @ingroup ansi_funcs
+ * @brief ANSI screen the graphics functions draw into
+ * @return Returns the screen, NULL when drawing with ncurses
+ */
+AnsiScreen_t *ansi_screen() { return attached; }
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Sends bytes to the terminal, retrying short writes
+ * @param[in] *screen ANSI screen
+ * @param[in] *data Bytes
+ * @param[in] len Number of bytes
+ * @return Returns 0 on success, 1 on a write error
+ */
+static int ansi_write(AnsiScreen_t *screen, const char *data, int len) {
+  while (len > 0) {
+    ssize_t n = write(screen->fd, data, len);
+    screen->writes++;
+    if (n <= 0) return 1;
+    screen->bytes += n;
+    data += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Switches the terminal to the game mode and clears it
+ * @param[in] *screen ANSI screen
+ * @param[in] fd Output file descriptor, the terminal is read from stdin
+ * @return Returns 0 on success, 1 if stdin is not a terminal
+ */
+int ansi_init(AnsiScreen_t *screen, int fd) {
+  memset(screen, 0, sizeof(AnsiScreen_t));
+  memset(screen->cells, ' ', sizeof(screen->cells));
+  memset(screen->shown, ' ', sizeof(screen->shown));
+  screen->fd = fd;
+  screen->cur_y = -1;
+  if (tcgetattr(STDIN_FILENO, &screen->saved) != 0) return 1;
+  struct termios mode = screen->saved;
+  mode.c_lflag &= ~(ICANON | ECHO);
+  mode.c_iflag &= ~ICRNL;
+  mode.c_oflag &= ~OPOST;
+  mode.c_cc[VMIN] = 1;
+  mode.c_cc[VTIME] = 0;
+  if (tcsetattr(STDIN_FILENO, TCSANOW, &mode) != 0) return 1;
+  const char *start = "\033[?1049h\033[?25l\033[H\033[2J";
+  return ansi_write(screen, start, strlen(start));
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Restores the terminal
+ * @param[in] *screen ANSI screen
+ */
+void ansi_end(AnsiScreen_t *screen) {
+  const char *end = "\033[?25h\033[?1049l";
+  ansi_write(screen, end, strlen(end));
+  tcsetattr(STDIN_FILENO, TCSANOW, &screen->saved);
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Draws text into the grid, like mvprintw() does
+ * @param[in] *screen ANSI screen
+ * @param[in] y Row
+ * @param[in] x Column
+ * @param[in] *text Text
+ */
+void ansi_put(AnsiScreen_t *screen, int y, int x, const char *text) {
+  if (y < 0 || y >= ANSI_ROWS) return;
+  for (; *text != '\0' && x < ANSI_COLS; text++, x++) {
+    if (x >= 0) screen->cells[y][x] = *text;
+  }
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Draws a piece of horizontal line into the grid
+ * @param[in] *screen ANSI screen
+ * @param[in] y Row
+ * @param[in] x Column
+ */
+void ansi_put_hline(AnsiScreen_t *screen, int y, int x) {
+  if (y >= 0 && y < ANSI_ROWS && x >= 0 && x < ANSI_COLS)
+    screen->cells[y][x] = ANSI_HLINE;
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Clears the grid, like clear() does
+ * @param[in] *screen ANSI screen
+ */
+void ansi_clear(AnsiScreen_t *screen) {
+  memset(screen->cells, ' ', sizeof(screen->cells));
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Formats a relative or absolute cursor move, whichever is shorter
+ *
+ * The terminal runs without output processing, so '\n' moves straight down
+ * and keeps the column.
+ * @param[in] *screen ANSI screen
+ * @param[in] y Target row
+ * @param[in] x Target column
+ * @param[out] *buf Escape sequence
+ * @return Returns the length of the sequence
+ */
+static int ansi_move(const AnsiScreen_t *screen, int y, int x, char *buf) {
+  int best = x == 0 ? sprintf(buf, "\033[%dH", y + 1)
+                    : sprintf(buf, "\033[%d;%dH", y + 1, x + 1);
+  if (screen->cur_y < 0) return best;
+  char rel[32];
+  int len = 0;
+  int dy = y - screen->cur_y;
+  if (dy > 0 && dy <= 3) {
+    for (int i = 0; i < dy; i++) rel[len++] = '\n';
+  } else if (dy != 0) {
+    len += sprintf(rel + len, "\033[%d%c", dy > 0 ? dy : -dy,
+                   dy > 0 ? 'B' : 'A');
+  }
+  int dx = x - screen->cur_x;
+  if (dx > 0) {
+    len += dx == 1 ? sprintf(rel + len, "\033[C")
+                   : sprintf(rel + len, "\033[%dC", dx);
+  } else if (dx < 0) {
+    char back[16], home[16];
+    int back_len = dx == -1 ? sprintf(back, "\033[D")
+                            : sprintf(back, "\033[%dD", -dx);
+    int home_len = x == 0   ? sprintf(home, "\r")
+                   : x == 1 ? sprintf(home, "\r\033[C")
+                            : sprintf(home, "\r\033[%dC", x);
+    if (home_len < back_len) {
+      memcpy(rel + len, home, home_len);
+      len += home_len;
+    } else {
+      memcpy(rel + len, back, back_len);
+      len += back_len;
+    }
+  }
+  if (len < best) {
+    memcpy(buf, rel, len);
+    best = len;
+  }
+  return best;
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Appends one grid cell to the frame
+ * @param[in] *screen ANSI screen
+ * @param[in] y Row
+ * @param[in] x Column
+ */
+static void ansi_emit_cell(AnsiScreen_t *screen, int y, int x) {
+  char c = screen->cells[y][x];
+  if (c == ANSI_HLINE) {
+    memcpy(screen->out + screen->len, "\xe2\x94\x80", 3);
+    screen->len += 3;
+  } else {
+    screen->out[screen->len++] = c;
+  }
+  screen->shown[y][x] = c;
+  screen->cur_x = x + 1;
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Moves the cursor to a cell
+ *
+ * When the target is a little to the right on the same row, reprinting the
+ * unchanged cells in between is cheaper than any escape sequence.
+ * @param[in] *screen ANSI screen
+ * @param[in] y Row
+ * @param[in] x Column
+ */
+static void ansi_goto(AnsiScreen_t *screen, int y, int x) {
+  if (screen->cur_y == y && screen->cur_x == x) return;
+  char move[32];
+  int move_len = ansi_move(screen, y, x, move);
+  if (screen->cur_y == y && screen->cur_x < x) {
+    int gap = 0;
+    for (int i = screen->cur_x; i < x; i++)
+      gap += screen->cells[y][i] == ANSI_HLINE ? 3 : 1;
+    if (gap <= move_len) {
+      for (int i = screen->cur_x; i < x; i++) ansi_emit_cell(screen, y, i);
+      return;
+    }
+  }
+  memcpy(screen->out + screen->len, move, move_len);
+  screen->len += move_len;
+  screen->cur_y = y;
+  screen->cur_x = x;
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Sends the changes since the previous frame in one write()
+ *
+ * A row whose end became blank is cut with an erase-to-end-of-line instead
+ * of being overwritten with spaces.
+ * @param[in] *screen ANSI screen
+ * @return Returns 0 on success, 1 on a write error
+ */
+int ansi_flush(AnsiScreen_t *screen) {
+  screen->len = 0;
+  for (int y = 0; y < ANSI_ROWS; y++) {
+    int tail = ANSI_COLS;
+    while (tail > 0 && screen->cells[y][tail - 1] == ' ') tail--;
+    int erase_at = -1;
+    int erased = 0;
+    for (int x = tail; x < ANSI_COLS; x++) {
+      if (screen->shown[y][x] != ' ') {
+        if (erase_at < 0) erase_at = x;
+        erased++;
+      }
+    }
+    int limit = erased >= 2 ? erase_at : ANSI_COLS;
+    for (int x = 0; x < limit; x++) {
+      if (screen->cells[y][x] == screen->shown[y][x]) continue;
+      ansi_goto(screen, y, x);
+      ansi_emit_cell(screen, y, x);
+    }
+    if (erased >= 2) {
+      ansi_goto(screen, y, erase_at);
+      memcpy(screen->out + screen->len, "\033[K", 3);
+      screen->len += 3;
+      memset(&screen->shown[y][erase_at], ' ', ANSI_COLS - erase_at);
+    }
+  }
+  if (screen->len == 0) return 0;
+  screen->frames++;
+  return ansi_write(screen, screen->out, screen->len);
+}
+
+/**
+ * @ingroup ansi_funcs
+ * @brief Bytes and write() calls of the whole process so far
+ *
+ * Read from /proc/self/io, so both the ncurses and the ANSI output can be
+ * measured the same way.
+ * @param[out] *bytes Bytes written
+ * @param[out] *writes write() calls made
+ * @return Returns 0 on success, 1 if the counters are not available
+ */
+int output_counters(long *bytes, long *writes) {
+  FILE *fp = fopen("/proc/self/io", "r");
+  if (fp == NULL) return 1;
+  char line[64];
+  int found = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(line, "wchar: %ld", bytes) == 1) found++;
+    if (sscanf(line, "syscw: %ld", writes) == 1) found++;
+  }
+  fclose(fp);
+  return found == 2 ? 0 : 1;
+}
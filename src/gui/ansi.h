@@ -0,0 +1,65 @@
+/**
+ * @file ansi.h
+ * @brief Minimal-byte ANSI terminal output
+ *
+ * An alternative to ncurses for slow links. The frame is drawn into a
+ * character grid, compared with what the terminal already shows and only
+ * the changed spans are sent, with the shortest cursor moves, in a single
+ * write() per frame.
+ */
+
+#ifndef ANSI_H
+#define ANSI_H
+#include <termios.h>
+
+#include "../tetris/tetris.h"
+
+/// Rows of the character grid
+#define ANSI_ROWS 24
+/// Columns of the character grid
+#define ANSI_COLS 128
+/// Grid cell holding a horizontal line
+#define ANSI_HLINE '\001'
+
+/**
+ * @brief Terminal drawn with ANSI escape sequences
+ */
+typedef struct {
+  /// @brief Frame being drawn
+  char cells[ANSI_ROWS][ANSI_COLS];
+  /// @brief What the terminal shows
+  char shown[ANSI_ROWS][ANSI_COLS];
+  /// @brief Bytes of the frame being sent
+  char out[ANSI_ROWS * ANSI_COLS * 16];
+  /// @brief Number of bytes in out
+  int len;
+  /// @brief Cursor row on the terminal, -1 if unknown
+  int cur_y;
+  /// @brief Cursor column on the terminal
+  int cur_x;
+  /// @brief Output file descriptor
+  int fd;
+  /// @brief Terminal settings to restore
+  struct termios saved;
+  /// @brief Frames sent
+  long frames;
+  /// @brief Bytes sent
+  long bytes;
+  /// @brief write() calls made
+  long writes;
+} AnsiScreen_t;
+
+/**
+ * @defgroup ansi_funcs ANSI output
+ */
+int ansi_init(AnsiScreen_t *screen, int fd);
+void ansi_end(AnsiScreen_t *screen);
+void ansi_attach(AnsiScreen_t *screen);
+AnsiScreen_t *ansi_screen();
+void ansi_put(AnsiScreen_t *screen, int y, int x, const char *text);
+void ansi_put_hline(AnsiScreen_t *screen, int y, int x);
+void ansi_clear(AnsiScreen_t *screen);
+int ansi_flush(AnsiScreen_t *screen);
+int output_counters(long *bytes, long *writes);
+
+#endif /* ANSI_H */
@@ -4,7 +4,86 @@
  * @author nataliak
  */
 
+#include <stdarg.h>
+
 #include "../tetris/tetris.h"
+#include "ansi.h"
+
+/// Column the board being drawn starts at
+static int draw_offset = 0;
+/// Hinted placement drawn with the current tetromino, NULL for none
+static const tetromino *hint = NULL;
+/// Position of the hinted placement at X
+static int hint_x = 0;
+/// Position of the hinted placement at Y
+static int hint_y = 0;
+
+/**
+ * @ingroup graphics_funcs
+ * @brief Moves all further drawing to the right, so that a second board can
+ * be drawn next to the first one
+ * @param[in] x Column the board starts at
+ */
+void set_draw_offset(int x) { draw_offset = x; }
+
+/**
+ * @ingroup graphics_funcs
+ * @brief Sets the placement print_tetromino() outlines as a hint
+ * @param[in] *tet Tetromino in the hinted rotation, NULL for no hint
+ * @param[in] x Position of the placement at X
+ * @param[in] y Position of the placement at Y
+ */
+void set_hint(const tetromino *tet, int x, int y) {
+  hint = tet;
+  hint_x = x;
+  hint_y = y;
+}
+
+/**
+ * @ingroup graphics_funcs
+ * @brief Text output, through ncurses or into the attached ANSI screen
+ * @param[in] y Row
+ * @param[in] x Column
+ * @param[in] *format printf() format
+ */
+static void draw_text(int y, int x, const char *format, ...) {
+  char text[64];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  AnsiScreen_t *ansi = ansi_screen();
+  if (ansi != NULL)
+    ansi_put(ansi, y, x + draw_offset, text);
+  else
+    mvaddstr(y, x + draw_offset, text);
+}
+
+/**
+ * @ingroup graphics_funcs
+ * @brief Piece of the horizontal border
+ * @param[in] y Row
+ * @param[in] x Column
+ */
+static void draw_hline(int y, int x) {
+  AnsiScreen_t *ansi = ansi_screen();
+  if (ansi != NULL)
+    ansi_put_hline(ansi, y, x + draw_offset);
+  else
+    mvaddch(y, x + draw_offset, ACS_HLINE);
+}
+
+/**
+ * @ingroup graphics_funcs
+ * @brief Whole screen clearing
+ */
+void clear_screen() {
+  AnsiScreen_t *ansi = ansi_screen();
+  if (ansi != NULL)
+    ansi_clear(ansi);
+  else
+    clear();
+}
 
 /**
  * @ingroup graphics_funcs
@@ -12,33 +91,34 @@
  * statistics
  */
 void print_game() {
+  TRACE_SCOPE("print_game");
   GameInfo_t *stats = updateCurrentState();
   clear_info();
-  mvprintw(1, 25, "NEXT:");
-  mvprintw(8, 25, "SCORE:");
-  mvprintw(10, 25, "BEST:");
-  mvprintw(12, 25, "LEVEL:");
-  mvprintw(14, 25, "SPEED:");
+  draw_text(1, 25, "NEXT:");
+  draw_text(8, 25, "SCORE:");
+  draw_text(10, 25, "BEST:");
+  draw_text(12, 25, "LEVEL:");
+  draw_text(14, 25, "SPEED:");
 
   clear_field();
   print_tetromino();
   print_field();
 
-  mvprintw(8, 32, "%d", stats->score);
-  mvprintw(10, 31, "%d", stats->high_score);
-  mvprintw(12, 32, "%d", stats->level);
-  mvprintw(14, 32, "%d", stats->speed);
+  draw_text(8, 32, "%d", stats->score);
+  draw_text(10, 31, "%d", stats->high_score);
+  draw_text(12, 32, "%d", stats->level);
+  draw_text(14, 32, "%d", stats->speed);
   for (int i = 0; i < 4; i++) {
     for (int j = 0; j < 4; j++) {
-      mvprintw(j + 3, i * 2 + 26, "  ");
+      draw_text(j + 3, i * 2 + 26, "  ");
       if (stats->next_tetromino.tet[i][j] == 1) {
-        mvprintw(j + 3, i * 2 + 26, "[]");
+        draw_text(j + 3, i * 2 + 26, "[]");
       }
     }
   }
   for (int i = 1; i <= 20; i++) {
-    mvaddch(21, i, ACS_HLINE);
-    mvaddch(0, i, ACS_HLINE);
+    draw_hline(21, i);
+    draw_hline(0, i);
   }
 }
 
@@ -49,7 +129,7 @@ void print_game() {
 void clear_info() {
   for (int i = 11; i < 25; i++) {
     for (int j = 1; j < 21; j++) {
-      mvprintw(j, i * 2 + 1, "  ");
+      draw_text(j, i * 2 + 1, "  ");
     }
   }
 }
@@ -61,7 +141,7 @@ void clear_info() {
 void clear_field() {
   for (int i = 0; i < 10; i++) {
     for (int j = 1; j < 21; j++) {
-      mvprintw(j, i * 2 + 1, "  ");
+      draw_text(j, i * 2 + 1, "  ");
     }
   }
 }
@@ -75,7 +155,7 @@ void print_field() {
   for (int i = 0; i < 10; i++) {
     for (int j = 0; j < 20; j++) {
       if (stats->field[i][j] == 1) {
-        mvprintw(j + 1, i * 2 + 1, "[]");
+        draw_text(j + 1, i * 2 + 1, "[]");
       }
     }
   }
@@ -83,19 +163,37 @@ void print_field() {
 
 /**
  * @ingroup graphics_funcs
- * @brief Rendering of the current tetromino
+ * @brief Rendering of the current tetromino and the outline of the hint
  */
 void print_tetromino() {
   GameInfo_t *stats = updateCurrentState();
+  for (int i = 0; i < 4 && hint != NULL; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (hint->tet[i][j] == 1)
+        draw_text(hint_y + j, (hint_x + i) * 2 + 1, "::");
+    }
+  }
   for (int i = 0; i < 4; i++) {
     for (int j = 0; j < 4; j++) {
       if (stats->current_tetromino.tet[i][j] == 1) {
-        mvprintw((stats->cur_y + j), (stats->cur_x + i) * 2 + 1, "[]");
+        draw_text((stats->cur_y + j), (stats->cur_x + i) * 2 + 1, "[]");
       }
     }
   }
 }
 
+/**
+ * @ingroup graphics_funcs
+ * @brief Rendering of the garbage pending against the board in versus mode
+ * @param[in] rows Pending garbage rows
+ */
+void print_garbage(int rows) {
+  draw_text(16, 25, "GARBAGE:");
+  draw_text(16, 34, "%-3d", rows);
+  for (int j = 0; j < 20; j++)
+    draw_text(20 - j, 21, j < rows ? "|" : " ");
+}
+
 /**
  * @ingroup graphics_funcs
  * @brief Rendering a game over banner
@@ -103,12 +201,12 @@ void print_tetromino() {
 void print_banner() {
   GameInfo_t *stats = updateCurrentState();
   clear_field();
-  mvprintw(6, 6, "GAME OVER");
-  mvprintw(8, 6, "SCORE: %d", stats->score);
-  mvprintw(10, 5, "PRESS ENTER");
-  mvprintw(11, 5, "TO TRY AGAIN");
-  mvprintw(13, 6, "PRESS 'Q'");
-  mvprintw(14, 7, "TO QUIT");
+  draw_text(6, 6, "GAME OVER");
+  draw_text(8, 6, "SCORE: %d", stats->score);
+  draw_text(10, 5, "PRESS ENTER");
+  draw_text(11, 5, "TO TRY AGAIN");
+  draw_text(13, 6, "PRESS 'Q'");
+  draw_text(14, 7, "TO QUIT");
 }
 
 /**
@@ -116,15 +214,16 @@ void print_banner() {
  * @brief Rendering start banner
  */
 void print_start_banner() {
-  mvprintw(10, 5, "PRESS ENTER");
-  mvprintw(6, 25, "CONTROLS");
-  mvprintw(8, 25, "ENTER - START");
-  mvprintw(9, 25, "SPACE - ACTION");
-  mvprintw(10, 25, "ARROW DOWN - SHIFT DOWN");
-  mvprintw(11, 25, "ARROW LEFT - SHIFT LEFT");
-  mvprintw(12, 25, "ARROW RIGHT - SHIFT RIGHT");
-  mvprintw(13, 25, "'P' - PAUSE");
-  mvprintw(14, 25, "'Q' - QUIT");
+  draw_text(10, 5, "PRESS ENTER");
+  draw_text(6, 25, "CONTROLS");
+  draw_text(8, 25, "ENTER - START");
+  draw_text(9, 25, "SPACE - ACTION");
+  draw_text(10, 25, "ARROW DOWN - SHIFT DOWN");
+  draw_text(11, 25, "ARROW LEFT - SHIFT LEFT");
+  draw_text(12, 25, "ARROW RIGHT - SHIFT RIGHT");
+  draw_text(13, 25, "'P' - PAUSE");
+  draw_text(14, 25, "'Q' - QUIT");
+  draw_text(15, 25, "'R' - REWIND");
 }
 
 /**
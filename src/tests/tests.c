@@ -1,7 +1,24 @@
 #include <check.h>
+#include <stddef.h>
 #include <stdio.h>
 
+#include "../tetris/batch.h"
+#include "../tetris/bot.h"
+#include "../tetris/dataset.h"
+#include "../tetris/difftest.h"
+#include "../tetris/frame.h"
+#include "../tetris/hint.h"
+#include "../tetris/input.h"
+#include "../tetris/journal.h"
+#include "../tetris/packed.h"
+#include "../tetris/plugin.h"
+#include "../tetris/rewind.h"
+#include "../tetris/save.h"
+#include "../tetris/sim.h"
+#include "../tetris/soak.h"
+#include "../tetris/telemetry.h"
 #include "../tetris/tetris.h"
+#include "../tetris/versus.h"
 
 START_TEST(start_test_1) {
   FSM_STATES_g state = START;
@@ -158,6 +175,70 @@ START_TEST(pause_test) {
 }
 END_TEST
 
+START_TEST(fsm_stats_test) {
+  GameInfo_t game = {0};
+  FsmStats_t fsm;
+  FSM_STATES_g state = MOVING;
+  bind_game_state(&game);
+  fsm_stats_reset(0);
+  userInput(&state, Up);
+  userInput(&state, 0);
+  userInput(&state, Pause);
+  userInput(&state, Pause);
+  ck_assert_int_eq(state, MOVING);
+  state = START;
+  userInput(&state, Left);
+  ck_assert_int_eq(state, START);
+  fsm_stats(&fsm);
+  ck_assert_int_eq(fsm.dispatches, 5);
+  ck_assert_int_eq(fsm.unexpected[MOVING], 1);
+  ck_assert_int_eq(fsm.unexpected[START], 1);
+  ck_assert_int_eq(fsm.entries[PAUSE], 1);
+  ck_assert_int_eq(fsm.entries[MOVING], 1);
+  ck_assert_int_eq(fsm.time_ns[PAUSE], 0);
+
+  fsm_stats_reset(1);
+  state = MOVING;
+  userInput(&state, Pause);
+  userInput(&state, Pause);
+  fsm_stats(&fsm);
+  ck_assert_int_gt(fsm.time_ns[PAUSE], 0);
+  ck_assert_int_eq(fsm.unexpected[START], 0);
+  fsm_stats_reset(0);
+  bind_game_state(NULL);
+}
+END_TEST
+
+START_TEST(rotate_kick_test) {
+  GameInfo_t game = {0};
+  FSM_STATES_g state = MOVING;
+  bind_game_state(&game);
+  game.current_tetromino = piece_tetromino(6, 1);
+  game.cur_x = -1;
+  game.cur_y = 5;
+  userInput(&state, Action);
+  ck_assert_int_eq(piece_rotation(&game.current_tetromino), 2);
+  ck_assert_int_eq(game.cur_x, 0);
+  ck_assert_int_eq(game.cur_y, 5);
+
+  game.current_tetromino = piece_tetromino(6, 0);
+  game.cur_x = 4;
+  game.cur_y = 19;
+  userInput(&state, Action);
+  ck_assert_int_eq(piece_rotation(&game.current_tetromino), 1);
+  ck_assert_int_eq(game.cur_x, 3);
+  ck_assert_int_eq(game.cur_y, 18);
+
+  uint16_t rows[BOARD_HEIGHT];
+  for (int r = 0; r < BOARD_HEIGHT; r++) rows[r] = BOARD_FULL_ROW;
+  rows[10] = BOARD_EMPTY_ROW;
+  ck_assert_int_eq(board_kick(rows, PIECE_I, 1, 3, 9), -1);
+  ck_assert_int_eq(board_kick(rows, PIECE_I, 0, 4, 7), 3);
+  ck_assert_int_eq(state, MOVING);
+  bind_game_state(NULL);
+}
+END_TEST
+
 START_TEST(get_signal_test) {
   UserAction_t result = 0;
   result = get_signal(0403);
@@ -172,6 +253,8 @@ START_TEST(get_signal_test) {
   ck_assert_int_eq(result, Terminate);
   result = get_signal('p');
   ck_assert_int_eq(result, Pause);
+  result = get_signal('r');
+  ck_assert_int_eq(result, Rewind);
   result = get_signal('\n');
   ck_assert_int_eq(result, Start);
   result = get_signal(' ');
@@ -366,6 +449,1111 @@ START_TEST(check_collision_r_test) {
 }
 END_TEST
 
+START_TEST(input_queue_test) {
+  InputQueue_t queue;
+  InputEvent_t event;
+  input_init(&queue);
+  input_push(&queue, Action, 0);
+  input_push(&queue, Left, 5);
+  input_push(&queue, Pause, 20);
+  ck_assert_int_eq(input_next(&queue, 10, &event), 1);
+  ck_assert_int_eq(event.sig, Action);
+  ck_assert_int_eq(event.time, 0);
+  ck_assert_int_eq(input_next(&queue, 10, &event), 1);
+  ck_assert_int_eq(event.sig, Left);
+  ck_assert_int_eq(event.time, 5);
+  ck_assert_int_eq(input_next(&queue, 10, &event), 0);
+  ck_assert_int_eq(input_next(&queue, 20, &event), 1);
+  ck_assert_int_eq(event.sig, Pause);
+  for (int i = 0; i < INPUT_QUEUE_SIZE; i++) input_push(&queue, Up, 30);
+  ck_assert_int_eq(input_push(&queue, Up, 30), 1);
+}
+END_TEST
+
+START_TEST(input_das_test) {
+  InputQueue_t queue;
+  InputEvent_t event;
+  input_init(&queue);
+  input_push(&queue, Right, 0);
+  for (int t = 300; t <= 600; t += 30) input_push(&queue, Right, t);
+  ck_assert_int_eq(input_next(&queue, 600, &event), 1);
+  ck_assert_int_eq(event.sig, Right);
+  ck_assert_int_eq(event.time, 0);
+  long expected = 300;
+  while (input_next(&queue, 600, &event)) {
+    ck_assert_int_eq(event.sig, Right);
+    ck_assert_int_eq(event.time, expected);
+    expected += ARR_MS;
+  }
+  ck_assert_int_eq(expected, 300 + 7 * ARR_MS);
+  ck_assert_int_eq(queue.delay, 300);
+  ck_assert_int_eq(queue.repeat_gap, 30);
+}
+END_TEST
+
+START_TEST(input_release_test) {
+  InputQueue_t queue;
+  InputEvent_t event;
+  input_init(&queue);
+  input_push(&queue, Left, 0);
+  ck_assert_int_eq(input_next(&queue, 500, &event), 1);
+  ck_assert_int_eq(input_next(&queue, 500, &event), 0);
+  ck_assert_int_eq(queue.held, Left);
+  ck_assert_int_eq(input_next(&queue, TYPEMATIC_MAX_MS + 1, &event), 0);
+  ck_assert_int_eq(queue.held, 0);
+  input_push(&queue, Left, 1000);
+  input_push(&queue, Left, 1100);
+  ck_assert_int_eq(input_next(&queue, 1100, &event), 1);
+  ck_assert_int_eq(input_next(&queue, 1100, &event), 1);
+  ck_assert_int_eq(event.sig, Left);
+  ck_assert_int_eq(event.time, 1100);
+  ck_assert_int_eq(input_next(&queue, 1800, &event), 0);
+  input_push(&queue, Down, 2000);
+  input_push(&queue, Down, 2300);
+  input_push(&queue, Down, 2330);
+  ck_assert_int_eq(input_next(&queue, 2330, &event), 1);
+  ck_assert_int_eq(event.sig, Down);
+  ck_assert_int_eq(input_next(&queue, 2330, &event), 1);
+  ck_assert_int_eq(event.sig, Down);
+  ck_assert_int_eq(event.time, 2300);
+  ck_assert_int_eq(input_next(&queue, 2330, &event), 0);
+  ck_assert_int_eq(input_next(&queue, 2500, &event), 1);
+  ck_assert_int_eq(event.time, 2300 + ARR_MS);
+  ck_assert_int_eq(input_next(&queue, 2500, &event), 0);
+  input_push(&queue, Right, 3000);
+  input_push(&queue, Right, 3200);
+  ck_assert_int_eq(input_next(&queue, 3200, &event), 1);
+  ck_assert_int_eq(input_next(&queue, 3200, &event), 1);
+  ck_assert_int_eq(event.sig, Right);
+  ck_assert_int_eq(event.time, 3200);
+}
+END_TEST
+
+START_TEST(step_ticks_test) {
+  FSM_STATES_g state = SPAWN;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  stats->next_tetromino = get_tetromino(2);
+  step_ticks(&state, 1);
+  ck_assert_int_eq(state, MOVING);
+  ck_assert_int_eq(stats->cur_y, 1);
+  step_ticks(&state, stats->speed / TICK_MS - 1);
+  ck_assert_int_eq(stats->cur_y, 1);
+  step_ticks(&state, 1);
+  ck_assert_int_eq(stats->cur_y, 2);
+  step_ticks(&state, 3 * stats->speed / TICK_MS);
+  ck_assert_int_eq(stats->cur_y, 5);
+  state = PAUSE;
+  step_ticks(&state, 1000);
+  ck_assert_int_eq(stats->cur_y, 5);
+}
+END_TEST
+
+START_TEST(step_ticks_attaching_test) {
+  FSM_STATES_g state = MOVING;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  stats->current_tetromino = get_tetromino(0);
+  stats->cur_x = 4;
+  stats->cur_y = 17;
+  move_down(&state);
+  ck_assert_int_eq(state, ATTACHING);
+  step_ticks(&state, 1);
+  ck_assert_int_eq(state, SPAWN);
+  ck_assert_int_eq(stats->delay_ticks, LOCK_DELAY_MS / TICK_MS - 1);
+  step_ticks(&state, LOCK_DELAY_MS / TICK_MS - 1);
+  ck_assert_int_eq(state, SPAWN);
+  step_ticks(&state, 1);
+  ck_assert_int_eq(state, MOVING);
+}
+END_TEST
+
+START_TEST(step_ticks_seed_test) {
+  GameInfo_t first = {0};
+  FSM_STATES_g state = SPAWN;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  stats_seed(stats, 42);
+  step_ticks(&state, 100000);
+  ck_assert_int_eq(state, GAME_OVER);
+  first = *stats;
+  state = SPAWN;
+  stats_init(stats);
+  stats_seed(stats, 42);
+  step_ticks(&state, 100000);
+  ck_assert_int_eq(state, GAME_OVER);
+  ck_assert_int_eq(stats->current_tetromino.type,
+                   first.current_tetromino.type);
+  ck_assert_int_eq(stats->next_tetromino.type, first.next_tetromino.type);
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 20; j++) {
+      ck_assert_int_eq(stats->field[i][j], first.field[i][j]);
+    }
+  }
+}
+END_TEST
+
+START_TEST(batch_reference_test) {
+  static DiffCase_t cases[3];
+  ck_assert_int_eq(diff_corpus(cases, 3), 3);
+  TetrisBatch_t *batch = batch_create(3, 1);
+  ck_assert_ptr_nonnull(batch);
+  GameInfo_t *stats = updateCurrentState();
+  for (int g = 0; g < batch->size; g++) {
+    FSM_STATES_g state = SPAWN;
+    stats_init(stats);
+    stats_seed(stats, cases[g].seed);
+    userInput(&state, 0);
+    batch_reset(batch, g, cases[g].seed);
+    UserAction_t actions[3] = {0};
+    int rewards[3] = {0}, dones[3] = {0};
+    for (int step = 0; step < cases[g].len && state != GAME_OVER; step++) {
+      actions[g] = cases[g].sigs[step];
+      int score = stats->score;
+      userInput(&state, actions[g]);
+      if (state == MOVING) move_down(&state);
+      if (state == ATTACHING) {
+        userInput(&state, 0);
+        userInput(&state, 0);
+      }
+      tetris_batch_step(batch, actions, rewards, dones);
+      ck_assert_int_eq(dones[g], state == GAME_OVER);
+      ck_assert_int_eq(rewards[g], stats->score - score);
+      if (state == GAME_OVER) break;
+      ck_assert_int_eq(batch->type[g], stats->current_tetromino.type);
+      ck_assert_int_eq(batch->rot[g],
+                       piece_rotation(&stats->current_tetromino));
+      ck_assert_int_eq(batch->next[g], stats->next_tetromino.type);
+      ck_assert_int_eq(batch->x[g], stats->cur_x);
+      ck_assert_int_eq(batch->y[g], stats->cur_y);
+      ck_assert_int_eq(batch->score[g], stats->score);
+      uint16_t rows[BOARD_HEIGHT];
+      board_from_field(stats, rows);
+      for (int r = 0; r < BOARD_HEIGHT; r++)
+        ck_assert_int_eq(batch->rows[r * batch->size + g], rows[r]);
+    }
+    ck_assert_int_eq(state, GAME_OVER);
+  }
+  batch_free(batch);
+}
+END_TEST
+
+START_TEST(batch_reset_test) {
+  TetrisBatch_t *batch = batch_create(64, 5);
+  ck_assert_ptr_nonnull(batch);
+  UserAction_t actions[64] = {0};
+  int rewards[64], dones[64];
+  int games = 0;
+  for (int step = 0; step < 2000; step++) {
+    tetris_batch_step(batch, actions, rewards, dones);
+    for (int g = 0; g < 64; g++) games += dones[g];
+  }
+  ck_assert_int_gt(games, 64);
+  for (int g = 0; g < 64; g++) {
+    ck_assert_int_eq(batch->rows[0 * 64 + g] & BOARD_EMPTY_ROW,
+                     BOARD_EMPTY_ROW);
+    ck_assert_int_le(batch->y[g], BOARD_HEIGHT);
+  }
+  batch_free(batch);
+}
+END_TEST
+
+START_TEST(sim_feed_test) {
+  static Sim_t whole, split;
+  static SimFrame_t frames[64], parts[64];
+  static DiffCase_t cases[2];
+  diff_corpus(cases, 2);
+  uint8_t in[40] = {SIM_NEW_GAME, cases[1].seed, 0, 0, 0, 0x7F};
+  for (int i = 6; i < 40; i++) in[i] = cases[1].sigs[i - 6];
+  size_t used, count = 0;
+  sim_init(&whole, 0);
+  sim_init(&split, 0);
+  ck_assert_int_eq(sim_feed(&whole, in, 40, frames, 64, &used), 35);
+  ck_assert_int_eq(used, 40);
+  for (size_t pos = 0; pos < 40; pos += used)
+    count += sim_feed(&split, in + pos, pos < 3 ? 1 : 40 - pos, parts + count,
+                      64 - count, &used);
+  ck_assert_int_eq(count, 35);
+  ck_assert_int_eq(memcmp(frames, parts, sizeof(SimFrame_t) * 35), 0);
+  ck_assert_int_eq(sim_feed(&whole, in + 6, 1, frames, 0, &used), 0);
+  ck_assert_int_eq(used, 0);
+
+  TetrisBatch_t *batch = batch_create(1, 1);
+  int reward, done;
+  batch_reset(batch, 0, cases[1].seed);
+  ck_assert_int_eq(frames[0].type, batch->type[0]);
+  ck_assert_int_eq(frames[0].state, MOVING);
+  for (int i = 1; i < 35; i++) {
+    UserAction_t sig = in[5 + i];
+    tetris_batch_step(batch, &sig, &reward, &done);
+    ck_assert_int_eq(frames[i].x, batch->x[0]);
+    ck_assert_int_eq(frames[i].y, batch->y[0]);
+    ck_assert_int_eq(frames[i].rot, batch->rot[0]);
+    for (int r = 0; r < BOARD_HEIGHT; r++)
+      ck_assert_int_eq(frames[i].rows[r],
+                       batch->rows[r] >> BOARD_SHIFT & 0x3FF);
+  }
+  batch_free(batch);
+
+  uint8_t restart[] = {SIM_NEW_GAME, 1, 0, 0, 0, Start};
+  whole.game.counters.clears[2] = 1;
+  ck_assert_int_eq(sim_feed(&whole, restart, 5, frames, 64, &used), 1);
+  ck_assert_int_eq(frames[0].lines, 0);
+  whole.game.counters.clears[2] = 1;
+  whole.state = GAME_OVER;
+  ck_assert_int_eq(sim_feed(&whole, restart + 5, 1, frames, 64, &used), 1);
+  ck_assert_int_eq(frames[0].lines, 0);
+  ck_assert_int_eq(frames[0].state, MOVING);
+}
+END_TEST
+
+/// Batch engine reporting the tetromino one cell off after the third Left
+typedef struct {
+  /// @brief Batch of one game
+  void *batch;
+  /// @brief Left signals seen
+  int lefts;
+} DiffFaulty_t;
+
+static void *diff_faulty_create(void) {
+  DiffFaulty_t *faulty = calloc(1, sizeof(DiffFaulty_t));
+  faulty->batch = diff_batch_engine.create();
+  return faulty;
+}
+
+static void diff_faulty_reset(void *engine, unsigned int seed,
+                              const DiffState_t *start, DiffState_t *out) {
+  DiffFaulty_t *faulty = engine;
+  faulty->lefts = 0;
+  diff_batch_engine.reset(faulty->batch, seed, start, out);
+}
+
+static void diff_faulty_step(void *engine, UserAction_t sig,
+                             DiffState_t *out) {
+  DiffFaulty_t *faulty = engine;
+  faulty->lefts += sig == Left;
+  diff_batch_engine.step(faulty->batch, sig, out);
+  if (faulty->lefts >= 3) out->x++;
+}
+
+static void diff_faulty_destroy(void *engine) {
+  DiffFaulty_t *faulty = engine;
+  diff_batch_engine.destroy(faulty->batch);
+  free(faulty);
+}
+
+static const DiffEngine_t diff_faulty_engine = {
+    "faulty", diff_faulty_create, diff_faulty_reset, diff_faulty_step,
+    diff_faulty_destroy};
+
+START_TEST(diff_corpus_test) {
+  static DiffCase_t cases[32];
+  DiffReport_t report;
+  int count = diff_corpus(cases, 32);
+  ck_assert_int_eq(count, 21);
+  ck_assert_int_eq(cases[7].placed, 1);
+  DiffState_t tetris;
+  void *packed = diff_packed_engine.create();
+  diff_packed_engine.reset(packed, cases[9].seed, &cases[9].start, &tetris);
+  diff_packed_engine.step(packed, cases[9].sigs[0], &tetris);
+  ck_assert_int_eq(tetris.score, 1500);
+  ck_assert_int_eq(tetris.level, 2);
+  diff_packed_engine.destroy(packed);
+  const DiffEngine_t *engines[] = {&diff_batch_engine, &diff_packed_engine};
+  for (int e = 0; e < 2; e++) {
+    void *engine = engines[e]->create();
+    ck_assert_ptr_nonnull(engine);
+    for (int c = 0; c < count; c++) {
+      ck_assert_int_eq(diff_run(engines[e], engine, &cases[c], &report), 0);
+      ck_assert_int_eq(report.step, -1);
+      ck_assert_int_gt(report.played, 0);
+    }
+    engines[e]->destroy(engine);
+  }
+}
+END_TEST
+
+START_TEST(diff_shrink_test) {
+  static DiffCase_t test;
+  DiffReport_t report;
+  diff_corpus(&test, 1);
+  void *faulty = diff_faulty_engine.create();
+  ck_assert_int_eq(diff_run(&diff_faulty_engine, faulty, &test, &report), 1);
+  ck_assert_str_eq(report.field, "x");
+  ck_assert_int_eq(report.actual, report.expected + 1);
+  ck_assert_int_eq(diff_shrink(&diff_faulty_engine, faulty, &test, &report),
+                   1);
+  ck_assert_int_eq(test.len, 3);
+  ck_assert_int_eq(report.step, 3);
+  for (int i = 0; i < test.len; i++) ck_assert_int_eq(test.sigs[i], Left);
+  diff_faulty_engine.destroy(faulty);
+}
+END_TEST
+
+START_TEST(input_decode_test) {
+  const char buf[] = "\033[D\033OC \r\033[Zq";
+  int len = sizeof(buf) - 1;
+  int keys[6] = {0};
+  int n = 0;
+  for (int pos = 0; pos < len; n++)
+    pos += input_decode(buf + pos, len - pos, &keys[n]);
+  ck_assert_int_eq(n, 6);
+  ck_assert_int_eq(get_signal(keys[0]), Left);
+  ck_assert_int_eq(get_signal(keys[1]), Right);
+  ck_assert_int_eq(get_signal(keys[2]), Action);
+  ck_assert_int_eq(get_signal(keys[3]), Start);
+  ck_assert_int_eq(keys[4], 0);
+  ck_assert_int_eq(get_signal(keys[5]), Terminate);
+  ck_assert_int_eq(input_decode("\033[", 2, &keys[0]), 0);
+
+  InputQueue_t queue;
+  InputEvent_t event;
+  input_init(&queue);
+  ck_assert_int_eq(input_feed(&queue, "p\033[", 3, 0), 1);
+  ck_assert_int_eq(input_feed(&queue, "Dq", 2, 5), 2);
+  ck_assert_int_eq(input_feed(&queue, "\033", 1, 10), 0);
+  ck_assert_int_eq(input_feed(&queue, "[C", 2, 10 + INPUT_ESC_MS + 1), 0);
+  UserAction_t sigs[3] = {Pause, Left, Terminate};
+  for (int i = 0; i < 3; i++) {
+    ck_assert_int_eq(input_next(&queue, 1000, &event), 1);
+    ck_assert_int_eq(event.sig, sigs[i]);
+  }
+}
+END_TEST
+
+START_TEST(frame_buffer_test) {
+  static FrameBuffer_t buffer;
+  frame_init(&buffer);
+  ck_assert_ptr_null(frame_latest(&buffer));
+  frame_back(&buffer)->seq = 1;
+  frame_publish(&buffer);
+  frame_back(&buffer)->seq = 2;
+  frame_publish(&buffer);
+  Frame_t *frame = frame_latest(&buffer);
+  ck_assert_ptr_nonnull(frame);
+  ck_assert_int_eq(frame->seq, 2);
+  ck_assert_ptr_null(frame_latest(&buffer));
+  frame_back(&buffer)->seq = 3;
+  ck_assert_int_eq(frame->seq, 2);
+  frame_publish(&buffer);
+  ck_assert_int_eq(frame_latest(&buffer)->seq, 3);
+}
+END_TEST
+
+START_TEST(bind_game_state_test) {
+  GameInfo_t game = {0};
+  GameInfo_t *stats = updateCurrentState();
+  bind_game_state(&game);
+  ck_assert(updateCurrentState() == &game);
+  stats_init(&game);
+  FSM_STATES_g state = SPAWN;
+  game.next_tetromino = get_tetromino(1);
+  userInput(&state, 0);
+  ck_assert_int_eq(game.current_tetromino.type, 1);
+  bind_game_state(NULL);
+  ck_assert(updateCurrentState() == stats);
+}
+END_TEST
+
+static void bot_test_well(FSM_STATES_g *state) {
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  for (int i = 1; i < 10; i++) {
+    for (int j = 16; j < 20; j++) stats->field[i][j] = 1;
+  }
+  stats->next_tetromino = get_tetromino(0);
+  *state = SPAWN;
+  userInput(state, 0);
+}
+
+START_TEST(bot_placements_test) {
+  uint16_t rows[BOARD_HEIGHT];
+  Placement_t list[BOT_MAX_PLACEMENTS];
+  MoveGen_t gen;
+  for (int j = 0; j < BOARD_HEIGHT; j++) rows[j] = BOARD_EMPTY_ROW;
+  ck_assert_int_eq(bot_placements(&gen, rows, PIECE_O, 0, 4, 1, list), 9);
+  ck_assert_int_eq(bot_placements(&gen, rows, PIECE_I, 0, 4, 1, list), 17);
+  for (int k = 0; k < 17; k++) ck_assert_int_eq(list[k].lines, 0);
+
+  unsigned seed = 1;
+  int most = 0;
+  for (int f = 0; f < 5000 && most <= 64; f++) {
+    for (int j = 0; j < BOARD_HEIGHT; j++) rows[j] = BOARD_EMPTY_ROW;
+    for (int i = 0; i < BOARD_WIDTH; i++) {
+      for (int j = BOARD_HEIGHT - rand_r(&seed) % 14; j < BOARD_HEIGHT; j++)
+        if (rand_r(&seed) % 5 != 0) rows[j] |= 1 << (i + BOARD_SHIFT);
+    }
+    for (int type = 0; type < RAND; type++) {
+      if (board_collides(rows, piece_masks[type][0], 4, 0)) continue;
+      int count = movegen_run(&gen, rows, type, 0, 4, 1);
+      ck_assert_int_eq(bot_placements(&gen, rows, type, 0, 4, 1, list),
+                       count);
+      if (count > most) most = count;
+    }
+  }
+  ck_assert_int_gt(most, 64);
+}
+END_TEST
+
+START_TEST(board_features_test) {
+  uint16_t rows[BOARD_HEIGHT];
+  BoardFeatures_t full;
+  for (int j = 0; j < BOARD_HEIGHT; j++) rows[j] = BOARD_EMPTY_ROW;
+  board_features(rows, &full);
+  ck_assert_int_eq(full.row_transitions, 2 * BOARD_HEIGHT);
+  ck_assert_int_eq(full.col_transitions, BOARD_WIDTH);
+  ck_assert_int_eq(full.height + full.holes + full.wells + full.bumpiness, 0);
+
+  Placement_t list[BOT_MAX_PLACEMENTS];
+  MoveGen_t gen;
+  int lines = 0;
+  for (int n = 0; n < 200; n++) {
+    int type = n * 5 % RAND, rot, x, y;
+    if (bot_spawn(rows, type, &rot, &x, &y)) break;
+    int count = bot_placements(&gen, rows, type, rot, x, y, list);
+    int best = 0;
+    for (int k = 0; k < count; k++) {
+      board_features(list[k].rows, &full);
+      ck_assert(memcmp(&full, &list[k].features, sizeof(full)) == 0);
+      double value = bot_evaluate(list[k].rows, list[k].lines);
+      ck_assert(bot_evaluate_features(&full, list[k].lines) == value);
+      if (value > bot_evaluate(list[best].rows, list[best].lines)) best = k;
+    }
+    memcpy(rows, list[best].rows, sizeof(rows));
+    lines += list[best].lines;
+  }
+  ck_assert_int_gt(lines, 0);
+}
+END_TEST
+
+START_TEST(movegen_tuck_test) {
+  FSM_STATES_g state = SPAWN;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  for (int i = 0; i < 4; i++) stats->field[i][17] = 1;
+  stats->next_tetromino = get_tetromino(PIECE_O);
+  userInput(&state, 0);
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(stats, rows);
+  MoveGen_t gen;
+  int count = movegen_run(&gen, rows, PIECE_O, 0, stats->cur_x, stats->cur_y);
+  int tuck = -1;
+  for (int k = 0; k < count; k++) {
+    if (gen.locks[k].x == 0 && gen.locks[k].y == 19) tuck = k;
+  }
+  ck_assert_int_ge(tuck, 0);
+  UserAction_t path[64];
+  int len = movegen_path(&gen, tuck, path, 64);
+  ck_assert_int_eq(len, 23);
+  ck_assert_int_eq(movegen_path(&gen, tuck, path, 10), -1);
+  for (int i = 0; i < len; i++) userInput(&state, path[i]);
+  ck_assert_int_eq(state, ATTACHING);
+  userInput(&state, 0);
+  ck_assert_int_eq(stats->field[0][18] + stats->field[1][18], 2);
+  ck_assert_int_eq(stats->field[0][19] + stats->field[1][19], 2);
+}
+END_TEST
+
+START_TEST(movegen_kick_above_test) {
+  FSM_STATES_g state = MOVING;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  for (int i = 0; i < BOARD_WIDTH; i++) {
+    for (int j = 2; j < 5; j++) stats->field[i][j] = (i != 6) != (j == 4);
+  }
+  stats->current_tetromino = piece_tetromino(PIECE_I, 2);
+  stats->cur_x = 4;
+  stats->cur_y = 1;
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(stats, rows);
+  ck_assert_int_eq(board_kick(rows, PIECE_I, 2, 4, 0), 3);
+  MoveGen_t gen;
+  int count = movegen_run(&gen, rows, PIECE_I, 2, 4, 1);
+  int lifted = -1;
+  for (int k = 0; k < count; k++) {
+    if (gen.locks[k].rot == 3 && gen.locks[k].x == 3) lifted = k;
+  }
+  ck_assert_int_ge(lifted, 0);
+  UserAction_t path[64];
+  int len = movegen_path(&gen, lifted, path, 64);
+  ck_assert_int_eq(path[0], Action);
+  for (int i = 0; i < len; i++) userInput(&state, path[i]);
+  ck_assert_int_eq(state, ATTACHING);
+  userInput(&state, 0);
+  for (int i = 3; i < 7; i++) ck_assert_int_eq(stats->field[i][1], 1);
+}
+END_TEST
+
+START_TEST(bot_greedy_test) {
+  FSM_STATES_g state;
+  Placement_t move;
+  bot_test_well(&state);
+  ck_assert_int_eq(bot_greedy(updateCurrentState(), &move), 0);
+  ck_assert_int_eq(move.lines, 4);
+  bot_execute(&state, &move);
+  ck_assert_int_eq(state, MOVING);
+  ck_assert_int_eq(updateCurrentState()->score, 1500);
+}
+END_TEST
+
+START_TEST(bot_search_test) {
+  BotConfig_t config = {3, 0, 2};
+  Bot_t *bot = bot_create(&config);
+  ck_assert_ptr_nonnull(bot);
+  FSM_STATES_g state;
+  Placement_t move;
+  bot_test_well(&state);
+  ck_assert_int_eq(bot_search(bot, updateCurrentState(), &move), 0);
+  ck_assert_int_eq(bot->depth_reached, 3);
+  ck_assert_int_gt(bot->nodes, 1000);
+  ck_assert_int_eq(move.lines, 4);
+  bot_execute(&state, &move);
+  ck_assert_int_eq(updateCurrentState()->score, 1500);
+  bot_free(bot);
+}
+END_TEST
+
+START_TEST(hint_test) {
+  Hint_t *hint = hint_create(2, 1);
+  ck_assert_ptr_nonnull(hint);
+  FSM_STATES_g state;
+  HintMove_t move = {0};
+  Placement_t best;
+  bot_test_well(&state);
+  ck_assert_int_eq(hint_best(hint, &move), 1);
+  hint_post(hint, updateCurrentState());
+  for (int t = 0; t < 2000 && (hint_best(hint, &move) || move.depth < 2);
+       t++) {
+    struct timespec pause = {0, 1000000};
+    nanosleep(&pause, NULL);
+  }
+  ck_assert_int_eq(move.depth, 2);
+  BotConfig_t config = {2, 0, 1};
+  Bot_t *bot = bot_create(&config);
+  ck_assert_int_eq(bot_search(bot, updateCurrentState(), &best), 0);
+  ck_assert_int_eq(move.rot, best.rot);
+  ck_assert_int_eq(move.x, best.x);
+  ck_assert_int_eq(move.y, best.y);
+  bot_free(bot);
+  hint_free(hint);
+}
+END_TEST
+
+/// Answer of the test controller
+static BotDecision_t plugin_test_decision;
+/// Field cell the test controller saw at the bottom of column 1
+static int plugin_test_cell;
+
+static int plugin_test_decide(void *bot, const BotView_t *view,
+                              BotDecision_t *decision) {
+  (void)bot;
+  plugin_test_cell = view->field[1 * view->stride + view->height - 1];
+  *decision = plugin_test_decision;
+  return *view->type != 0;
+}
+
+static const BotPlugin_t plugin_test_api = {
+    BOT_PLUGIN_ABI, sizeof(BotPlugin_t), "test", NULL, plugin_test_decide,
+    NULL};
+
+START_TEST(plugin_test) {
+  FSM_STATES_g state;
+  Placement_t move, plan;
+  BotPlugin_t old = plugin_test_api;
+  old.abi = BOT_PLUGIN_ABI + 1;
+  ck_assert_ptr_null(plugin_attach(&old, updateCurrentState()));
+  ck_assert_ptr_null(plugin_load("./no_such_bot.so", updateCurrentState()));
+  Plugin_t *plugin = plugin_attach(&plugin_test_api, updateCurrentState());
+  ck_assert_ptr_nonnull(plugin);
+
+  bot_test_well(&state);
+  GameInfo_t *stats = updateCurrentState();
+  ck_assert_int_eq(bot_greedy(stats, &move), 0);
+  int rot = piece_rotation(&stats->current_tetromino);
+  plugin_test_decision = (BotDecision_t){BOT_DECIDE_PLACEMENT,
+                                         (move.rot - rot) & 3, move.x, 0, {0}};
+  ck_assert_int_eq(plugin_plan(plugin, &plan), 0);
+  ck_assert_int_eq(plugin_test_cell, 1);
+  ck_assert_int_eq(plan.rot, move.rot);
+  ck_assert_int_eq(plan.x, move.x);
+  bot_execute(&state, &plan);
+  ck_assert_int_eq(stats->score, 1500);
+
+  bot_test_well(&state);
+  plugin_test_decision.x = -10;
+  ck_assert_int_eq(plugin_plan(plugin, &plan), 1);
+  plugin_test_decision = (BotDecision_t){BOT_DECIDE_SIGNALS, 0, 0, 2,
+                                         {BOT_SIGNAL_LEFT, Start}};
+  ck_assert_int_eq(plugin_plan(plugin, &plan), 1);
+  plugin_test_decision.signals[1] = BOT_SIGNAL_LEFT;
+  ck_assert_int_eq(plugin_plan(plugin, &plan), 0);
+  ck_assert_int_eq(plan.path_len, 2);
+  ck_assert_int_eq(plan.path[1], Left);
+  bot_execute(&state, &plan);
+  ck_assert_int_eq(stats->counters.pieces, 1);
+  ck_assert_int_eq(stats->score, 0);
+  ck_assert_int_eq(plugin->calls, 4);
+  plugin_free(plugin);
+}
+END_TEST
+
+START_TEST(place_cache_test) {
+  PlaceCache_t *cache = place_cache_create(1);
+  ck_assert_ptr_nonnull(cache);
+  FSM_STATES_g state;
+  Placement_t move;
+  PlaceCacheStats_t stats;
+  for (int pass = 0; pass < 2; pass++) {
+    bot_test_well(&state);
+    ck_assert_int_eq(bot_greedy_cached(cache, updateCurrentState(), &move), 0);
+    ck_assert_int_eq(move.lines, 4);
+    bot_execute(&state, &move);
+    ck_assert_int_eq(updateCurrentState()->score, 1500);
+  }
+  place_cache_stats(cache, &stats);
+  ck_assert_int_eq(stats.lookups, 2);
+  ck_assert_int_eq(stats.hits, 1);
+  ck_assert_int_eq(stats.stale, 0);
+
+  uint16_t rows[BOARD_HEIGHT], raised[BOARD_HEIGHT];
+  for (int j = 0; j < BOARD_HEIGHT; j++) rows[j] = BOARD_EMPTY_ROW;
+  rows[19] = BOARD_FULL_ROW & ~(1 << (5 + BOARD_SHIFT));
+  for (int j = 0; j < BOARD_HEIGHT; j++) raised[j] = rows[j + (j < 19)];
+  raised[19] = BOARD_FULL_ROW;
+  ck_assert(place_cache_key(rows, PIECE_I) == place_cache_key(raised, PIECE_I));
+  ck_assert(place_cache_key(rows, PIECE_I) != place_cache_key(rows, PIECE_O));
+
+  PlaceCacheEntry_t entry = {0};
+  for (int k = 1; k <= 20; k++) {
+    entry.key = 1ull << 63 | k;
+    place_cache_store(cache, &entry);
+  }
+  place_cache_stats(cache, &stats);
+  ck_assert_int_eq(stats.used, stats.capacity);
+  ck_assert_int_eq(stats.inserts + stats.evictions, 21);
+  place_cache_free(cache);
+}
+END_TEST
+
+START_TEST(telemetry_test) {
+  FSM_STATES_g state = SPAWN;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  stats_seed(stats, 3);
+  stats->pause = 0;
+  userInput(&state, 0);
+  userInput(&state, Left);
+  userInput(&state, Right);
+  userInput(&state, Pause);
+  step_ticks(&state, 50);
+  userInput(&state, Pause);
+  step_ticks(&state, 100000);
+  ck_assert_int_eq(state, GAME_OVER);
+  ck_assert_int_eq(stats->counters.actions, 2);
+  ck_assert_int_gt(stats->counters.pieces, 5);
+  ck_assert_int_eq(stats->counters.state_ticks[PAUSE], 50);
+  long ticks = 0;
+  for (int i = 0; i <= EXIT_STATE; i++) ticks += stats->counters.state_ticks[i];
+  ck_assert_int_eq(ticks, 100050);
+
+  TelemetryRecord_t record, back;
+  telemetry_record(stats, &record);
+  ck_assert(telemetry_valid(&record));
+  ck_assert_int_eq(record.pieces, stats->counters.pieces);
+  ck_assert_int_eq(record.state_ms[PAUSE], 50 * TICK_MS);
+  ck_assert(telemetry_pps(&record) > 0);
+  remove("telemetry_test");
+  ck_assert_int_eq(telemetry_append("telemetry_test", &record), 0);
+  FILE *fp = fopen("telemetry_test", "rb");
+  ck_assert_ptr_nonnull(fp);
+  ck_assert_int_eq(fread(&back, sizeof(back), 1, fp), 1);
+  fclose(fp);
+  remove("telemetry_test");
+  ck_assert_mem_eq(&back, &record, sizeof(record));
+}
+END_TEST
+
+START_TEST(histogram_test) {
+  Histogram_t a, b;
+  histogram_init(&a, 0, 1);
+  histogram_init(&b, 0, 1);
+  for (int i = 1; i <= 50; i++) histogram_add(&a, i);
+  for (int i = 51; i <= 100; i++) histogram_add(&b, i);
+  histogram_add(&b, -1);
+  histogram_merge(&a, &b);
+  ck_assert_int_eq(a.count, 101);
+  ck_assert_int_eq(a.under, 1);
+  ck_assert_int_eq(a.over, 37);
+  ck_assert(histogram_percentile(&a, 50) == 50.5);
+  ck_assert(histogram_percentile(&a, 99) == HISTOGRAM_BINS);
+}
+END_TEST
+
+START_TEST(soak_drift_test) {
+  SoakSample_t samples[2 * SOAK_WINDOW];
+  const SoakLimits_t limits = {1024, 0, 2.0};
+  char why[128] = "";
+  for (int i = 0; i < 2 * SOAK_WINDOW; i++)
+    samples[i] = (SoakSample_t){i * 1000, 0, 0, 0, 4000 + i, 3, 1, 2, 50};
+  samples[1].p99_us = 40;
+  samples[4].p99_us = 40;
+  ck_assert_int_eq(soak_drift(samples, 2 * SOAK_WINDOW, &limits, why, 128), 0);
+  samples[2 * SOAK_WINDOW - 1].p99_us = 5;
+  samples[2 * SOAK_WINDOW - 2].p99_us = 5;
+  ck_assert_int_eq(soak_drift(samples, 2 * SOAK_WINDOW, &limits, why, 128), 1);
+  ck_assert_ptr_nonnull(strstr(why, "latency"));
+  ck_assert_int_eq(soak_drift(samples, 2 * SOAK_WINDOW - 1, &limits, NULL, 0),
+                   0);
+  samples[SOAK_WINDOW].fds = 4;
+  ck_assert_int_eq(soak_drift(samples, SOAK_WINDOW + 1, &limits, why, 128), 1);
+  ck_assert_ptr_nonnull(strstr(why, "descriptors"));
+  samples[SOAK_WINDOW].rss_kb = 6000;
+  ck_assert_int_eq(soak_drift(samples, SOAK_WINDOW + 1, &limits, why, 128), 1);
+  ck_assert_ptr_nonnull(strstr(why, "memory"));
+
+  int fds = soak_fd_count();
+  ck_assert_int_ge(fds, 3);
+  FILE *fp = fopen("/proc/self/statm", "r");
+  ck_assert_int_eq(soak_fd_count(), fds + 1);
+  fclose(fp);
+  ck_assert_int_eq(soak_fd_count(), fds);
+  ck_assert_int_gt(soak_rss_kb(), 0);
+}
+END_TEST
+
+START_TEST(save_game_test) {
+  FSM_STATES_g state = SPAWN;
+  GameInfo_t *stats = updateCurrentState();
+  stats_init(stats);
+  stats_seed(stats, 11);
+  userInput(&state, 0);
+  step_ticks(&state, 3000);
+  userInput(&state, Action);
+  ck_assert_int_eq(state, MOVING);
+  GameInfo_t saved = *stats;
+  ck_assert_int_eq(save_game("save_test", stats), 0);
+
+  stats_init(stats);
+  ck_assert_int_eq(load_game("save_test", stats), 0);
+  ck_assert_int_eq(load_game("save_test", stats), 1);
+  ck_assert_mem_eq(stats->field, saved.field, sizeof(saved.field));
+  ck_assert_mem_eq(&stats->current_tetromino, &saved.current_tetromino,
+                   sizeof(tetromino));
+  ck_assert_int_eq(stats->next_tetromino.type, saved.next_tetromino.type);
+  ck_assert_int_eq(stats->cur_x, saved.cur_x);
+  ck_assert_int_eq(stats->cur_y, saved.cur_y);
+  ck_assert_int_eq(stats->score, saved.score);
+  ck_assert_int_eq(stats->seed, saved.seed);
+  ck_assert_int_eq(stats->counters.pieces, saved.counters.pieces);
+
+  ck_assert_int_eq(save_game("save_test", stats), 0);
+  FILE *fp = fopen("save_test", "r+b");
+  ck_assert_ptr_nonnull(fp);
+  fseek(fp, 40, SEEK_SET);
+  fputc(0x55, fp);
+  fclose(fp);
+  stats_init(stats);
+  int score = stats->score;
+  ck_assert_int_eq(load_game("save_test", stats), 2);
+  ck_assert_int_eq(stats->score, score);
+  ck_assert_int_eq(load_game("save_test", stats), 1);
+  ck_assert_int_eq(crc32_compute("123456789", 9), 0xCBF43926u);
+}
+END_TEST
+
+START_TEST(packed_view_test) {
+  GameInfo_t game = {0}, view = {0};
+  PackedGame_t packed;
+  FSM_STATES_g state = SPAWN;
+  int reward;
+  bind_game_state(&game);
+  game.speed = 700;
+  stats_seed(&game, 11);
+  userInput(&state, 0);
+  step_ticks(&state, 3000);
+  userInput(&state, Action);
+  userInput(&state, Left);
+  ck_assert_int_eq(state, MOVING);
+  ck_assert_int_eq(packed_from_game(&game, state, &packed), 0);
+  packed_view(&packed, &view);
+  ck_assert_mem_eq(view.field, game.field, sizeof(game.field));
+  ck_assert_mem_eq(&view.current_tetromino, &game.current_tetromino,
+                   sizeof(tetromino));
+  ck_assert_int_eq(view.next_tetromino.type, game.next_tetromino.type);
+  ck_assert_int_eq(view.cur_x, game.cur_x);
+  ck_assert_int_eq(view.cur_y, game.cur_y);
+  ck_assert_int_eq(view.score, game.score);
+  ck_assert_int_eq(view.speed, game.speed);
+  ck_assert_int_eq(view.seed, game.seed);
+  ck_assert_int_eq(view.counters.pieces, game.counters.pieces);
+
+  int y = packed.y;
+  ck_assert_int_eq(packed_step(&packed, Pause, &reward), 0);
+  ck_assert_int_eq(packed.state, PAUSE);
+  packed_step(&packed, Down, &reward);
+  ck_assert_int_eq(packed.y, y);
+  packed_step(&packed, Pause, &reward);
+  ck_assert_int_eq(packed.state, MOVING);
+  ck_assert_int_eq(packed.y, y + 1);
+  bind_game_state(NULL);
+}
+END_TEST
+
+START_TEST(versus_garbage_test) {
+  GarbageQueue_t queue = {0};
+  garbage_push(&queue, 2, 3);
+  garbage_push(&queue, 4, 7);
+  ck_assert_int_eq(queue.rows, 6);
+  ck_assert_int_eq(garbage_cancel(&queue, 3), 0);
+  ck_assert_int_eq(queue.count, 1);
+  ck_assert_int_eq(queue.batches[queue.head].rows, 3);
+  ck_assert_int_eq(queue.batches[queue.head].hole, 7);
+  ck_assert_int_eq(garbage_cancel(&queue, 5), 2);
+  ck_assert_int_eq(queue.rows, 0);
+  ck_assert_int_eq(queue.count, 0);
+
+  uint16_t rows[BOARD_HEIGHT];
+  for (int j = 0; j < BOARD_HEIGHT; j++) rows[j] = BOARD_EMPTY_ROW;
+  ck_assert_int_eq(garbage_rise(rows, 2, 4), 0);
+  ck_assert_int_eq(rows[17], BOARD_EMPTY_ROW);
+  ck_assert_int_eq(rows[18], BOARD_FULL_ROW & ~(1 << (4 + BOARD_SHIFT)));
+  ck_assert_int_eq(rows[19], rows[18]);
+  rows[1] |= 1 << BOARD_SHIFT;
+  ck_assert_int_eq(garbage_rise(rows, 2, 0), 1);
+}
+END_TEST
+
+START_TEST(versus_match_test) {
+  static Versus_t match[2];
+  set_score_file(NULL);
+  for (int k = 0; k < 2; k++) {
+    versus_init(&match[k], 5);
+    match[k].tick_limit = 6000;
+    match[k].sides[0].bot.interval = 1;
+    match[k].sides[1].bot.interval = 3;
+    while (match[k].winner == VERSUS_PLAYING) versus_tick(&match[k]);
+  }
+  set_score_file("score");
+  ck_assert_int_eq(match[0].tick, match[1].tick);
+  ck_assert_int_eq(match[0].winner, match[1].winner);
+  for (int i = 0; i < 2; i++) {
+    const VersusSide_t *side = &match[0].sides[i];
+    const VersusSide_t *rival = &match[0].sides[1 - i];
+    ck_assert_int_eq(side->game.score, match[1].sides[i].game.score);
+    ck_assert_int_gt(side->game.counters.pieces, 50);
+    ck_assert_int_ge(side->sent, rival->received + rival->pending.rows);
+  }
+  ck_assert_int_gt(match[0].sides[0].sent + match[0].sides[1].sent, 0);
+}
+END_TEST
+
+/// Fields the dataset test saw attaching, in order
+static uint16_t dataset_test_rows[1024][BOARD_HEIGHT];
+/// Number of fields in dataset_test_rows
+static int dataset_test_count = 0;
+
+static void dataset_test_hook(const LockEvent_t *event, void *arg) {
+  uint16_t *rows = dataset_test_rows[dataset_test_count++];
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    rows[j] = BOARD_EMPTY_ROW;
+    for (int i = 0; i < BOARD_WIDTH; i++)
+      if (event->field[i][j]) rows[j] |= 1 << (i + BOARD_SHIFT);
+  }
+  dataset_lock_hook(event, arg);
+}
+
+START_TEST(dataset_test) {
+  DatasetWriter_t *writer = dataset_create("dataset_test.bin");
+  ck_assert_ptr_nonnull(writer);
+  set_score_file(NULL);
+  GameInfo_t game;
+  Placement_t move;
+  int score = 0;
+  dataset_test_count = 0;
+  for (int g = 0; g < 2; g++) {
+    DatasetStream_t *stream = dataset_stream(writer);
+    stream->game = g;
+    set_lock_hook(dataset_test_hook, stream);
+    FSM_STATES_g state = SPAWN;
+    bind_game_state(&game);
+    stats_init(&game);
+    stats_seed(&game, g + 1);
+    userInput(&state, 0);
+    for (int p = 0; state == MOVING && p < 300; p++) {
+      ck_assert_int_eq(bot_greedy(&game, &move), 0);
+      bot_execute(&state, &move);
+    }
+    bind_game_state(NULL);
+    set_lock_hook(NULL, NULL);
+    score += game.score;
+    ck_assert_int_eq(dataset_stream_close(stream), 0);
+  }
+  set_score_file("score");
+  ck_assert_int_eq(dataset_close(writer), 0);
+
+  DatasetView_t view;
+  DatasetSample_t sample;
+  ck_assert_int_eq(dataset_open("dataset_test.bin", &view), 0);
+  ck_assert_int_eq(view.header->chunk_count, 2);
+  ck_assert_int_eq(view.header->sample_count, dataset_test_count);
+  ck_assert_int_eq(view.index[1].first, view.index[0].count);
+  for (int k = 0; k < dataset_test_count; k++) {
+    ck_assert_int_eq(dataset_sample(&view, k, &sample), 0);
+    ck_assert_int_eq(sample.game, k >= (int)view.index[1].first);
+    ck_assert_mem_eq(sample.rows, dataset_test_rows[k], sizeof(sample.rows));
+    score -= sample.reward;
+  }
+  ck_assert_int_eq(score, 0);
+  ck_assert_int_eq(dataset_sample(&view, dataset_test_count, &sample), 1);
+  dataset_unmap(&view);
+  remove("dataset_test.bin");
+}
+END_TEST
+
+/**
+ * @brief Gives a signal to the game the way the game loop does, logging it
+ * @param[in] *journal Log
+ * @param[in] *state Current game state
+ * @param[in] sig Signal
+ */
+static void journal_test_input(Journal_t *journal, FSM_STATES_g *state,
+                               UserAction_t sig) {
+  journal_input(journal, updateCurrentState(), sig);
+  userInput(state, sig);
+  journal_spawn(journal, updateCurrentState(), *state);
+}
+
+START_TEST(journal_test) {
+  Journal_t journal;
+  ck_assert_int_eq(journal_open(&journal, "journal_test.log"), 0);
+  set_score_file(NULL);
+  set_lock_hook(journal_lock_hook, &journal);
+  GameInfo_t game = {0};
+  Placement_t move;
+  FSM_STATES_g state = SPAWN;
+  bind_game_state(&game);
+  stats_init(&game);
+  stats_seed(&game, 7);
+  for (int p = 0; p < 40 && state != GAME_OVER;) {
+    step_ticks(&state, 3);
+    journal_spawn(&journal, &game, state);
+    if (state != MOVING) continue;
+    ck_assert_int_eq(bot_greedy(&game, &move), 0);
+    for (int i = 0; state == MOVING; i++) {
+      journal_test_input(&journal, &state,
+                         i < move.path_len ? move.path[i] : Down);
+      step_ticks(&state, 1);
+      journal_spawn(&journal, &game, state);
+    }
+    p++;
+  }
+  while (state != MOVING) step_ticks(&state, 1);
+  journal_spawn(&journal, &game, state);
+  journal_test_input(&journal, &state, Left);
+  journal_test_input(&journal, &state, Action);
+  journal_test_input(&journal, &state, Right);
+  bind_game_state(NULL);
+  set_lock_hook(NULL, NULL);
+  journal_close(&journal);
+
+  GameInfo_t recovered = {0};
+  SaveFile_t live, rebuilt;
+  JournalReport_t report;
+  ck_assert_int_eq(
+      journal_recover("journal_test.log", &recovered, &state, &report), 3);
+  ck_assert_int_eq(report.clean, 1);
+  ck_assert_int_eq(recovered.counters.pieces, 0);
+  FILE *fp = fopen("journal_test.log", "r+b");
+  uint32_t crashed = 0;
+  fseek(fp, offsetof(JournalHeader_t, clean), SEEK_SET);
+  fwrite(&crashed, sizeof(crashed), 1, fp);
+  fclose(fp);
+  ck_assert_int_eq(
+      journal_recover("journal_test.log", &recovered, &state, &report), 0);
+  ck_assert_int_eq(state, MOVING);
+  ck_assert_int_eq(report.clean, 0);
+  ck_assert_int_eq(report.last, journal.seq);
+  ck_assert_int_eq(report.dropped, 0);
+  ck_assert_int_lt(report.snapshot, journal.seq - 2);
+  ck_assert_int_eq(save_pack(&game, &live), 0);
+  ck_assert_int_eq(save_pack(&recovered, &rebuilt), 0);
+  ck_assert_mem_eq(&live, &rebuilt, sizeof(SaveFile_t));
+
+  fp = fopen("journal_test.log", "r+b");
+  fseek(fp,
+        JOURNAL_HEADER_BYTES +
+            (journal.seq - 2) % JOURNAL_SLOTS * sizeof(JournalRecord_t) + 12,
+        SEEK_SET);
+  fputc(0xFF, fp);
+  fclose(fp);
+  ck_assert_int_eq(
+      journal_recover("journal_test.log", &recovered, &state, &report), 0);
+  ck_assert_int_eq(report.last, journal.seq);
+  ck_assert_int_eq(report.dropped, 2);
+  ck_assert_int_eq(recovered.score, game.score);
+
+  fp = fopen("journal_test.log", "r+b");
+  uint16_t before_kicks = 1;
+  fseek(fp, offsetof(JournalHeader_t, version), SEEK_SET);
+  fwrite(&before_kicks, sizeof(before_kicks), 1, fp);
+  fclose(fp);
+  ck_assert_int_eq(
+      journal_recover("journal_test.log", &recovered, &state, &report), 1);
+  set_score_file("score");
+  remove("journal_test.log");
+}
+END_TEST
+
+static void rewind_test_same(const GameInfo_t *a, const GameInfo_t *b) {
+  ck_assert(memcmp(a->field, b->field, sizeof(a->field)) == 0);
+  ck_assert(memcmp(&a->current_tetromino, &b->current_tetromino,
+                   sizeof(tetromino)) == 0);
+  ck_assert_int_eq(a->next_tetromino.type, b->next_tetromino.type);
+  ck_assert(a->seed == b->seed);
+  ck_assert_int_eq(a->cur_x, b->cur_x);
+  ck_assert_int_eq(a->cur_y, b->cur_y);
+  ck_assert_int_eq(a->score, b->score);
+  ck_assert_int_eq(a->speed, b->speed);
+  ck_assert_int_eq(a->counters.pieces, b->counters.pieces);
+  ck_assert(memcmp(a->counters.clears, b->counters.clears,
+                   sizeof(a->counters.clears)) == 0);
+}
+
+START_TEST(rewind_test) {
+  static Rewind_t history;
+  static GameInfo_t before[40];
+  FSM_STATES_g state;
+  Placement_t move;
+  rewind_reset(&history);
+  set_lock_hook(rewind_lock_hook, &history);
+  bot_test_well(&state);
+  GameInfo_t *stats = updateCurrentState();
+  int n = 0;
+  for (; n < 40 && state == MOVING; n++) {
+    before[n] = *stats;
+    ck_assert_int_eq(bot_greedy(stats, &move), 0);
+    bot_execute(&state, &move);
+  }
+  set_lock_hook(NULL, NULL);
+  ck_assert_int_eq(n, 40);
+  ck_assert_int_eq(history.count, 40);
+  userInput(&state, Left);
+  ck_assert_int_eq(rewind_step(&history, &state, 1), 1);
+  ck_assert_int_eq(state, MOVING);
+  rewind_test_same(stats, &before[39]);
+  ck_assert_int_eq(rewind_step(&history, &state, 30), 30);
+  rewind_test_same(stats, &before[9]);
+  ck_assert_int_eq(rewind_step(&history, &state, 100), 9);
+  rewind_test_same(stats, &before[0]);
+  ck_assert_int_eq(rewind_step(&history, &state, 1), 0);
+  ck_assert_int_eq(bot_greedy(stats, &move), 0);
+  bot_execute(&state, &move);
+  ck_assert_int_eq(stats->score, 1500);
+  ck_assert_int_eq(stats->next_tetromino.type,
+                   before[1].next_tetromino.type);
+}
+END_TEST
+
 void srunner_state_funcs(SRunner *sr) {
   Suite *Suite1 = suite_create("state");
   TCase *TestCase1 = tcase_create("state");
@@ -386,6 +1574,32 @@ void srunner_state_funcs(SRunner *sr) {
   tcase_add_test(TestCase1, attaching_test_2);
 
   tcase_add_test(TestCase1, pause_test);
+  tcase_add_test(TestCase1, fsm_stats_test);
+
+  tcase_add_test(TestCase1, step_ticks_test);
+  tcase_add_test(TestCase1, step_ticks_attaching_test);
+  tcase_add_test(TestCase1, step_ticks_seed_test);
+
+  tcase_add_test(TestCase1, bot_placements_test);
+  tcase_add_test(TestCase1, board_features_test);
+  tcase_add_test(TestCase1, movegen_tuck_test);
+  tcase_add_test(TestCase1, movegen_kick_above_test);
+  tcase_add_test(TestCase1, bot_greedy_test);
+  tcase_add_test(TestCase1, bot_search_test);
+  tcase_add_test(TestCase1, place_cache_test);
+  tcase_add_test(TestCase1, hint_test);
+  tcase_add_test(TestCase1, plugin_test);
+
+  tcase_add_test(TestCase1, telemetry_test);
+  tcase_add_test(TestCase1, histogram_test);
+  tcase_add_test(TestCase1, soak_drift_test);
+  tcase_add_test(TestCase1, save_game_test);
+  tcase_add_test(TestCase1, packed_view_test);
+  tcase_add_test(TestCase1, versus_garbage_test);
+  tcase_add_test(TestCase1, versus_match_test);
+  tcase_add_test(TestCase1, dataset_test);
+  tcase_add_test(TestCase1, journal_test);
+  tcase_add_test(TestCase1, rewind_test);
 
   srunner_add_suite(sr, Suite1);
 }
@@ -401,6 +1615,11 @@ void srunner_input_funcs(SRunner *sr) {
 
   tcase_add_test(TestCase2, score_input_output_test);
 
+  tcase_add_test(TestCase2, input_queue_test);
+  tcase_add_test(TestCase2, input_das_test);
+  tcase_add_test(TestCase2, input_release_test);
+  tcase_add_test(TestCase2, input_decode_test);
+
   srunner_add_suite(sr, Suite2);
 }
 
@@ -417,6 +1636,16 @@ void srunner_other_funcs(SRunner *sr) {
 
   tcase_add_test(TestCase3, check_collision_test);
   tcase_add_test(TestCase3, check_collision_r_test);
+  tcase_add_test(TestCase3, rotate_kick_test);
+
+  tcase_add_test(TestCase3, batch_reference_test);
+  tcase_add_test(TestCase3, batch_reset_test);
+  tcase_add_test(TestCase3, sim_feed_test);
+  tcase_add_test(TestCase3, diff_corpus_test);
+  tcase_add_test(TestCase3, diff_shrink_test);
+
+  tcase_add_test(TestCase3, frame_buffer_test);
+  tcase_add_test(TestCase3, bind_game_state_test);
 
   srunner_add_suite(sr, Suite3);
 }
@@ -0,0 +1,278 @@
+/**
+ * @file batch.c
+ * @brief Stepping many games at once for training bots
+ *
+ * One step of a game is one signal handled as moving_state() does, a turn
+ * kicked as rotate() kicks it, followed by one row of gravity as
+ * move_down() does. A tetromino that cannot fall
+ * attaches, filled rows are cleared and the next one spawns within the same
+ * step, following attaching_state() and spawn_state(). A game that is over
+ * restarts at once with a new seed.
+ */
+
+#include "batch.h"
+
+/// Score for 0, 1, 2, 3 and 4 cleared rows, as in attaching_state()
+static const int batch_row_score[5] = {0, 100, 300, 700, 1500};
+
+/**
+ * @ingroup batch_funcs
+ * @brief Checking one game of the batch for collisions
+ * @param[in] *batch Batch
+ * @param[in] game Game index
+ * @param[in] *mask Row masks of the tetromino
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ * @return Returns collision status
+ */
+static int lane_collides(const TetrisBatch_t *batch, int game,
+                         const uint8_t *mask, int x, int row) {
+  for (int j = 0; j < 4; j++) {
+    if (mask[j] == 0) continue;
+    int r = row + j;
+    if (r < 0 || r >= BOARD_HEIGHT || x < -BOARD_SHIFT || x >= BOARD_WIDTH)
+      return 1;
+    if (batch->rows[r * batch->size + game] & (mask[j] << (x + BOARD_SHIFT)))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Spawns the next tetromino of one game, as spawn_state() does
+ * @param[in] *batch Batch
+ * @param[in] game Game index
+ * @return Returns 1 if the tetromino does not fit and the game is over
+ */
+static int lane_spawn(TetrisBatch_t *batch, int game) {
+  int type = batch->next[game];
+  batch->type[game] = type;
+  batch->next[game] = rand_r(&batch->seed[game]) % RAND;
+  batch->rot[game] = 0;
+  batch->x[game] = 4;
+  batch->y[game] = 1;
+  if (lane_collides(batch, game, piece_masks[type][0], 4, 1)) {
+    if (type != PIECE_I) return 1;
+    if (!lane_collides(batch, game, piece_masks[type][1], 4, 1)) {
+      batch->rot[game] = 1;
+      batch->x[game] = 3;
+      batch->y[game] = 0;
+    }
+  }
+  return lane_collides(batch, game, piece_masks[type][batch->rot[game]],
+                       batch->x[game], batch->y[game]);
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Clears filled rows of one game, as clean_rows() does
+ * @param[in] *batch Batch
+ * @param[in] game Game index
+ * @return Returns the number of rows cleared
+ */
+static int lane_clear_rows(TetrisBatch_t *batch, int game) {
+  int n = batch->size;
+  int cleared = 0;
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    if (batch->rows[j * n + game] == BOARD_FULL_ROW) {
+      for (int k = j; k > 0; k--)
+        batch->rows[k * n + game] = batch->rows[(k - 1) * n + game];
+      cleared++;
+    }
+  }
+  return cleared;
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Creates a batch of games
+ * @param[in] size Number of games
+ * @param[in] seed Seed the seeds of all games are derived from
+ * @return Returns the batch, NULL if out of memory
+ */
+TetrisBatch_t *batch_create(int size, unsigned int seed) {
+  TetrisBatch_t *batch = calloc(1, sizeof(TetrisBatch_t));
+  if (batch == NULL) return NULL;
+  batch->size = size;
+  batch->rows = calloc((size_t)size * BOARD_HEIGHT, sizeof(uint16_t));
+  batch->type = calloc(size, sizeof(uint8_t));
+  batch->rot = calloc(size, sizeof(uint8_t));
+  batch->next = calloc(size, sizeof(uint8_t));
+  batch->x = calloc(size, sizeof(int8_t));
+  batch->y = calloc(size, sizeof(int8_t));
+  batch->score = calloc(size, sizeof(int));
+  batch->level = calloc(size, sizeof(uint8_t));
+  batch->cleared = calloc(size, sizeof(uint8_t));
+  batch->locked = calloc(size, sizeof(uint8_t));
+  batch->masks = calloc((size_t)size * 4, sizeof(uint16_t));
+  batch->seed = calloc(size, sizeof(unsigned int));
+  batch->reseed = calloc(size, sizeof(unsigned int));
+  batch->full = calloc(size, sizeof(uint32_t));
+  if (!batch->rows || !batch->type || !batch->rot || !batch->next ||
+      !batch->x || !batch->y || !batch->score || !batch->level ||
+      !batch->cleared || !batch->locked || !batch->masks || !batch->seed ||
+      !batch->reseed || !batch->full) {
+    batch_free(batch);
+    return NULL;
+  }
+  for (int g = 0; g < size; g++) {
+    batch->reseed[g] = seed ^ (unsigned int)g * 2654435761u;
+    batch_reset(batch, g, rand_r(&batch->reseed[g]));
+  }
+  return batch;
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Frees a batch of games
+ * @param[in] *batch Batch, may be NULL
+ */
+void batch_free(TetrisBatch_t *batch) {
+  if (batch == NULL) return;
+  free(batch->rows);
+  free(batch->type);
+  free(batch->rot);
+  free(batch->next);
+  free(batch->x);
+  free(batch->y);
+  free(batch->score);
+  free(batch->level);
+  free(batch->cleared);
+  free(batch->locked);
+  free(batch->masks);
+  free(batch->seed);
+  free(batch->reseed);
+  free(batch->full);
+  free(batch);
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Restarts one game, as stats_init() followed by spawn_state() does
+ * @param[in] *batch Batch
+ * @param[in] game Game index
+ * @param[in] seed Seed of the piece sequence, same meaning as in stats_seed()
+ * @return Returns 1 if the first tetromino does not fit
+ */
+int batch_reset(TetrisBatch_t *batch, int game, unsigned int seed) {
+  for (int r = 0; r < BOARD_HEIGHT; r++)
+    batch->rows[r * batch->size + game] = BOARD_EMPTY_ROW;
+  batch->score[game] = 0;
+  batch->level[game] = 0;
+  batch->cleared[game] = 0;
+  batch->locked[game] = 0;
+  batch->seed[game] = seed;
+  batch->next[game] = rand_r(&batch->seed[game]) % RAND;
+  return lane_spawn(batch, game);
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Handles the signal of one game, as moving_state() does, and keeps
+ * the row masks of its tetromino
+ * @param[in] *batch Batch
+ * @param[in] game Game index
+ * @param[in] action Signal
+ */
+static void lane_signal(TetrisBatch_t *batch, int game, UserAction_t action) {
+  int n = batch->size;
+  int type = batch->type[game];
+  int rot = batch->rot[game];
+  int x = batch->x[game];
+  int y = batch->y[game];
+  int locked = 0;
+  if (action == Left || action == Right) {
+    int nx = action == Left ? x - 1 : x + 1;
+    if (!lane_collides(batch, game, piece_masks[type][rot], nx, y - 1)) x = nx;
+  } else if (action == Action && type != PIECE_O) {
+    uint16_t lane[BOARD_HEIGHT];
+    for (int r = 0; r < BOARD_HEIGHT; r++) lane[r] = batch->rows[r * n + game];
+    int kick = board_kick(lane, type, rot, x, y - 1);
+    if (kick >= 0) {
+      x += board_kicks[type][rot][kick].x;
+      y += board_kicks[type][rot][kick].y;
+      rot = (rot + 1) & 3;
+    }
+  } else if (action == Down) {
+    if (lane_collides(batch, game, piece_masks[type][rot], x, y))
+      locked = 1;
+    else
+      y++;
+  }
+  const uint8_t *mask = piece_masks[type][rot];
+  for (int j = 0; j < 4; j++)
+    batch->masks[j * n + game] = mask[j] << (x + BOARD_SHIFT);
+  batch->rot[game] = rot;
+  batch->x[game] = x;
+  batch->y[game] = y;
+  batch->locked[game] = locked;
+}
+
+/**
+ * @ingroup batch_funcs
+ * @brief Makes one step in every game of the batch
+ *
+ * After the signals, the tetromino of every game is tested one row lower,
+ * as move_down() does, the ones that cannot fall are written into the field
+ * and the filled rows are found, each a loop over all games per field row.
+ * @param[in] *batch Batch
+ * @param[in] *actions Signal for every game
+ * @param[out] *rewards Score gained by every game
+ * @param[out] *dones Set for every game that was over and restarted
+ */
+void tetris_batch_step(TetrisBatch_t *batch, const UserAction_t *actions,
+                       int *rewards, int *dones) {
+  int n = batch->size;
+  for (int g = 0; g < n; g++) lane_signal(batch, g, actions[g]);
+
+  const uint16_t *m0 = batch->masks, *m1 = m0 + n, *m2 = m1 + n, *m3 = m2 + n;
+  int8_t *ys = batch->y;
+  uint8_t *locked = batch->locked;
+  for (int g = 0; g < n; g++) {
+    int below = BOARD_HEIGHT - ys[g];
+    uint16_t out = (m3[g] & -(below < 4)) | (m2[g] & -(below < 3)) |
+                   (m1[g] & -(below < 2)) | (m0[g] & -(ys[g] < 0));
+    locked[g] |= out != 0;
+  }
+  for (int r = 0; r < BOARD_HEIGHT; r++) {
+    const uint16_t *row = batch->rows + r * n;
+    for (int g = 0; g < n; g++) {
+      int j = r - ys[g];
+      uint16_t mask = (m0[g] & -(j == 0)) | (m1[g] & -(j == 1)) |
+                      (m2[g] & -(j == 2)) | (m3[g] & -(j == 3));
+      locked[g] |= (mask & row[g]) != 0;
+    }
+  }
+  for (int g = 0; g < n; g++) ys[g] += !locked[g];
+
+  uint32_t *full = batch->full;
+  for (int g = 0; g < n; g++) full[g] = 0;
+  for (int r = 0; r < BOARD_HEIGHT; r++) {
+    uint16_t *row = batch->rows + r * n;
+    for (int g = 0; g < n; g++) {
+      int j = r + 1 - ys[g];
+      uint16_t mask = (m0[g] & -(j == 0)) | (m1[g] & -(j == 1)) |
+                      (m2[g] & -(j == 2)) | (m3[g] & -(j == 3));
+      row[g] |= mask & -locked[g];
+      full[g] |= (uint32_t)(row[g] == BOARD_FULL_ROW) << r;
+    }
+  }
+
+  for (int g = 0; g < n; g++) {
+    rewards[g] = 0;
+    dones[g] = 0;
+    batch->cleared[g] = 0;
+    if (!batch->locked[g]) continue;
+    if (full[g] != 0) batch->cleared[g] = lane_clear_rows(batch, g);
+    int cleared = batch->cleared[g] > 4 ? 4 : batch->cleared[g];
+    rewards[g] = batch_row_score[cleared];
+    batch->score[g] += rewards[g];
+    int level = batch->score[g] / 600;
+    batch->level[g] = level > 10 ? 10 : level;
+    if (lane_spawn(batch, g)) {
+      dones[g] = 1;
+      batch_reset(batch, g, rand_r(&batch->reseed[g]));
+    }
+  }
+}
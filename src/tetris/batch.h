@@ -0,0 +1,66 @@
+/**
+ * @file batch.h
+ * @brief Stepping many games at once for training bots
+ *
+ * Games are kept as a structure of arrays: every field of the game state is
+ * an array indexed by game, and the field rows are stored row-major, so row
+ * r of all games is one contiguous array. Loops over games then touch
+ * consecutive memory and the compiler can vectorize them.
+ *
+ * The signals differ from game to game, so shifts and kicked turns are made
+ * game by game. The gravity test, the attaching and the filled-row scan are
+ * the same for every game: they run row by row over all games without
+ * branches, with the row masks of every game's tetromino kept by mask row.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+#include "board.h"
+
+/**
+ * @brief Games stepped together, one lane per game
+ */
+typedef struct {
+  /// @brief Number of games
+  int size;
+  /// @brief Field rows, row r of game g is rows[r * size + g]
+  uint16_t *rows;
+  /// @brief Current tetromino type
+  uint8_t *type;
+  /// @brief Current tetromino rotation
+  uint8_t *rot;
+  /// @brief Next tetromino type
+  uint8_t *next;
+  /// @brief Position of the current tetromino at X
+  int8_t *x;
+  /// @brief Position of the current tetromino at Y
+  int8_t *y;
+  /// @brief Score
+  int *score;
+  /// @brief Level
+  uint8_t *level;
+  /// @brief Number of rows cleared by the last step
+  uint8_t *cleared;
+  /// @brief Set for games whose tetromino attached in the last step
+  uint8_t *locked;
+  /// @brief Row masks of every game's tetromino at its column, with the
+  /// columns as in rows, mask row j of game g is masks[j * size + g]
+  uint16_t *masks;
+  /// @brief State of the piece generator
+  unsigned int *seed;
+  /// @brief Source of the seeds of the following games
+  unsigned int *reseed;
+  /// @brief Filled rows of every game, bit r for row r
+  uint32_t *full;
+} TetrisBatch_t;
+
+/**
+ * @defgroup batch_funcs Batch stepping
+ */
+TetrisBatch_t *batch_create(int size, unsigned int seed);
+void batch_free(TetrisBatch_t *batch);
+int batch_reset(TetrisBatch_t *batch, int game, unsigned int seed);
+void tetris_batch_step(TetrisBatch_t *batch, const UserAction_t *actions,
+                       int *rewards, int *dones);
+
+#endif /* BATCH_H */
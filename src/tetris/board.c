@@ -0,0 +1,448 @@
+/**
+ * @file board.c
+ * @brief Bitboard representation of the field and the tetrominos
+ */
+
+#include "board.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Field bits of a row
+#define BOARD_PATTERN(row) (((row) >> BOARD_SHIFT) & (BOARD_PATTERNS - 1))
+/// Column bit of a field row
+#define BOARD_COLUMN_BIT(r) (1u << (BOARD_HEIGHT - 1 - (r)))
+/// Column bits of the whole field
+#define BOARD_COLUMN_MASK ((1u << BOARD_HEIGHT) - 1)
+
+/// Row transitions of every row pattern, filled on first use
+static uint8_t row_transitions[BOARD_PATTERNS];
+/// Guards the filling of row_transitions
+static pthread_once_t transitions_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Row masks of every tetromino in every rotation
+ *
+ * Rotation 0 is the shape returned by get_tetromino(), every next one is
+ * what rotate() makes of the previous one.
+ */
+const uint8_t piece_masks[RAND][4][4] = {
+    {{0x2, 0x2, 0x2, 0x2},
+     {0x0, 0xF, 0x0, 0x0},
+     {0x4, 0x4, 0x4, 0x4},
+     {0x0, 0x0, 0xF, 0x0}},
+    {{0x3, 0x3, 0x0, 0x0},
+     {0x3, 0x3, 0x0, 0x0},
+     {0x3, 0x3, 0x0, 0x0},
+     {0x3, 0x3, 0x0, 0x0}},
+    {{0x1, 0x7, 0x0, 0x0},
+     {0x6, 0x2, 0x2, 0x0},
+     {0x0, 0x7, 0x4, 0x0},
+     {0x2, 0x2, 0x3, 0x0}},
+    {{0x4, 0x7, 0x0, 0x0},
+     {0x2, 0x2, 0x6, 0x0},
+     {0x0, 0x7, 0x1, 0x0},
+     {0x3, 0x2, 0x2, 0x0}},
+    {{0x3, 0x6, 0x0, 0x0},
+     {0x4, 0x6, 0x2, 0x0},
+     {0x0, 0x3, 0x6, 0x0},
+     {0x2, 0x3, 0x1, 0x0}},
+    {{0x6, 0x3, 0x0, 0x0},
+     {0x2, 0x6, 0x4, 0x0},
+     {0x0, 0x6, 0x3, 0x0},
+     {0x1, 0x3, 0x2, 0x0}},
+    {{0x2, 0x7, 0x0, 0x0},
+     {0x2, 0x6, 0x2, 0x0},
+     {0x0, 0x7, 0x2, 0x0},
+     {0x2, 0x3, 0x2, 0x0}},
+};
+
+/// Kicks of the J, L, S, T and Z tetrominos
+#define BOARD_JLSTZ_KICKS                                   \
+  {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},            \
+   {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},              \
+   {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},               \
+   {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}}
+
+/**
+ * @brief Kicks of the SRS rotation system, tried in order
+ *
+ * Rotations 0 to 3 of J, L, S, T and Z are the SRS states 0, R, 2 and L.
+ * The I tetromino spawns standing, its rotations 0 to 3 are L, 0, R and 2.
+ * The O tetromino does not rotate.
+ */
+const BoardKick_t board_kicks[RAND][4][BOARD_KICKS] = {
+    {{{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}},
+     {{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}},
+     {{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}},
+     {{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}},
+    {{{0, 0}}},
+    BOARD_JLSTZ_KICKS,
+    BOARD_JLSTZ_KICKS,
+    BOARD_JLSTZ_KICKS,
+    BOARD_JLSTZ_KICKS,
+    BOARD_JLSTZ_KICKS,
+};
+
+/// piece_masks as one word a rotation, mask row j in bits 16j to 16j + 3,
+/// so a tetromino is tested against four field rows with one AND
+static const uint64_t piece_words[RAND][4] = {
+    {0x0002000200020002ull, 0x00000000000F0000ull, 0x0004000400040004ull,
+     0x0000000F00000000ull},
+    {0x0000000000030003ull, 0x0000000000030003ull, 0x0000000000030003ull,
+     0x0000000000030003ull},
+    {0x0000000000070001ull, 0x0000000200020006ull, 0x0000000400070000ull,
+     0x0000000300020002ull},
+    {0x0000000000070004ull, 0x0000000600020002ull, 0x0000000100070000ull,
+     0x0000000200020003ull},
+    {0x0000000000060003ull, 0x0000000200060004ull, 0x0000000600030000ull,
+     0x0000000100030002ull},
+    {0x0000000000030006ull, 0x0000000400060002ull, 0x0000000300060000ull,
+     0x0000000200030001ull},
+    {0x0000000000070002ull, 0x0000000200060002ull, 0x0000000200070000ull,
+     0x0000000200030002ull},
+};
+
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+               "board_window() reads four rows as one little-endian word");
+
+/**
+ * @ingroup board_funcs
+ * @brief Number of distinct rotations of a tetromino
+ * @param[in] type Tetromino type
+ * @return Returns 1 for the O tetromino, 4 for the others
+ */
+int piece_rotations(int type) { return type == PIECE_O ? 1 : 4; }
+
+/**
+ * @ingroup board_funcs
+ * @brief Finds the rotation a tetromino struct is in
+ * @param[in] *tet Tetromino
+ * @return Returns the rotation index, -1 if the shape is not a rotation of
+ * its type
+ */
+int piece_rotation(const tetromino *tet) {
+  if (tet->type < 0 || tet->type >= RAND) return -1;
+  for (int rot = 0; rot < piece_rotations(tet->type); rot++) {
+    int match = 1;
+    for (int i = 0; i < 4 && match; i++) {
+      for (int j = 0; j < 4 && match; j++) {
+        int cell = (piece_masks[tet->type][rot][j] >> i) & 1;
+        if (tet->tet[i][j] != cell) match = 0;
+      }
+    }
+    if (match) return rot;
+  }
+  return -1;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Builds the tetromino struct of a rotation
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation index
+ * @return Tetromino struct
+ */
+tetromino piece_tetromino(int type, int rot) {
+  tetromino tet = {0};
+  tet.type = type;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      tet.tet[i][j] = (piece_masks[type][rot][j] >> i) & 1;
+    }
+  }
+  return tet;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Checking the bitboard for collisions with a tetromino
+ * @param[in] *rows Field rows
+ * @param[in] *mask Row masks of the tetromino
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ * @return Returns collision status
+ */
+int board_collides(const uint16_t *rows, const uint8_t *mask, int x, int row) {
+  for (int j = 0; j < 4; j++) {
+    if (mask[j] == 0) continue;
+    int r = row + j;
+    if (r < 0 || r >= BOARD_HEIGHT || x < -BOARD_SHIFT || x >= BOARD_WIDTH)
+      return 1;
+    if (rows[r] & (mask[j] << (x + BOARD_SHIFT))) return 1;
+  }
+  return 0;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Four field rows as one word, rows outside the field filled
+ * @param[in] *rows Field rows
+ * @param[in] row First row
+ * @return Returns row row + j in bits 16j to 16j + 15
+ */
+static inline uint64_t board_window(const uint16_t *rows, int row) {
+  uint64_t window = 0;
+  if (row >= 0 && row <= BOARD_HEIGHT - 4) {
+    memcpy(&window, rows + row, sizeof(window));
+    return window;
+  }
+  for (int j = 3; j >= 0; j--) {
+    int r = row + j;
+    window <<= 16;
+    window |= r >= 0 && r < BOARD_HEIGHT ? rows[r] : BOARD_FULL_ROW;
+  }
+  return window;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Finds the kick a tetromino turns with
+ *
+ * Every kick is one test of the turned tetromino's word against the word
+ * of the four rows it would cover.
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation before the turn
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ * @return Returns the index of the first kick in board_kicks that fits, -1
+ * if none does
+ */
+int board_kick(const uint16_t *rows, int type, int rot, int x, int row) {
+  uint64_t word = piece_words[type][(rot + 1) & 3];
+  const BoardKick_t *kicks = board_kicks[type][rot];
+  for (int k = 0; k < BOARD_KICKS; k++) {
+    int kx = x + kicks[k].x;
+    if (kx < -BOARD_SHIFT || kx >= BOARD_WIDTH) continue;
+    if (!(board_window(rows, row + kicks[k].y) & word << (kx + BOARD_SHIFT)))
+      return k;
+  }
+  return -1;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Writes a tetromino into the bitboard
+ * @param[in] *rows Field rows
+ * @param[in] *mask Row masks of the tetromino
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ */
+void board_place(uint16_t *rows, const uint8_t *mask, int x, int row) {
+  for (int j = 0; j < 4; j++) {
+    int r = row + j;
+    if (mask[j] != 0 && r >= 0 && r < BOARD_HEIGHT && x >= -BOARD_SHIFT)
+      rows[r] |= mask[j] << (x + BOARD_SHIFT);
+  }
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Clears filled rows the same way clean_rows() does
+ *
+ * Rows above a filled one shift down and row 0 is left as it was.
+ * @param[in] *rows Field rows
+ * @return Returns the number of rows cleared
+ */
+int board_clear_rows(uint16_t *rows) {
+  int cleared = 0;
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    if (rows[j] == BOARD_FULL_ROW) {
+      for (int k = j; k > 0; k--) rows[k] = rows[k - 1];
+      cleared++;
+    }
+  }
+  return cleared;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Packs the field of the game stats into a bitboard
+ * @param[in] *stats Pointer to stats struct
+ * @param[out] *rows Field rows
+ */
+void board_from_field(const GameInfo_t *stats, uint16_t *rows) {
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    uint16_t row = BOARD_EMPTY_ROW;
+    for (int i = 0; i < BOARD_WIDTH; i++) {
+      if (stats->field[i][j] != 0) row |= 1 << (i + BOARD_SHIFT);
+    }
+    rows[j] = row;
+  }
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Unpacks a bitboard into the field of the game stats
+ * @param[in] *rows Field rows
+ * @param[out] *stats Pointer to stats struct
+ */
+void board_to_field(const uint16_t *rows, GameInfo_t *stats) {
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    for (int i = 0; i < BOARD_WIDTH; i++) {
+      stats->field[i][j] = (rows[j] >> (i + BOARD_SHIFT)) & 1;
+    }
+  }
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Fills the row transition table, the walls counting as filled
+ */
+static void board_transitions_init() {
+  for (int p = 0; p < BOARD_PATTERNS; p++) {
+    int row = 1 << (BOARD_WIDTH + 1) | p << 1 | 1;
+    row_transitions[p] =
+        __builtin_popcount((row ^ row >> 1) & ((2 << BOARD_WIDTH) - 1));
+  }
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Height of a column
+ * @param[in] col Column bits
+ * @return Returns the number of rows from the floor to the top cell
+ */
+static inline int board_column_height(uint32_t col) {
+  return col == 0 ? 0 : 32 - __builtin_clz(col);
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Depth of a well
+ * @param[in] *cols Columns
+ * @param[in] i Column index
+ * @return Returns how much lower the column is than the lower neighbour,
+ * 0 if it is not lower than both
+ */
+static inline int board_well(const uint32_t *cols, int i) {
+  int left = i > 0 ? board_column_height(cols[i - 1]) : BOARD_HEIGHT;
+  int right =
+      i < BOARD_WIDTH - 1 ? board_column_height(cols[i + 1]) : BOARD_HEIGHT;
+  int depth = (left < right ? left : right) - board_column_height(cols[i]);
+  return depth > 0 ? depth : 0;
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Adds or takes away what a span of columns contributes to the
+ * column features
+ *
+ * Wells and bumpiness also depend on the neighbours of the span, so their
+ * terms are taken one column further on both sides.
+ * @param[in,out] *f Features
+ * @param[in] lo First column of the span
+ * @param[in] hi Last column of the span
+ * @param[in] sign 1 to add, -1 to take away
+ */
+static void board_columns(BoardFeatures_t *f, int lo, int hi, int sign) {
+  for (int i = lo; i <= hi; i++) {
+    uint32_t col = f->cols[i];
+    int height = board_column_height(col);
+    f->height += sign * height;
+    f->holes += sign * (height - __builtin_popcount(col));
+    f->col_transitions +=
+        sign * __builtin_popcount(((col << 1 | 1) ^ col) & BOARD_COLUMN_MASK);
+  }
+  for (int i = lo > 0 ? lo - 1 : 0; i <= hi + 1 && i < BOARD_WIDTH; i++)
+    f->wells += sign * board_well(f->cols, i);
+  for (int i = lo > 0 ? lo : 1; i <= hi + 1 && i < BOARD_WIDTH; i++)
+    f->bumpiness += sign * abs(board_column_height(f->cols[i]) -
+                               board_column_height(f->cols[i - 1]));
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Computes the features of a bitboard from scratch
+ *
+ * Needed once before board_features_place() and board_features_clear()
+ * keep the features up to date.
+ * @param[in] *rows Field rows
+ * @param[out] *features Features
+ */
+void board_features(const uint16_t *rows, BoardFeatures_t *features) {
+  pthread_once(&transitions_once, board_transitions_init);
+  memset(features, 0, sizeof(BoardFeatures_t));
+  for (int r = 0; r < BOARD_HEIGHT; r++) {
+    int pattern = BOARD_PATTERN(rows[r]);
+    features->row_transitions += row_transitions[pattern];
+    for (; pattern != 0; pattern &= pattern - 1)
+      features->cols[__builtin_ctz(pattern)] |= BOARD_COLUMN_BIT(r);
+  }
+  board_columns(features, 0, BOARD_WIDTH - 1, 1);
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Writes a tetromino into the bitboard as board_place() does,
+ * updating the features
+ *
+ * Only the rows and columns the tetromino covers are looked at, and the
+ * neighbouring columns for wells and bumpiness.
+ * @param[in,out] *rows Field rows
+ * @param[in,out] *features Features of the rows
+ * @param[in] *mask Row masks of the tetromino
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ */
+void board_features_place(uint16_t *rows, BoardFeatures_t *features,
+                          const uint8_t *mask, int x, int row) {
+  uint16_t cells[4] = {0};
+  uint16_t used = 0;
+  for (int j = 0; j < 4; j++) {
+    int r = row + j;
+    if (mask[j] == 0 || r < 0 || r >= BOARD_HEIGHT || x < -BOARD_SHIFT)
+      continue;
+    cells[j] = BOARD_PATTERN(mask[j] << (x + BOARD_SHIFT)) &
+               ~BOARD_PATTERN(rows[r]);
+    used |= cells[j];
+  }
+  if (used == 0) return;
+  int lo = __builtin_ctz(used);
+  int hi = 31 - __builtin_clz(used);
+  board_columns(features, lo, hi, -1);
+  for (int j = 0; j < 4; j++) {
+    if (cells[j] == 0) continue;
+    int r = row + j;
+    int old = BOARD_PATTERN(rows[r]);
+    rows[r] |= cells[j] << BOARD_SHIFT;
+    features->row_transitions +=
+        row_transitions[old | cells[j]] - row_transitions[old];
+    for (int bits = cells[j]; bits != 0; bits &= bits - 1)
+      features->cols[__builtin_ctz(bits)] |= BOARD_COLUMN_BIT(r);
+  }
+  board_columns(features, lo, hi, 1);
+}
+
+/**
+ * @ingroup board_funcs
+ * @brief Clears filled rows as board_clear_rows() does, updating the
+ * features
+ *
+ * A cleared row takes its transitions with it and row 0 is repeated, so the
+ * row transitions change by a table lookup. Every column loses the bit of
+ * the row and its column features are recounted.
+ * @param[in,out] *rows Field rows
+ * @param[in,out] *features Features of the rows
+ * @return Returns the number of rows cleared
+ */
+int board_features_clear(uint16_t *rows, BoardFeatures_t *features) {
+  int cleared = 0;
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    if (rows[j] != BOARD_FULL_ROW) continue;
+    if (cleared++ == 0) board_columns(features, 0, BOARD_WIDTH - 1, -1);
+    for (int k = j; k > 0; k--) rows[k] = rows[k - 1];
+    features->row_transitions += row_transitions[BOARD_PATTERN(rows[0])] -
+                                 row_transitions[BOARD_PATTERNS - 1];
+    uint32_t below = BOARD_COLUMN_BIT(j) - 1;
+    uint32_t top = BOARD_COLUMN_BIT(0);
+    for (int i = 0; i < BOARD_WIDTH; i++) {
+      uint32_t col = features->cols[i];
+      features->cols[i] = (col & below) | (col >> 1 & ~below) | (col & top);
+    }
+  }
+  if (cleared) board_columns(features, 0, BOARD_WIDTH - 1, 1);
+  return cleared;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file board.h
+ * @brief Bitboard representation of the field and the tetrominos
+ *
+ * A row of the field is one 16-bit word: column x lives in bit
+ * x + BOARD_SHIFT and the bits outside the 10 columns are set, acting as
+ * walls. A tetromino in a given rotation is four 4-bit row masks, bit i of
+ * row j being cell tet[i][j] of the tetromino struct.
+ *
+ * Tetrominos turn clockwise by the SRS rotation system: a turn that does
+ * not fit in place is tried at the offsets of board_kicks, and the first
+ * one that fits is taken.
+ *
+ * The features the bots evaluate a board by can be kept up to date while
+ * tetrominos are placed and rows cleared. A placement only touches the rows
+ * and columns it covers and their neighbours: row transitions come from a
+ * table indexed by the 10-bit row pattern, the column features from the
+ * column read as a bit mask.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+#include <stdint.h>
+
+#include "tetris.h"
+
+/// Number of columns of the field
+#define BOARD_WIDTH 10
+/// Number of rows of the field
+#define BOARD_HEIGHT 20
+/// Bit of the row word holding column 0
+#define BOARD_SHIFT 3
+/// Row without any cells, only the walls are set
+#define BOARD_EMPTY_ROW 0xE007
+/// Row with all 10 columns filled
+#define BOARD_FULL_ROW 0xFFFF
+/// Type of the I tetromino
+#define PIECE_I 0
+/// Type of the O tetromino, the only one that does not rotate
+#define PIECE_O 1
+
+/// Kicks tried for every turn, the first one is no offset
+#define BOARD_KICKS 5
+
+/// Number of 10-bit row patterns
+#define BOARD_PATTERNS (1 << BOARD_WIDTH)
+
+/**
+ * @brief Features of a board, kept up to date by the board functions
+ */
+typedef struct {
+  /// @brief Columns, bit b is field row BOARD_HEIGHT - 1 - b
+  uint32_t cols[BOARD_WIDTH];
+  /// @brief Sum of the column heights
+  int height;
+  /// @brief Empty cells under the top of their column
+  int holes;
+  /// @brief Changes between filled and empty along the rows, walls filled
+  int row_transitions;
+  /// @brief Changes between filled and empty along the columns, floor
+  /// filled
+  int col_transitions;
+  /// @brief Sum of the depths of the columns lower than both neighbours,
+  /// walls as high as the field
+  int wells;
+  /// @brief Sum of the height differences of neighbouring columns
+  int bumpiness;
+} BoardFeatures_t;
+
+/**
+ * @brief Offset of a kick, y growing downwards as the field rows do
+ */
+typedef struct {
+  /// @brief Columns
+  int8_t x;
+  /// @brief Rows
+  int8_t y;
+} BoardKick_t;
+
+extern const uint8_t piece_masks[RAND][4][4];
+extern const BoardKick_t board_kicks[RAND][4][BOARD_KICKS];
+
+/**
+ * @defgroup board_funcs Bitboard
+ */
+int piece_rotations(int type);
+int piece_rotation(const tetromino *tet);
+tetromino piece_tetromino(int type, int rot);
+int board_collides(const uint16_t *rows, const uint8_t *mask, int x, int row);
+int board_kick(const uint16_t *rows, int type, int rot, int x, int row);
+void board_place(uint16_t *rows, const uint8_t *mask, int x, int row);
+int board_clear_rows(uint16_t *rows);
+void board_from_field(const GameInfo_t *stats, uint16_t *rows);
+void board_to_field(const uint16_t *rows, GameInfo_t *stats);
+void board_features(const uint16_t *rows, BoardFeatures_t *features);
+void board_features_place(uint16_t *rows, BoardFeatures_t *features,
+                          const uint8_t *mask, int x, int row);
+int board_features_clear(uint16_t *rows, BoardFeatures_t *features);
+
+#endif /* BOARD_H */
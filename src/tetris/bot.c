@@ -0,0 +1,696 @@
+/**
+ * @file bot.c
+ * @brief Autoplayer: greedy and expectimax search over tetromino placements
+ *
+ * Placements come from the move generator, which follows the reference
+ * engine's collision rules, so every placement found can be reached with
+ * userInput(). The signals leading there are only worked out for the
+ * placement finally chosen.
+ */
+
+#include "bot.h"
+
+#include <string.h>
+
+/// Weight of the sum of the column heights
+#define BOT_HEIGHT_WEIGHT -0.510066
+/// Weight of the number of rows cleared on the way
+#define BOT_LINES_WEIGHT 0.760666
+/// Weight of the number of empty cells under the top of their column
+#define BOT_HOLES_WEIGHT -0.35663
+/// Weight of the sum of the height differences of neighbouring columns
+#define BOT_BUMPINESS_WEIGHT -0.184483
+/// Placements evaluated between two looks at the clock
+#define BOT_CLOCK_NODES 1024
+
+/**
+ * @brief Search shared out between the threads of the pool
+ *
+ * Every item is a placement of the current tetromino followed by one of the
+ * next tetromino, the chance nodes below an item are searched by whichever
+ * thread takes it.
+ */
+typedef struct BotJob {
+  /// @brief Move generator run for the current tetromino
+  MoveGen_t gen;
+  /// @brief Move generator workspace for the next tetromino
+  MoveGen_t scratch;
+  /// @brief Placements of the current tetromino
+  Placement_t first[BOT_MAX_PLACEMENTS];
+  /// @brief Number of placements of the current tetromino
+  int first_count;
+  /// @brief Placements of the next tetromino
+  Placement_t second[BOT_MAX_PLACEMENTS * BOT_MAX_PLACEMENTS];
+  /// @brief Placement of the current tetromino every item follows
+  int parent[BOT_MAX_PLACEMENTS * BOT_MAX_PLACEMENTS];
+  /// @brief Value of every item
+  double value[BOT_MAX_PLACEMENTS * BOT_MAX_PLACEMENTS];
+  /// @brief Number of items
+  int count;
+  /// @brief Depth of the search
+  int depth;
+  /// @brief Time the search must stop at, us, 0 for none
+  long deadline_us;
+  /// @brief Counter that stops the search once it moves off watched, NULL
+  /// for none
+  const unsigned long *watch;
+  /// @brief Value of watch the search is run for
+  unsigned long watched;
+  /// @brief Index of the next item nobody has taken yet
+  int next_item;
+  /// @brief Set when the deadline passed and the values are incomplete
+  int aborted;
+  /// @brief Placements evaluated
+  long nodes;
+} BotJob_t;
+
+/**
+ * @brief Search state of one thread
+ */
+typedef struct {
+  /// @brief Job being run
+  BotJob_t *job;
+  /// @brief Placements evaluated by this thread
+  long nodes;
+  /// @brief Move generator workspace of this thread
+  MoveGen_t gen;
+} BotSearch_t;
+
+/**
+ * @ingroup bot_funcs
+ * @brief Finds where a tetromino appears, as spawn_state() does
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @param[out] *rot Rotation of the tetromino
+ * @param[out] *x Position of the tetromino at X
+ * @param[out] *y Position of the tetromino at Y
+ * @return Returns 1 if the tetromino does not fit and the game is over
+ */
+int bot_spawn(const uint16_t *rows, int type, int *rot, int *x, int *y) {
+  *rot = 0;
+  *x = 4;
+  *y = 1;
+  if (board_collides(rows, piece_masks[type][0], 4, 1)) {
+    if (type != PIECE_I) return 1;
+    if (!board_collides(rows, piece_masks[type][1], 4, 1)) {
+      *rot = 1;
+      *x = 3;
+      *y = 0;
+    }
+  }
+  return board_collides(rows, piece_masks[type][*rot], *x, *y);
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief All placements of a tetromino on a board whose features are known
+ *
+ * The features of every placement are updated from those of the board, so
+ * evaluating it takes no look at the rows.
+ * @param[in] *gen Move generator workspace, keeps the search for
+ * bot_fill_path()
+ * @param[in] *rows Field rows
+ * @param[in] *features Features of rows
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation of the tetromino
+ * @param[in] x Position of the tetromino at X
+ * @param[in] y Position of the tetromino at Y
+ * @param[out] *out Placements, BOT_MAX_PLACEMENTS at most
+ * @return Returns the number of placements
+ */
+static int bot_expand(MoveGen_t *gen, const uint16_t *rows,
+                      const BoardFeatures_t *features, int type, int rot,
+                      int x, int y, Placement_t *out) {
+  int count = movegen_run(gen, rows, type, rot, x, y);
+  if (count > BOT_MAX_PLACEMENTS) count = BOT_MAX_PLACEMENTS;
+  for (int k = 0; k < count; k++) {
+    const MoveLock_t *lock = &gen->locks[k];
+    Placement_t *p = &out[k];
+    memcpy(p->rows, rows, sizeof(p->rows));
+    p->features = *features;
+    board_features_place(p->rows, &p->features, piece_masks[type][lock->rot],
+                         lock->x, lock->y - 1);
+    p->lines = board_features_clear(p->rows, &p->features);
+    p->rot = lock->rot;
+    p->x = lock->x;
+    p->y = lock->y;
+    p->lock = k;
+    p->path_len = 0;
+  }
+  return count;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief All placements of a tetromino reachable from its position
+ * @param[in] *gen Move generator workspace, keeps the search for
+ * bot_fill_path()
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation of the tetromino
+ * @param[in] x Position of the tetromino at X
+ * @param[in] y Position of the tetromino at Y
+ * @param[out] *out Placements, BOT_MAX_PLACEMENTS at most
+ * @return Returns the number of placements
+ */
+int bot_placements(MoveGen_t *gen, const uint16_t *rows, int type, int rot,
+                   int x, int y, Placement_t *out) {
+  BoardFeatures_t features;
+  board_features(rows, &features);
+  return bot_expand(gen, rows, &features, type, rot, x, y, out);
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Works out the signals leading to a chosen placement
+ *
+ * A path too long to store is left empty, bot_execute() then just drops
+ * the tetromino.
+ * @param[in] *gen Move generator run the placement came from
+ * @param[in] *placement Placement
+ */
+static void bot_fill_path(const MoveGen_t *gen, Placement_t *placement) {
+  UserAction_t path[BOT_MAX_PATH];
+  int len = movegen_path(gen, placement->lock, path, BOT_MAX_PATH);
+  placement->path_len = len > 0 ? len : 0;
+  for (int i = 0; i < placement->path_len; i++) placement->path[i] = path[i];
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Board evaluation, the higher the better
+ * @param[in] *rows Field rows
+ * @param[in] lines Rows cleared on the way to this board
+ * @return Weighted sum of heights, cleared rows, holes and bumpiness
+ */
+double bot_evaluate(const uint16_t *rows, int lines) {
+  int heights[BOARD_WIDTH] = {0};
+  const uint16_t field = (uint16_t)~BOARD_EMPTY_ROW;
+  uint16_t seen = 0;
+  int holes = 0;
+  for (int r = 0; r < BOARD_HEIGHT; r++) {
+    uint16_t filled = rows[r] & field;
+    holes += __builtin_popcount(seen & ~filled);
+    for (uint16_t top = filled & ~seen; top != 0; top &= top - 1)
+      heights[__builtin_ctz(top) - BOARD_SHIFT] = BOARD_HEIGHT - r;
+    seen |= filled;
+  }
+  int height = heights[0];
+  int bumpiness = 0;
+  for (int i = 1; i < BOARD_WIDTH; i++) {
+    height += heights[i];
+    bumpiness += abs(heights[i] - heights[i - 1]);
+  }
+  return BOT_HEIGHT_WEIGHT * height + BOT_LINES_WEIGHT * lines +
+         BOT_HOLES_WEIGHT * holes + BOT_BUMPINESS_WEIGHT * bumpiness;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Board evaluation from the kept features, equal to bot_evaluate()
+ * @param[in] *features Features of the board
+ * @param[in] lines Rows cleared on the way to this board
+ * @return Weighted sum of heights, cleared rows, holes and bumpiness
+ */
+double bot_evaluate_features(const BoardFeatures_t *features, int lines) {
+  return BOT_HEIGHT_WEIGHT * features->height + BOT_LINES_WEIGHT * lines +
+         BOT_HOLES_WEIGHT * features->holes +
+         BOT_BUMPINESS_WEIGHT * features->bumpiness;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Placements of the current tetromino of a game
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] *gen Move generator workspace
+ * @param[out] *out Placements, BOT_MAX_PLACEMENTS at most
+ * @return Returns the number of placements
+ */
+static int bot_first(const GameInfo_t *stats, MoveGen_t *gen,
+                     Placement_t *out) {
+  int rot = piece_rotation(&stats->current_tetromino);
+  if (rot < 0) return 0;
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(stats, rows);
+  return bot_placements(gen, rows, stats->current_tetromino.type, rot,
+                        stats->cur_x, stats->cur_y, out);
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Placement with the best board evaluation
+ * @param[in] *list Placements
+ * @param[in] count Number of placements, at least 1
+ * @return Returns the index of the best placement
+ */
+static int bot_best_board(const Placement_t *list, int count) {
+  int best = 0;
+  double best_value = BOT_LOSS;
+  for (int i = 0; i < count; i++) {
+    double value = bot_evaluate_features(&list[i].features, list[i].lines);
+    if (value > best_value) {
+      best_value = value;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Greedy choice: the placement of the current tetromino leaving the
+ * best board
+ * @param[in] *stats Pointer to stats struct
+ * @param[out] *best Chosen placement
+ * @return Returns 0 on success, 1 if the tetromino cannot be placed
+ */
+int bot_greedy(const GameInfo_t *stats, Placement_t *best) {
+  MoveGen_t gen;
+  Placement_t list[BOT_MAX_PLACEMENTS];
+  int count = bot_first(stats, &gen, list);
+  if (count == 0) return 1;
+  *best = list[bot_best_board(list, count)];
+  bot_fill_path(&gen, best);
+  return 0;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Placement reached by rotating, shifting and dropping straight down
+ *
+ * Follows the collision rules of the move generator: turns are kicked as
+ * rotate() kicks them, shifts are checked one row above the position.
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation of the tetromino
+ * @param[in] x Position of the tetromino at X
+ * @param[in] y Position of the tetromino at Y
+ * @param[in] to_rot Rotation to attach in
+ * @param[in] to_x Position at X to attach in
+ * @param[out] *out Placement with its signals
+ * @return Returns 0 on success, 1 if the way is blocked
+ */
+static int bot_drop(const uint16_t *rows, int type, int rot, int x, int y,
+                    int to_rot, int to_x, Placement_t *out) {
+  int len = 0;
+  for (; rot != to_rot; rot = (rot + 1) & 3) {
+    int kick = type == PIECE_O ? -1 : board_kick(rows, type, rot, x, y - 1);
+    if (kick < 0) return 1;
+    x += board_kicks[type][rot][kick].x;
+    y += board_kicks[type][rot][kick].y;
+    out->path[len++] = Action;
+  }
+  const uint8_t *mask = piece_masks[type][rot];
+  for (int step = to_x < x ? -1 : 1; x != to_x; x += step) {
+    if (board_collides(rows, mask, x + step, y - 1)) return 1;
+    out->path[len++] = step < 0 ? Left : Right;
+  }
+  for (; !board_collides(rows, mask, x, y); y++) out->path[len++] = Down;
+  out->path[len++] = Down;
+  memcpy(out->rows, rows, sizeof(out->rows));
+  board_place(out->rows, mask, x, y - 1);
+  out->lines = board_clear_rows(out->rows);
+  board_features(out->rows, &out->features);
+  out->rot = rot;
+  out->x = x;
+  out->y = y;
+  out->lock = -1;
+  out->path_len = len;
+  return 0;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Greedy choice through a placement cache
+ *
+ * On a hit, the first cached placement that can be dropped into place is
+ * taken without a search. Otherwise the greedy search runs and its best
+ * placements are stored for the surface.
+ * @param[in] *cache Cache, may be shared with other threads
+ * @param[in] *stats Pointer to stats struct
+ * @param[out] *best Chosen placement
+ * @return Returns 0 on success, 1 if the tetromino cannot be placed
+ */
+int bot_greedy_cached(PlaceCache_t *cache, const GameInfo_t *stats,
+                      Placement_t *best) {
+  int type = stats->current_tetromino.type;
+  int rot = piece_rotation(&stats->current_tetromino);
+  if (rot < 0) return 1;
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(stats, rows);
+  PlaceCacheEntry_t entry;
+  entry.key = place_cache_key(rows, type);
+  if (place_cache_lookup(cache, entry.key, &entry) == 0) {
+    for (int k = 0; k < entry.count; k++) {
+      if (bot_drop(rows, type, rot, stats->cur_x, stats->cur_y, entry.rot[k],
+                   entry.x[k], best) == 0)
+        return 0;
+    }
+    __atomic_fetch_add(&cache->stale, 1, __ATOMIC_RELAXED);
+  }
+
+  MoveGen_t gen;
+  Placement_t list[BOT_MAX_PLACEMENTS];
+  double value[BOT_MAX_PLACEMENTS];
+  int count = bot_placements(&gen, rows, type, rot, stats->cur_x,
+                             stats->cur_y, list);
+  if (count == 0) return 1;
+  for (int i = 0; i < count; i++)
+    value[i] = bot_evaluate_features(&list[i].features, list[i].lines);
+  entry.count = 0;
+  for (int k = 0; k < PLACE_CACHE_KEEP && k < count; k++) {
+    int top = -1;
+    for (int i = 0; i < count; i++)
+      if (value[i] > BOT_LOSS && (top < 0 || value[i] > value[top])) top = i;
+    if (top < 0) break;
+    if (k == 0) *best = list[top];
+    entry.value[k] = value[top];
+    entry.rot[k] = list[top].rot;
+    entry.x[k] = list[top].x;
+    entry.count++;
+    value[top] = BOT_LOSS;
+  }
+  place_cache_store(cache, &entry);
+  bot_fill_path(&gen, best);
+  return 0;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Placement of the current tetromino in a given rotation and column
+ *
+ * Dropped straight down if the way is free, otherwise the first placement
+ * in that rotation and column the move generator reaches, tucks included.
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] rot Rotation to attach in
+ * @param[in] x Position at X to attach in
+ * @param[out] *out Placement with its signals
+ * @return Returns 0 on success, 1 if the placement cannot be reached
+ */
+int bot_place(const GameInfo_t *stats, int rot, int x, Placement_t *out) {
+  int type = stats->current_tetromino.type;
+  int from = piece_rotation(&stats->current_tetromino);
+  if (from < 0 || rot < 0 || rot >= piece_rotations(type) ||
+      x < -BOARD_SHIFT || x >= BOARD_WIDTH)
+    return 1;
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(stats, rows);
+  if (bot_drop(rows, type, from, stats->cur_x, stats->cur_y, rot, x, out) == 0)
+    return 0;
+  MoveGen_t gen;
+  Placement_t list[BOT_MAX_PLACEMENTS];
+  int count = bot_placements(&gen, rows, type, from, stats->cur_x,
+                             stats->cur_y, list);
+  for (int i = 0; i < count; i++) {
+    if (list[i].rot != rot || list[i].x != x) continue;
+    *out = list[i];
+    bot_fill_path(&gen, out);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Counts an evaluated placement, stopping the job past its deadline
+ * or once the watched counter moves
+ * @param[in] *search Search state of the thread
+ */
+static void bot_count_node(BotSearch_t *search) {
+  if (++search->nodes % BOT_CLOCK_NODES != 0) return;
+  const BotJob_t *job = search->job;
+  if ((job->deadline_us && get_time_us() > job->deadline_us) ||
+      (job->watch != NULL &&
+       __atomic_load_n(job->watch, __ATOMIC_RELAXED) != job->watched))
+    __atomic_store_n(&search->job->aborted, 1, __ATOMIC_RELAXED);
+}
+
+static double bot_chance(BotSearch_t *search, const uint16_t *rows,
+                         const BoardFeatures_t *features, int depth,
+                         int lines);
+
+/**
+ * @ingroup bot_funcs
+ * @brief Max node: value of the best placement of a tetromino
+ * @param[in] *search Search state of the thread
+ * @param[in] *rows Field rows
+ * @param[in] *features Features of rows
+ * @param[in] type Tetromino type
+ * @param[in] depth Tetrominos left to place, this one included
+ * @param[in] lines Rows cleared on the way to this board
+ * @return Value of the best placement, BOT_LOSS if the tetromino does not
+ * fit
+ */
+static double bot_max(BotSearch_t *search, const uint16_t *rows,
+                      const BoardFeatures_t *features, int type, int depth,
+                      int lines) {
+  int rot, x, y;
+  if (bot_spawn(rows, type, &rot, &x, &y)) return BOT_LOSS;
+  Placement_t list[BOT_MAX_PLACEMENTS];
+  int count =
+      bot_expand(&search->gen, rows, features, type, rot, x, y, list);
+  double best = BOT_LOSS;
+  for (int i = 0; i < count; i++) {
+    if (__atomic_load_n(&search->job->aborted, __ATOMIC_RELAXED)) break;
+    int total = lines + list[i].lines;
+    double value = depth > 1 ? bot_chance(search, list[i].rows,
+                                          &list[i].features, depth - 1, total)
+                             : bot_evaluate_features(&list[i].features, total);
+    bot_count_node(search);
+    if (value > best) best = value;
+  }
+  return best;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Chance node: average over every tetromino that may come next
+ * @param[in] *search Search state of the thread
+ * @param[in] *rows Field rows
+ * @param[in] *features Features of rows
+ * @param[in] depth Tetrominos left to place
+ * @param[in] lines Rows cleared on the way to this board
+ * @return Expected value of the board
+ */
+static double bot_chance(BotSearch_t *search, const uint16_t *rows,
+                         const BoardFeatures_t *features, int depth,
+                         int lines) {
+  double sum = 0;
+  for (int type = 0; type < RAND; type++)
+    sum += bot_max(search, rows, features, type, depth, lines);
+  return sum / RAND;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Takes items of the job until none are left
+ * @param[in] *job Job being run
+ */
+static void bot_run_job(BotJob_t *job) {
+  static __thread BotSearch_t search;
+  search.job = job;
+  search.nodes = 0;
+  while (!__atomic_load_n(&job->aborted, __ATOMIC_RELAXED)) {
+    int k = __atomic_fetch_add(&job->next_item, 1, __ATOMIC_RELAXED);
+    if (k >= job->count) break;
+    const Placement_t *item = &job->second[k];
+    int lines = job->first[job->parent[k]].lines + item->lines;
+    job->value[k] = job->depth > 2
+                        ? bot_chance(&search, item->rows, &item->features,
+                                     job->depth - 2, lines)
+                        : bot_evaluate_features(&item->features, lines);
+    bot_count_node(&search);
+  }
+  __atomic_fetch_add(&job->nodes, search.nodes, __ATOMIC_RELAXED);
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Worker thread of the pool
+ * @param[in] *arg Bot
+ * @return NULL
+ */
+static void *bot_worker(void *arg) {
+  Bot_t *bot = arg;
+  unsigned long seen = 0;
+  pthread_mutex_lock(&bot->lock);
+  while (1) {
+    while (!bot->stop && bot->generation == seen)
+      pthread_cond_wait(&bot->wake, &bot->lock);
+    if (bot->stop) break;
+    seen = bot->generation;
+    pthread_mutex_unlock(&bot->lock);
+    bot_run_job(bot->job);
+    pthread_mutex_lock(&bot->lock);
+    if (--bot->busy == 0) pthread_cond_signal(&bot->idle);
+  }
+  pthread_mutex_unlock(&bot->lock);
+  return NULL;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Runs the job on every thread of the pool and waits for it
+ * @param[in] *bot Bot
+ */
+static void bot_dispatch(Bot_t *bot) {
+  pthread_mutex_lock(&bot->lock);
+  bot->busy = bot->started;
+  bot->generation++;
+  pthread_cond_broadcast(&bot->wake);
+  pthread_mutex_unlock(&bot->lock);
+  bot_run_job(bot->job);
+  pthread_mutex_lock(&bot->lock);
+  while (bot->busy > 0) pthread_cond_wait(&bot->idle, &bot->lock);
+  pthread_mutex_unlock(&bot->lock);
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Creates an expectimax bot and starts its threads
+ *
+ * If some threads cannot be started, the bot searches with fewer.
+ * @param[in] *config Search settings
+ * @return Returns the bot, NULL if out of memory
+ */
+Bot_t *bot_create(const BotConfig_t *config) {
+  Bot_t *bot = calloc(1, sizeof(Bot_t));
+  if (bot == NULL) return NULL;
+  bot->job = calloc(1, sizeof(BotJob_t));
+  if (bot->job == NULL) {
+    free(bot);
+    return NULL;
+  }
+  bot->config = *config;
+  if (bot->config.depth < 1) bot->config.depth = 1;
+  if (bot->config.threads < 1) bot->config.threads = 1;
+  if (bot->config.threads > BOT_MAX_THREADS)
+    bot->config.threads = BOT_MAX_THREADS;
+  pthread_mutex_init(&bot->lock, NULL);
+  pthread_cond_init(&bot->wake, NULL);
+  pthread_cond_init(&bot->idle, NULL);
+  while (bot->started < bot->config.threads - 1 &&
+         pthread_create(&bot->workers[bot->started], NULL, bot_worker, bot) ==
+             0)
+    bot->started++;
+  return bot;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Stops the threads of a bot and frees it
+ * @param[in] *bot Bot, may be NULL
+ */
+void bot_free(Bot_t *bot) {
+  if (bot == NULL) return;
+  pthread_mutex_lock(&bot->lock);
+  bot->stop = 1;
+  pthread_cond_broadcast(&bot->wake);
+  pthread_mutex_unlock(&bot->lock);
+  for (int i = 0; i < bot->started; i++) pthread_join(bot->workers[i], NULL);
+  pthread_mutex_destroy(&bot->lock);
+  pthread_cond_destroy(&bot->wake);
+  pthread_cond_destroy(&bot->idle);
+  free(bot->job);
+  free(bot);
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Lists the placements of the next tetromino after every placement
+ * of the current one as the items of the job
+ * @param[in] *job Job
+ * @param[in] next Type of the next tetromino
+ */
+static void bot_fill_items(BotJob_t *job, int next) {
+  job->count = 0;
+  for (int i = 0; i < job->first_count; i++) {
+    int rot, x, y;
+    const uint16_t *rows = job->first[i].rows;
+    if (bot_spawn(rows, next, &rot, &x, &y)) continue;
+    int count = bot_expand(&job->scratch, rows, &job->first[i].features, next,
+                           rot, x, y, &job->second[job->count]);
+    for (int k = 0; k < count; k++) job->parent[job->count + k] = i;
+    job->count += count;
+  }
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Placement of the current tetromino with the best item below it
+ * @param[in] *job Finished job
+ * @return Returns the index of the placement
+ */
+static int bot_best_item(const BotJob_t *job) {
+  double values[BOT_MAX_PLACEMENTS];
+  for (int i = 0; i < job->first_count; i++) values[i] = 2 * BOT_LOSS;
+  for (int k = 0; k < job->count; k++) {
+    if (job->value[k] > values[job->parent[k]])
+      values[job->parent[k]] = job->value[k];
+  }
+  int best = 0;
+  for (int i = 1; i < job->first_count; i++) {
+    if (values[i] > values[best]) best = i;
+  }
+  return best;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Expectimax choice of the placement of the current tetromino
+ *
+ * The search deepens one level at a time while the time budget lasts and
+ * the watched counter, if any, stays put; the choice of the deepest level
+ * completed is returned.
+ * @param[in] *bot Bot
+ * @param[in] *stats Pointer to stats struct
+ * @param[out] *best Chosen placement
+ * @return Returns 0 on success, 1 if the tetromino cannot be placed
+ */
+int bot_search(Bot_t *bot, const GameInfo_t *stats, Placement_t *best) {
+  long start = get_time_us();
+  BotJob_t *job = bot->job;
+  job->first_count = bot_first(stats, &job->gen, job->first);
+  if (job->first_count == 0) return 1;
+  int choice = bot_best_board(job->first, job->first_count);
+  long nodes = job->first_count;
+  bot->depth_reached = 1;
+  if (bot->config.depth > 1) bot_fill_items(job, stats->next_tetromino.type);
+  for (int depth = 2; depth <= bot->config.depth && job->count > 0; depth++) {
+    job->depth = depth;
+    job->next_item = 0;
+    job->aborted = 0;
+    job->nodes = 0;
+    job->deadline_us =
+        bot->config.budget_us > 0 ? start + bot->config.budget_us : 0;
+    job->watch = bot->watch;
+    job->watched = bot->watched;
+    bot_dispatch(bot);
+    nodes += job->nodes;
+    if (job->aborted) break;
+    choice = bot_best_item(job);
+    bot->depth_reached = depth;
+  }
+  *best = job->first[choice];
+  bot_fill_path(&job->gen, best);
+  bot->nodes += nodes;
+  bot->elapsed_us += get_time_us() - start;
+  return 0;
+}
+
+/**
+ * @ingroup bot_funcs
+ * @brief Plays a placement on the game bound to this thread
+ *
+ * Gives the signals of the placement through userInput(), then lets the
+ * tetromino attach and the next one spawn.
+ * @param[in] *state Current game state, MOVING
+ * @param[in] *placement Placement of the current tetromino
+ */
+void bot_execute(FSM_STATES_g *state, const Placement_t *placement) {
+  for (int i = 0; i < placement->path_len && *state == MOVING; i++)
+    userInput(state, placement->path[i]);
+  while (*state == MOVING) userInput(state, Down);
+  if (*state == ATTACHING) userInput(state, 0);
+  if (*state == SPAWN) userInput(state, 0);
+}
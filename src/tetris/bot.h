@@ -0,0 +1,125 @@
+/**
+ * @file bot.h
+ * @brief Autoplayer: greedy and expectimax search over tetromino placements
+ *
+ * A placement is a position a tetromino can attach in, as found by the move
+ * generator, slides and spins included. The greedy bot picks the placement
+ * of the current tetromino with the best board evaluation. The expectimax
+ * bot also places the known next tetromino and then averages over all RAND
+ * tetrominos that may follow, one chance layer per extra level of depth.
+ * The chance nodes are shared out between the threads of a pool. The cached
+ * greedy bot first looks the surface up in a placement cache and only
+ * searches when none of the cached placements can be dropped into place.
+ */
+
+#ifndef BOT_H
+#define BOT_H
+#include <pthread.h>
+
+#include "movegen.h"
+#include "placecache.h"
+
+/// Most placements of one tetromino kept by the bots, all the move generator
+/// finds
+#define BOT_MAX_PLACEMENTS MOVEGEN_MAX_LOCKS
+/// Longest signal sequence of a placement
+#define BOT_MAX_PATH 64
+/// Most threads searching for one bot, the calling one included
+#define BOT_MAX_THREADS 16
+/// Value of a board on which the next tetromino does not fit
+#define BOT_LOSS -1e9
+
+/**
+ * @brief Tetromino placement and the inputs leading to it
+ */
+typedef struct {
+  /// @brief Field rows after the tetromino attached and rows were cleared
+  uint16_t rows[BOARD_HEIGHT];
+  /// @brief Number of rows cleared
+  int lines;
+  /// @brief Features of rows
+  BoardFeatures_t features;
+  /// @brief Rotation of the tetromino
+  int rot;
+  /// @brief Position of the tetromino at X
+  int x;
+  /// @brief Position of the tetromino at Y when it attached
+  int y;
+  /// @brief Index of the attach position in the move generator
+  int lock;
+  /// @brief Number of signals in path, 0 until the placement is chosen
+  int path_len;
+  /// @brief Shortest signal sequence leading to the placement
+  uint8_t path[BOT_MAX_PATH];
+} Placement_t;
+
+/**
+ * @brief Search settings of the expectimax bot
+ */
+typedef struct {
+  /// @brief Tetrominos placed in the search: 1 is greedy, 2 adds the next
+  /// one, every further level averages over all tetrominos
+  int depth;
+  /// @brief Time limit of one search, us, 0 for none
+  long budget_us;
+  /// @brief Number of searching threads, the calling one included
+  int threads;
+} BotConfig_t;
+
+struct BotJob;
+
+/**
+ * @brief Expectimax bot with its thread pool
+ */
+typedef struct {
+  /// @brief Search settings
+  BotConfig_t config;
+  /// @brief Worker threads
+  pthread_t workers[BOT_MAX_THREADS];
+  /// @brief Number of worker threads started
+  int started;
+  /// @brief Guards the fields below
+  pthread_mutex_t lock;
+  /// @brief Signalled when a job is posted or the pool stops
+  pthread_cond_t wake;
+  /// @brief Signalled when the last worker finishes a job
+  pthread_cond_t idle;
+  /// @brief Number of the last job posted
+  unsigned long generation;
+  /// @brief Workers still running the job
+  int busy;
+  /// @brief Set to stop the workers
+  int stop;
+  /// @brief Job being run
+  struct BotJob *job;
+  /// @brief Placements evaluated by all searches
+  long nodes;
+  /// @brief Time spent in all searches, us
+  long elapsed_us;
+  /// @brief Depth the last search completed
+  int depth_reached;
+  /// @brief Counter that stops a search once it moves off watched, NULL
+  /// for none
+  const unsigned long *watch;
+  /// @brief Value of watch a search is run for
+  unsigned long watched;
+} Bot_t;
+
+/**
+ * @defgroup bot_funcs Autoplayer
+ */
+int bot_spawn(const uint16_t *rows, int type, int *rot, int *x, int *y);
+int bot_placements(MoveGen_t *gen, const uint16_t *rows, int type, int rot,
+                   int x, int y, Placement_t *out);
+double bot_evaluate(const uint16_t *rows, int lines);
+double bot_evaluate_features(const BoardFeatures_t *features, int lines);
+int bot_greedy(const GameInfo_t *stats, Placement_t *best);
+int bot_greedy_cached(PlaceCache_t *cache, const GameInfo_t *stats,
+                      Placement_t *best);
+int bot_place(const GameInfo_t *stats, int rot, int x, Placement_t *out);
+Bot_t *bot_create(const BotConfig_t *config);
+void bot_free(Bot_t *bot);
+int bot_search(Bot_t *bot, const GameInfo_t *stats, Placement_t *best);
+void bot_execute(FSM_STATES_g *state, const Placement_t *placement);
+
+#endif /* BOT_H */
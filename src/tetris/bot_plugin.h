@@ -0,0 +1,120 @@
+/**
+ * @file bot_plugin.h
+ * @brief Stable C ABI of bot controllers loaded from shared objects
+ *
+ * This is the only header a controller includes; it uses fixed-width types
+ * only, so a controller can be built apart from the game. A controller
+ * exports BOT_PLUGIN_SYMBOL, a function returning its BotPlugin_t.
+ *
+ * The game calls decide() once for every tetromino that starts to fall.
+ * The controller reads the game through a BotView_t whose pointers lead
+ * straight into the live game, nothing is copied, and must not keep them
+ * past the call. It answers with a placement, a number of turns and a
+ * column the game finds the way to, or with the signals to give, which go
+ * through the same state machine as keys pressed by a player. A tetromino
+ * still falling once they are given is dropped.
+ *
+ * The layout of every struct here only ever grows at the end: the size
+ * fields tell either side how much of it the other knows. Changes that
+ * break the layout bump BOT_PLUGIN_ABI, and a controller built for another
+ * ABI is refused.
+ */
+
+#ifndef BOT_PLUGIN_H
+#define BOT_PLUGIN_H
+#include <stdint.h>
+
+/// Version of the ABI
+#define BOT_PLUGIN_ABI 1
+/// Name of the function a controller exports
+#define BOT_PLUGIN_SYMBOL "bot_plugin"
+/// Most signals of one decision
+#define BOT_PLUGIN_MAX_SIGNALS 64
+
+/// Signals a controller gives, the values of UserAction_t
+enum {
+  BOT_SIGNAL_LEFT = 4,
+  BOT_SIGNAL_RIGHT = 5,
+  BOT_SIGNAL_DOWN = 7,
+  BOT_SIGNAL_TURN = 8
+};
+
+/// Kinds of a decision
+enum { BOT_DECIDE_PLACEMENT, BOT_DECIDE_SIGNALS };
+
+/**
+ * @brief Read-only view of the live game
+ *
+ * Cell (x, y) of the field, x from 0 to width - 1 left to right and y from
+ * 0 to height - 1 top to bottom, is field[x * stride + y], non-zero if
+ * filled. Cell (i, j) of the 4x4 tetromino, non-zero if filled, is
+ * piece[i * 4 + j] and lies on field cell (*x + i, *y + j - 1).
+ */
+typedef struct {
+  /// @brief BOT_PLUGIN_ABI
+  uint32_t abi;
+  /// @brief sizeof(BotView_t) of the game
+  uint32_t size;
+  /// @brief Columns of the field
+  int32_t width;
+  /// @brief Rows of the field
+  int32_t height;
+  /// @brief Distance between two columns in field
+  int32_t stride;
+  /// @brief Field cells
+  const int32_t *field;
+  /// @brief Cells of the falling tetromino
+  const int32_t *piece;
+  /// @brief Type of the falling tetromino, 0 to 6
+  const int32_t *type;
+  /// @brief Type of the next tetromino
+  const int32_t *next;
+  /// @brief Position of the falling tetromino at X
+  const int32_t *x;
+  /// @brief Position of the falling tetromino at Y
+  const int32_t *y;
+  /// @brief Score
+  const int32_t *score;
+  /// @brief Level
+  const int32_t *level;
+} BotView_t;
+
+/**
+ * @brief Answer of a controller for one tetromino
+ */
+typedef struct {
+  /// @brief BOT_DECIDE_PLACEMENT or BOT_DECIDE_SIGNALS
+  int32_t kind;
+  /// @brief Placement: turns from the current rotation, each one as a
+  /// BOT_SIGNAL_TURN gives, 0 to 3
+  int32_t turns;
+  /// @brief Placement: position at X of the tetromino, as in BotView_t
+  int32_t x;
+  /// @brief Signals: number of signals
+  int32_t count;
+  /// @brief Signals: BOT_SIGNAL_* values, in order
+  uint8_t signals[BOT_PLUGIN_MAX_SIGNALS];
+} BotDecision_t;
+
+/**
+ * @brief Entry points of a controller
+ */
+typedef struct {
+  /// @brief BOT_PLUGIN_ABI the controller was built for
+  uint32_t abi;
+  /// @brief sizeof(BotPlugin_t) of the controller
+  uint32_t size;
+  /// @brief Name shown by the game
+  const char *name;
+  /// @brief Makes a controller instance, NULL on an error; may be NULL
+  void *(*create)(void);
+  /// @brief Decides where the falling tetromino goes, returns 0 on success
+  int (*decide)(void *bot, const BotView_t *view, BotDecision_t *decision);
+  /// @brief Frees an instance; may be NULL
+  void (*destroy)(void *bot);
+} BotPlugin_t;
+
+/// Type of BOT_PLUGIN_SYMBOL
+typedef const BotPlugin_t *(*BotPluginEntry_t)(void);
+
+#endif /* BOT_PLUGIN_H */
@@ -0,0 +1,313 @@
+/**
+ * @file dataset.c
+ * @brief Columnar dataset of tetromino placements for imitation learning
+ */
+
+#include "dataset.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(DatasetHeader_t) == DATASET_HEADER_BYTES,
+               "dataset header must fill one page");
+_Static_assert(sizeof(DatasetChunk_t) % 4096 == 0,
+               "dataset chunks must be whole pages");
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Writes a whole buffer at an offset
+ * @param[in] fd File descriptor
+ * @param[in] *data Bytes
+ * @param[in] len Number of bytes
+ * @param[in] offset Offset in the file
+ * @return Returns 0 on success, 1 on an error
+ */
+static int dataset_write(int fd, const void *data, size_t len, off_t offset) {
+  const uint8_t *bytes = data;
+  while (len > 0) {
+    ssize_t done = pwrite(fd, bytes, len, offset);
+    if (done <= 0) return 1;
+    bytes += done;
+    len -= done;
+    offset += done;
+  }
+  return 0;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Creates a dataset file
+ * @param[in] *path File name
+ * @return Returns the writer, NULL on an error
+ */
+DatasetWriter_t *dataset_create(const char *path) {
+  DatasetWriter_t *writer = calloc(1, sizeof(DatasetWriter_t));
+  if (writer == NULL) return NULL;
+  writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  DatasetHeader_t header = {0};
+  header.magic = DATASET_MAGIC;
+  header.version = DATASET_VERSION;
+  header.board_bytes = DATASET_BOARD_BYTES;
+  header.chunk_rows = DATASET_CHUNK_ROWS;
+  header.chunk_bytes = sizeof(DatasetChunk_t);
+  if (writer->fd < 0 || dataset_write(writer->fd, &header, sizeof(header), 0)) {
+    if (writer->fd >= 0) close(writer->fd);
+    free(writer);
+    return NULL;
+  }
+  pthread_mutex_init(&writer->lock, NULL);
+  return writer;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Writes the index, completes the header and closes the file
+ *
+ * Every stream must be closed before.
+ * @param[in] *writer Writer, freed
+ * @return Returns 0 on success, 1 if anything failed to be written
+ */
+int dataset_close(DatasetWriter_t *writer) {
+  int failed = writer->failed;
+  DatasetIndex_t *index = calloc(writer->chunk_count + 1, sizeof(*index));
+  failed |= index == NULL;
+  uint64_t samples = 0;
+  for (uint64_t k = 0; !failed && k < writer->chunk_count; k++) {
+    index[k].first = samples;
+    index[k].count = writer->counts[k];
+    samples += writer->counts[k];
+  }
+  DatasetHeader_t header = {0};
+  header.magic = DATASET_MAGIC;
+  header.version = DATASET_VERSION;
+  header.board_bytes = DATASET_BOARD_BYTES;
+  header.chunk_rows = DATASET_CHUNK_ROWS;
+  header.chunk_bytes = sizeof(DatasetChunk_t);
+  header.chunk_count = writer->chunk_count;
+  header.sample_count = samples;
+  header.index_offset =
+      DATASET_HEADER_BYTES + writer->chunk_count * sizeof(DatasetChunk_t);
+  if (!failed)
+    failed = dataset_write(writer->fd, index,
+                           writer->chunk_count * sizeof(*index),
+                           header.index_offset);
+  if (!failed)
+    failed = dataset_write(writer->fd, &header, sizeof(header), 0);
+  failed |= close(writer->fd) != 0;
+  pthread_mutex_destroy(&writer->lock);
+  free(index);
+  free(writer->counts);
+  free(writer);
+  return failed;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Starts a stream of samples into a dataset file
+ *
+ * A stream belongs to one thread, any number of them can write into the
+ * same file at once.
+ * @param[in] *writer Writer
+ * @return Returns the stream, NULL if out of memory
+ */
+DatasetStream_t *dataset_stream(DatasetWriter_t *writer) {
+  DatasetStream_t *stream = calloc(1, sizeof(DatasetStream_t));
+  if (stream != NULL) stream->writer = writer;
+  return stream;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Writes the chunk of a stream out and starts a new one
+ *
+ * The chunk's place in the file is claimed under the writer lock, the
+ * chunk itself is written without holding it.
+ * @param[in] *stream Stream
+ * @return Returns 0 on success, 1 on an error
+ */
+static int dataset_flush(DatasetStream_t *stream) {
+  if (stream->count == 0) return 0;
+  DatasetWriter_t *writer = stream->writer;
+  pthread_mutex_lock(&writer->lock);
+  if (writer->chunk_count == writer->capacity) {
+    uint64_t capacity = writer->capacity ? writer->capacity * 2 : 64;
+    uint32_t *counts = realloc(writer->counts, capacity * sizeof(uint32_t));
+    if (counts == NULL) {
+      writer->failed = 1;
+      pthread_mutex_unlock(&writer->lock);
+      return 1;
+    }
+    writer->counts = counts;
+    writer->capacity = capacity;
+  }
+  uint64_t k = writer->chunk_count++;
+  writer->counts[k] = stream->count;
+  pthread_mutex_unlock(&writer->lock);
+
+  int failed =
+      dataset_write(writer->fd, &stream->chunk, sizeof(DatasetChunk_t),
+                    DATASET_HEADER_BYTES + k * sizeof(DatasetChunk_t));
+  if (failed) __atomic_store_n(&writer->failed, 1, __ATOMIC_RELAXED);
+  memset(&stream->chunk, 0, sizeof(DatasetChunk_t));
+  stream->count = 0;
+  return failed;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Writes out what is left in a stream and frees it
+ * @param[in] *stream Stream, may be NULL
+ * @return Returns 0 on success, 1 on an error
+ */
+int dataset_stream_close(DatasetStream_t *stream) {
+  if (stream == NULL) return 0;
+  int failed = dataset_flush(stream);
+  free(stream);
+  return failed;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Adds a sample to a stream
+ * @param[in] *stream Stream
+ * @param[in] *event Tetromino that attached
+ * @return Returns 0 on success, 1 if a chunk failed to be written
+ */
+int dataset_add(DatasetStream_t *stream, const LockEvent_t *event) {
+  DatasetChunk_t *chunk = &stream->chunk;
+  int n = stream->count;
+  uint8_t *board = chunk->board[n];
+  uint32_t bits = 0;
+  int held = 0, out = 0;
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    for (int i = 0; i < BOARD_WIDTH; i++)
+      bits |= (uint32_t)(event->field[i][j] != 0) << (held + i);
+    for (held += BOARD_WIDTH; held >= 8; held -= 8, bits >>= 8)
+      board[out++] = bits & 0xFF;
+  }
+  int rot = piece_rotation(&event->current);
+  chunk->current[n] = event->current.type;
+  chunk->next[n] = event->next;
+  chunk->rot[n] = rot < 0 ? 0 : rot;
+  chunk->x[n] = event->x;
+  chunk->y[n] = event->y;
+  chunk->lines[n] = event->lines;
+  chunk->reward[n] = event->reward;
+  chunk->game[n] = stream->game;
+  return ++stream->count == DATASET_CHUNK_ROWS ? dataset_flush(stream) : 0;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Lock hook adding every tetromino to a stream
+ * @param[in] *event Tetromino that attached
+ * @param[in] *arg Stream
+ */
+void dataset_lock_hook(const LockEvent_t *event, void *arg) {
+  dataset_add(arg, event);
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Maps a dataset file and checks its header and index
+ * @param[in] *path File name
+ * @param[out] *view Mapped file
+ * @return Returns 0 on success, 1 if the file cannot be read or is not a
+ * complete dataset
+ */
+int dataset_open(const char *path, DatasetView_t *view) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 1;
+  struct stat info;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size >= DATASET_HEADER_BYTES)
+    base = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return 1;
+  view->base = base;
+  view->size = info.st_size;
+  view->header = base;
+  const DatasetHeader_t *header = view->header;
+  uint64_t chunks_end =
+      DATASET_HEADER_BYTES + header->chunk_count * sizeof(DatasetChunk_t);
+  int valid = header->magic == DATASET_MAGIC &&
+              header->version == DATASET_VERSION &&
+              header->chunk_bytes == sizeof(DatasetChunk_t) &&
+              header->index_offset == chunks_end &&
+              chunks_end + header->chunk_count * sizeof(DatasetIndex_t) <=
+                  view->size;
+  if (!valid) {
+    dataset_unmap(view);
+    return 1;
+  }
+  view->index = (const DatasetIndex_t *)(view->base + header->index_offset);
+  return 0;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Unmaps a dataset file
+ * @param[in] *view Mapped file
+ */
+void dataset_unmap(DatasetView_t *view) {
+  munmap((void *)view->base, view->size);
+  view->base = NULL;
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Chunk of a mapped dataset, read in place
+ * @param[in] *view Mapped file
+ * @param[in] k Chunk number
+ * @return Returns the chunk, NULL if there is no such chunk
+ */
+const DatasetChunk_t *dataset_chunk(const DatasetView_t *view, uint64_t k) {
+  if (k >= view->header->chunk_count) return NULL;
+  return (const DatasetChunk_t *)(view->base + DATASET_HEADER_BYTES +
+                                  k * sizeof(DatasetChunk_t));
+}
+
+/**
+ * @ingroup dataset_funcs
+ * @brief Unpacks one sample of a mapped dataset
+ * @param[in] *view Mapped file
+ * @param[in] i Sample number
+ * @param[out] *out Sample
+ * @return Returns 0 on success, 1 if there is no such sample
+ */
+int dataset_sample(const DatasetView_t *view, uint64_t i,
+                   DatasetSample_t *out) {
+  if (i >= view->header->sample_count) return 1;
+  uint64_t lo = 0, hi = view->header->chunk_count - 1;
+  while (lo < hi) {
+    uint64_t mid = (lo + hi + 1) / 2;
+    if (view->index[mid].first <= i)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  const DatasetChunk_t *chunk = dataset_chunk(view, lo);
+  int n = i - view->index[lo].first;
+  const uint8_t *board = chunk->board[n];
+  uint32_t bits = 0;
+  int held = 0, in = 0;
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    for (; held < BOARD_WIDTH; held += 8) bits |= board[in++] << held;
+    out->rows[j] =
+        BOARD_EMPTY_ROW | (bits & ((1 << BOARD_WIDTH) - 1)) << BOARD_SHIFT;
+    bits >>= BOARD_WIDTH;
+    held -= BOARD_WIDTH;
+  }
+  out->current = chunk->current[n];
+  out->next = chunk->next[n];
+  out->rot = chunk->rot[n];
+  out->x = chunk->x[n];
+  out->y = chunk->y[n];
+  out->lines = chunk->lines[n];
+  out->reward = chunk->reward[n];
+  out->game = chunk->game[n];
+  return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file dataset.h
+ * @brief Columnar dataset of tetromino placements for imitation learning
+ *
+ * Every sample is one tetromino attaching: the field before it, the current
+ * and next tetromino, the placement and the score it brought. The file is a
+ * header page, fixed-size chunks and an index. A chunk holds
+ * DATASET_CHUNK_ROWS samples column by column, fields bit-packed ten bits a
+ * row, and is a whole number of pages, so training code can mmap the file
+ * and read any sample in place.
+ *
+ * Every producing thread fills a chunk of its own and only takes the writer
+ * lock once per chunk, to claim the chunk's place in the file. The index,
+ * written on close, gives the first sample and the sample count of every
+ * chunk, as the last chunk of every thread is only partly filled.
+ */
+
+#ifndef DATASET_H
+#define DATASET_H
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+/// First bytes of a dataset file, "TDS1" read as little-endian
+#define DATASET_MAGIC 0x31534454u
+/// Version of the dataset layout
+#define DATASET_VERSION 1
+/// Samples in one chunk
+#define DATASET_CHUNK_ROWS 4096
+/// Bytes of a bit-packed field
+#define DATASET_BOARD_BYTES (BOARD_WIDTH * BOARD_HEIGHT / 8)
+/// Bytes of the header, one page
+#define DATASET_HEADER_BYTES 4096
+
+/**
+ * @brief First page of a dataset file
+ */
+typedef struct {
+  /// @brief DATASET_MAGIC
+  uint32_t magic;
+  /// @brief DATASET_VERSION
+  uint16_t version;
+  /// @brief DATASET_BOARD_BYTES
+  uint16_t board_bytes;
+  /// @brief DATASET_CHUNK_ROWS
+  uint32_t chunk_rows;
+  /// @brief sizeof(DatasetChunk_t)
+  uint32_t chunk_bytes;
+  /// @brief Number of chunks
+  uint64_t chunk_count;
+  /// @brief Number of samples
+  uint64_t sample_count;
+  /// @brief Offset of the index, 0 if the file was never closed
+  uint64_t index_offset;
+  /// @brief Zero
+  uint8_t reserved[DATASET_HEADER_BYTES - 40];
+} DatasetHeader_t;
+
+/**
+ * @brief Samples stored column by column
+ */
+typedef struct {
+  /// @brief Field before the tetromino attached, bit 10 * row + column
+  uint8_t board[DATASET_CHUNK_ROWS][DATASET_BOARD_BYTES];
+  /// @brief Current tetromino type
+  uint8_t current[DATASET_CHUNK_ROWS];
+  /// @brief Next tetromino type
+  uint8_t next[DATASET_CHUNK_ROWS];
+  /// @brief Rotation the tetromino attached in
+  uint8_t rot[DATASET_CHUNK_ROWS];
+  /// @brief Position at X the tetromino attached in
+  int8_t x[DATASET_CHUNK_ROWS];
+  /// @brief Position at Y the tetromino attached in
+  int8_t y[DATASET_CHUNK_ROWS];
+  /// @brief Rows cleared
+  uint8_t lines[DATASET_CHUNK_ROWS];
+  /// @brief Score gained
+  int16_t reward[DATASET_CHUNK_ROWS];
+  /// @brief Game the sample comes from
+  uint32_t game[DATASET_CHUNK_ROWS];
+} DatasetChunk_t;
+
+/**
+ * @brief Index entry of a chunk
+ */
+typedef struct {
+  /// @brief Number of the first sample in the chunk
+  uint64_t first;
+  /// @brief Samples in the chunk
+  uint32_t count;
+  /// @brief Zero
+  uint32_t reserved;
+} DatasetIndex_t;
+
+/**
+ * @brief One sample, unpacked
+ */
+typedef struct {
+  /// @brief Field rows before the tetromino attached
+  uint16_t rows[BOARD_HEIGHT];
+  /// @brief Current tetromino type
+  int current;
+  /// @brief Next tetromino type
+  int next;
+  /// @brief Rotation the tetromino attached in
+  int rot;
+  /// @brief Position at X the tetromino attached in
+  int x;
+  /// @brief Position at Y the tetromino attached in
+  int y;
+  /// @brief Rows cleared
+  int lines;
+  /// @brief Score gained
+  int reward;
+  /// @brief Game the sample comes from
+  uint32_t game;
+} DatasetSample_t;
+
+/**
+ * @brief Dataset file being written
+ */
+typedef struct {
+  /// @brief File descriptor
+  int fd;
+  /// @brief Guards the fields below
+  pthread_mutex_t lock;
+  /// @brief Samples in every chunk written
+  uint32_t *counts;
+  /// @brief Room in counts
+  uint64_t capacity;
+  /// @brief Chunks written
+  uint64_t chunk_count;
+  /// @brief Set after a write failed
+  int failed;
+} DatasetWriter_t;
+
+/**
+ * @brief Chunk being filled by one thread
+ */
+typedef struct {
+  /// @brief File the chunk goes to
+  DatasetWriter_t *writer;
+  /// @brief Game the next samples come from
+  uint32_t game;
+  /// @brief Samples in chunk
+  int count;
+  /// @brief Chunk
+  DatasetChunk_t chunk;
+} DatasetStream_t;
+
+/**
+ * @brief Dataset file mapped for reading
+ */
+typedef struct {
+  /// @brief Mapped file
+  const uint8_t *base;
+  /// @brief Size of the file
+  size_t size;
+  /// @brief Header
+  const DatasetHeader_t *header;
+  /// @brief Index
+  const DatasetIndex_t *index;
+} DatasetView_t;
+
+/**
+ * @defgroup dataset_funcs Dataset export
+ */
+DatasetWriter_t *dataset_create(const char *path);
+int dataset_close(DatasetWriter_t *writer);
+DatasetStream_t *dataset_stream(DatasetWriter_t *writer);
+int dataset_stream_close(DatasetStream_t *stream);
+int dataset_add(DatasetStream_t *stream, const LockEvent_t *event);
+void dataset_lock_hook(const LockEvent_t *event, void *arg);
+int dataset_open(const char *path, DatasetView_t *view);
+void dataset_unmap(DatasetView_t *view);
+const DatasetChunk_t *dataset_chunk(const DatasetView_t *view, uint64_t k);
+int dataset_sample(const DatasetView_t *view, uint64_t i,
+                   DatasetSample_t *out);
+
+#endif /* DATASET_H */
@@ -0,0 +1,518 @@
+/**
+ * @file difftest.c
+ * @brief Differential testing of optimized engines against tetris.c
+ */
+
+#include "difftest.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "batch.h"
+#include "packed.h"
+
+/// Signals a random case is made of, those every engine handles
+static const UserAction_t diff_signals[] = {0, Left, Right, Down, Action, Up};
+/// Names of the signals for reports
+static const char *const diff_names[] = {
+    "0",     "Start", "Pause", "Terminate", "Left",
+    "Right", "Up",    "Down",  "Action",    "Rewind"};
+/// Piece seeds of the long games of the corpus
+static const unsigned int diff_corpus_seeds[] = {100, 101, 102, 42, 3, 11, 7};
+/// Seed of the signal stream the long games share
+#define DIFF_CORPUS_STREAM 7
+/// Signals of a long game
+#define DIFF_CORPUS_LEN 3000
+/// Piece seed of the cases of the engine tests, they set up their own
+/// tetrominos and it only decides those after
+#define DIFF_TEST_SEED 1
+/// Columns 1 to 9 of a row, filled by attaching_test and score_test
+#define DIFF_RIGHT_NINE 0x3FE
+
+/**
+ * @brief Case of an engine test of tests.c
+ */
+typedef struct {
+  /// @brief Current tetromino type, at rotation 0, the next one is an I
+  int type;
+  /// @brief Position of the tetromino at X
+  int x;
+  /// @brief Position of the tetromino at Y
+  int y;
+  /// @brief Filled cells, bit i of row r is column i
+  uint16_t cells[BOARD_HEIGHT];
+  /// @brief Number of signals
+  int len;
+  /// @brief Signals
+  uint8_t sigs[4];
+} DiffTestCase_t;
+
+/**
+ * Signals the engine tests give and the fields and positions they give them
+ * in. A test that moves the tetromino between signals makes a case for
+ * every position. Pause and Terminate are left out, a step of a case keeps
+ * falling, so pause_test and the end of moving_test_2 have no case.
+ */
+static const DiffTestCase_t diff_test_cases[] = {
+    /* moving_test_1 */
+    {2, 4, 1, {0}, 4, {Down, Left, Right, Action}},
+    /* moving_test_2 */
+    {PIECE_O, 4, 1, {0}, 2, {Action, Up}},
+    /* attaching_test_1 */
+    {PIECE_I, -1, 17,
+     {[16] = DIFF_RIGHT_NINE, DIFF_RIGHT_NINE, DIFF_RIGHT_NINE,
+      DIFF_RIGHT_NINE},
+     1, {Down}},
+    /* attaching_test_2 */
+    {PIECE_I, 4, 17, {0}, 1, {Down}},
+    /* score_test_1 */
+    {PIECE_I, -1, 17,
+     {[17] = DIFF_RIGHT_NINE, DIFF_RIGHT_NINE, DIFF_RIGHT_NINE},
+     1, {Down}},
+    /* score_test_2 */
+    {PIECE_I, -1, 17, {[18] = DIFF_RIGHT_NINE, DIFF_RIGHT_NINE}, 1, {Down}},
+    /* score_test_3 */
+    {PIECE_I, -1, 17, {[19] = DIFF_RIGHT_NINE}, 1, {Down}},
+    /* check_collision_test */
+    {PIECE_I, -1, 3, {0}, 1, {Left}},
+    {PIECE_I, 8, 3, {0}, 1, {Right}},
+    {PIECE_I, 8, 17, {0}, 1, {Down}},
+    /* check_collision_r_test */
+    {PIECE_I, -1, 3, {0}, 1, {Action}},
+    {PIECE_I, 8, 3, {0}, 1, {Action}},
+    {PIECE_I, 8, 16, {0}, 1, {Action}},
+    {PIECE_I, 4, 9, {[10] = 1 << 5}, 1, {Action}},
+};
+
+/**
+ * @ingroup diff_funcs
+ * @brief Brings the reference game to the common state
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] state Current game state
+ * @param[out] *out Common state
+ */
+static void diff_reference_state(const GameInfo_t *stats, FSM_STATES_g state,
+                                 DiffState_t *out) {
+  memset(out, 0, sizeof(DiffState_t));
+  out->over = state == GAME_OVER;
+  if (out->over) return;
+  board_from_field(stats, out->rows);
+  out->type = stats->current_tetromino.type;
+  out->rot = piece_rotation(&stats->current_tetromino);
+  out->next = stats->next_tetromino.type;
+  out->x = stats->cur_x;
+  out->y = stats->cur_y;
+  out->score = stats->score;
+  out->level = stats->level;
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Puts the reference game in a common state, the game is moving
+ * @param[out] *stats Pointer to stats struct
+ * @param[in] *start State to start from
+ */
+static void diff_reference_start(GameInfo_t *stats, const DiffState_t *start) {
+  board_to_field(start->rows, stats);
+  stats->current_tetromino = piece_tetromino(start->type, start->rot);
+  stats->next_tetromino = get_tetromino(start->next);
+  stats->cur_x = start->x;
+  stats->cur_y = start->y;
+  stats->score = start->score;
+  stats->level = start->level;
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief One step of the reference engine: the signal, one row of gravity
+ * and, if the tetromino attached, the next spawn
+ * @param[in,out] *state Current game state
+ * @param[in] sig Signal
+ */
+static void diff_reference_step(FSM_STATES_g *state, UserAction_t sig) {
+  userInput(state, sig);
+  if (*state == MOVING) move_down(state);
+  if (*state == ATTACHING) {
+    userInput(state, 0);
+    userInput(state, 0);
+  }
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Compares two common states
+ * @param[in] *expected State of the reference engine
+ * @param[in] *actual State of the engine under test
+ * @param[out] *report First field that differs
+ * @return Returns 1 if the states differ
+ */
+static int diff_compare(const DiffState_t *expected, const DiffState_t *actual,
+                        DiffReport_t *report) {
+  static const struct {
+    const char *name;
+    size_t offset;
+  } fields[] = {{"type", offsetof(DiffState_t, type)},
+                {"rot", offsetof(DiffState_t, rot)},
+                {"next", offsetof(DiffState_t, next)},
+                {"x", offsetof(DiffState_t, x)},
+                {"y", offsetof(DiffState_t, y)},
+                {"score", offsetof(DiffState_t, score)},
+                {"level", offsetof(DiffState_t, level)}};
+  report->row = -1;
+  report->field = "over";
+  report->expected = expected->over;
+  report->actual = actual->over;
+  if (expected->over != actual->over) return 1;
+  if (expected->over) return 0;
+  for (int r = 0; r < BOARD_HEIGHT; r++) {
+    if (expected->rows[r] == actual->rows[r]) continue;
+    report->field = "row";
+    report->row = r;
+    report->expected = expected->rows[r];
+    report->actual = actual->rows[r];
+    return 1;
+  }
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    int a = *(const int *)((const char *)expected + fields[i].offset);
+    int b = *(const int *)((const char *)actual + fields[i].offset);
+    if (a == b) continue;
+    report->field = fields[i].name;
+    report->expected = a;
+    report->actual = b;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Plays a case on the reference engine and an engine under test
+ *
+ * The reference game is bound to the calling thread for the run, so threads
+ * can run cases at the same time.
+ * @param[in] *engine Engine under test
+ * @param[in] *instance Instance of the engine
+ * @param[in] *test Case
+ * @param[out] *report Where the states first differ
+ * @return Returns 1 if they differ, 0 if they agree until the case or the
+ * game ends
+ */
+int diff_run(const DiffEngine_t *engine, void *instance, const DiffCase_t *test,
+             DiffReport_t *report) {
+  GameInfo_t game;
+  FSM_STATES_g state = SPAWN;
+  DiffState_t expected, actual;
+  bind_game_state(&game);
+  stats_init(&game);
+  stats_seed(&game, test->seed);
+  userInput(&state, 0);
+  if (test->placed) diff_reference_start(&game, &test->start);
+  engine->reset(instance, test->seed, test->placed ? &test->start : NULL,
+                &actual);
+  diff_reference_state(&game, state, &expected);
+  int diverged = diff_compare(&expected, &actual, report);
+  int step = 0;
+  while (!diverged && !expected.over && step < test->len) {
+    diff_reference_step(&state, test->sigs[step]);
+    engine->step(instance, test->sigs[step], &actual);
+    step++;
+    diff_reference_state(&game, state, &expected);
+    diverged = diff_compare(&expected, &actual, report);
+  }
+  bind_game_state(NULL);
+  report->step = diverged ? step : -1;
+  report->played = step;
+  return diverged;
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Shrinks a diverging case to one no signal can be dropped from
+ * @param[in] *engine Engine under test
+ * @param[in] *instance Instance of the engine
+ * @param[in,out] *test Case, replaced by the shrunk one
+ * @param[out] *report Where the shrunk case diverges
+ * @return Returns 1 if the case diverges, 0 if it does not and is left as
+ * it was
+ */
+int diff_shrink(const DiffEngine_t *engine, void *instance, DiffCase_t *test,
+                DiffReport_t *report) {
+  static __thread DiffCase_t trial;
+  DiffReport_t found;
+  if (!diff_run(engine, instance, test, report)) return 0;
+  test->len = report->step;
+  for (int span = test->len > 1 ? test->len / 2 : 1; span >= 1; span /= 2) {
+    for (int i = 0; i + span <= test->len;) {
+      trial.seed = test->seed;
+      trial.placed = test->placed;
+      trial.start = test->start;
+      trial.len = test->len - span;
+      memcpy(trial.sigs, test->sigs, i);
+      memcpy(trial.sigs + i, test->sigs + i + span, trial.len - i);
+      if (diff_run(engine, instance, &trial, &found)) {
+        test->len = found.step;
+        memcpy(test->sigs, trial.sigs, test->len);
+        *report = found;
+      } else {
+        i += span;
+      }
+    }
+  }
+  for (int i = 0; i < test->len; i++) {
+    uint8_t sig = test->sigs[i];
+    if (sig == 0) continue;
+    test->sigs[i] = 0;
+    if (diff_run(engine, instance, test, &found)) {
+      test->len = found.step;
+      *report = found;
+    } else {
+      test->sigs[i] = sig;
+    }
+  }
+  return diff_run(engine, instance, test, report);
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Makes a random case
+ * @param[out] *test Case
+ * @param[in,out] *rng State of the random generator
+ * @param[in] len Number of signals, DIFF_MAX_STEPS at most
+ */
+void diff_random(DiffCase_t *test, unsigned int *rng, int len) {
+  int count = sizeof(diff_signals) / sizeof(diff_signals[0]);
+  test->seed = rand_r(rng);
+  test->placed = 0;
+  test->len = len < DIFF_MAX_STEPS ? len : DIFF_MAX_STEPS;
+  for (int i = 0; i < test->len; i++)
+    test->sigs[i] = diff_signals[rand_r(rng) % count];
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Seed corpus
+ *
+ * First the long games, every one taking the next DIFF_CORPUS_LEN signals of
+ * one seeded stream, then the cases of the engine tests of tests.c.
+ * @param[out] *cases Cases
+ * @param[in] max Room in cases
+ * @return Returns the number of cases made
+ */
+int diff_corpus(DiffCase_t *cases, int max) {
+  int games = sizeof(diff_corpus_seeds) / sizeof(diff_corpus_seeds[0]);
+  int tests = sizeof(diff_test_cases) / sizeof(diff_test_cases[0]);
+  int kinds = sizeof(diff_signals) / sizeof(diff_signals[0]);
+  unsigned int stream = DIFF_CORPUS_STREAM;
+  int count = 0;
+  for (; count < games && count < max; count++) {
+    DiffCase_t *test = &cases[count];
+    test->seed = diff_corpus_seeds[count];
+    test->placed = 0;
+    test->len = DIFF_CORPUS_LEN;
+    for (int i = 0; i < test->len; i++)
+      test->sigs[i] = diff_signals[rand_r(&stream) % kinds];
+  }
+  for (int t = 0; t < tests && count < max; t++, count++) {
+    const DiffTestCase_t *from = &diff_test_cases[t];
+    DiffCase_t *test = &cases[count];
+    test->seed = DIFF_TEST_SEED;
+    test->placed = 1;
+    memset(&test->start, 0, sizeof(DiffState_t));
+    for (int r = 0; r < BOARD_HEIGHT; r++)
+      test->start.rows[r] = BOARD_EMPTY_ROW | from->cells[r] << BOARD_SHIFT;
+    test->start.type = from->type;
+    test->start.next = PIECE_I;
+    test->start.x = from->x;
+    test->start.y = from->y;
+    test->len = from->len;
+    memcpy(test->sigs, from->sigs, from->len);
+  }
+  return count;
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Prints a diverging case so that it can be pasted into a test
+ * @param[in] *engine Engine under test
+ * @param[in] *test Case
+ * @param[in] *report Where it diverges
+ * @param[in] *out Stream
+ */
+void diff_print(const DiffEngine_t *engine, const DiffCase_t *test,
+                const DiffReport_t *report, FILE *out) {
+  fprintf(out, "%s diverges after %d of %d signals, seed %u: %s", engine->name,
+          report->step, test->len, test->seed, report->field);
+  if (report->row >= 0) fprintf(out, " %d", report->row);
+  fprintf(out, " is %#x, reference has %#x\n", report->actual,
+          report->expected);
+  if (test->placed) {
+    const DiffState_t *start = &test->start;
+    fprintf(out, "starts from type %d, rotation %d at %d, %d, next %d, rows",
+            start->type, start->rot, start->x, start->y, start->next);
+    for (int r = 0; r < BOARD_HEIGHT; r++)
+      fprintf(out, " %#x", start->rows[r]);
+    fprintf(out, "\n");
+  }
+  fprintf(out, "static const UserAction_t signals[] = {");
+  for (int i = 0; i < test->len; i++) {
+    if (i % 8 == 0) fprintf(out, "\n    ");
+    fprintf(out, "%s%s", diff_names[test->sigs[i]],
+            i + 1 < test->len ? ", " : "");
+  }
+  fprintf(out, "};\n");
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Brings one game of a batch to the common state
+ * @param[in] *batch Batch
+ * @param[in] over Whether the game is over
+ * @param[out] *out Common state
+ */
+static void diff_batch_state(const TetrisBatch_t *batch, int over,
+                             DiffState_t *out) {
+  memset(out, 0, sizeof(DiffState_t));
+  out->over = over;
+  if (over) return;
+  for (int r = 0; r < BOARD_HEIGHT; r++) out->rows[r] = batch->rows[r];
+  out->type = batch->type[0];
+  out->rot = batch->rot[0];
+  out->next = batch->next[0];
+  out->x = batch->x[0];
+  out->y = batch->y[0];
+  out->score = batch->score[0];
+  out->level = batch->level[0];
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Batch of one game
+ * @return Returns the batch
+ */
+static void *diff_batch_create(void) { return batch_create(1, 1); }
+
+/**
+ * @ingroup diff_funcs
+ * @brief Starts the game of a batch
+ * @param[in] *engine Batch
+ * @param[in] seed Piece seed
+ * @param[in] *start State to start from, NULL for the first spawn
+ * @param[out] *out Common state
+ */
+static void diff_batch_reset(void *engine, unsigned int seed,
+                             const DiffState_t *start, DiffState_t *out) {
+  TetrisBatch_t *batch = engine;
+  int over = batch_reset(batch, 0, seed);
+  if (start != NULL) {
+    for (int r = 0; r < BOARD_HEIGHT; r++) batch->rows[r] = start->rows[r];
+    batch->type[0] = start->type;
+    batch->rot[0] = start->rot;
+    batch->next[0] = start->next;
+    batch->x[0] = start->x;
+    batch->y[0] = start->y;
+    batch->score[0] = start->score;
+    batch->level[0] = start->level;
+    over = 0;
+  }
+  diff_batch_state(batch, over, out);
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Steps the game of a batch
+ * @param[in] *engine Batch
+ * @param[in] sig Signal
+ * @param[out] *out Common state
+ */
+static void diff_batch_step(void *engine, UserAction_t sig, DiffState_t *out) {
+  int reward, done;
+  tetris_batch_step(engine, &sig, &reward, &done);
+  diff_batch_state(engine, done, out);
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Frees a batch
+ * @param[in] *engine Batch
+ */
+static void diff_batch_destroy(void *engine) { batch_free(engine); }
+
+/// Batch stepping of batch.c
+const DiffEngine_t diff_batch_engine = {"batch", diff_batch_create,
+                                        diff_batch_reset, diff_batch_step,
+                                        diff_batch_destroy};
+
+/**
+ * @ingroup diff_funcs
+ * @brief Brings a packed game to the common state
+ * @param[in] *game Packed game
+ * @param[out] *out Common state
+ */
+static void diff_packed_state(const PackedGame_t *game, DiffState_t *out) {
+  memset(out, 0, sizeof(DiffState_t));
+  out->over = game->state == GAME_OVER;
+  if (out->over) return;
+  memcpy(out->rows, game->rows, sizeof(out->rows));
+  out->type = game->type;
+  out->rot = game->rot;
+  out->next = game->next;
+  out->x = game->x;
+  out->y = game->y;
+  out->score = game->score;
+  out->level = game->level;
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Packed game, aligned to the cache line PackedGame_t is declared
+ * with, which malloc() does not promise
+ * @return Returns the game, NULL if out of memory
+ */
+static void *diff_packed_create(void) {
+  return aligned_alloc(64, sizeof(PackedGame_t));
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Starts a packed game
+ * @param[in] *engine Packed game
+ * @param[in] seed Piece seed
+ * @param[in] *start State to start from, NULL for the first spawn
+ * @param[out] *out Common state
+ */
+static void diff_packed_reset(void *engine, unsigned int seed,
+                              const DiffState_t *start, DiffState_t *out) {
+  PackedGame_t *game = engine;
+  packed_reset(game, seed);
+  if (start != NULL) {
+    memcpy(game->rows, start->rows, sizeof(game->rows));
+    game->type = start->type;
+    game->rot = start->rot;
+    game->next = start->next;
+    game->x = start->x;
+    game->y = start->y;
+    game->score = start->score;
+    game->level = start->level;
+    game->state = MOVING;
+  }
+  diff_packed_state(game, out);
+}
+
+/**
+ * @ingroup diff_funcs
+ * @brief Steps a packed game
+ * @param[in] *engine Packed game
+ * @param[in] sig Signal
+ * @param[out] *out Common state
+ */
+static void diff_packed_step(void *engine, UserAction_t sig,
+                             DiffState_t *out) {
+  int reward;
+  packed_step(engine, sig, &reward);
+  diff_packed_state(engine, out);
+}
+
+/// Packed game of packed.c
+const DiffEngine_t diff_packed_engine = {"packed", diff_packed_create,
+                                         diff_packed_reset, diff_packed_step,
+                                         free};
@@ -0,0 +1,126 @@
+/**
+ * @file difftest.h
+ * @brief Differential testing of optimized engines against tetris.c
+ *
+ * A case is a piece seed and a sequence of signals. The reference engine,
+ * userInput() on a game bound to the calling thread, and an engine under
+ * test play the case in lockstep, one step being one signal followed by one
+ * row of gravity, an attaching tetromino clearing rows and the next one
+ * spawning within the same step. Both are brought to a common state after
+ * every step and compared whole: field, tetrominos, position, rotation,
+ * score, level and whether the game is over.
+ *
+ * A case can also start from a placed tetromino on a given field instead of
+ * the first spawn. The seed corpus holds long seeded games and the signal
+ * sequences of the engine tests of tests.c, moving_test, attaching_test,
+ * score_test and check_collision_test among them, each from the field and
+ * the position the test sets up.
+ *
+ * A case that diverges can be shrunk: it is cut after the first divergence,
+ * then spans of signals are dropped and signals replaced by no signal while
+ * the case still diverges, halving the span down to single signals.
+ */
+
+#ifndef DIFFTEST_H
+#define DIFFTEST_H
+#include <stdint.h>
+#include <stdio.h>
+
+#include "board.h"
+
+/// Longest case
+#define DIFF_MAX_STEPS 4096
+
+/**
+ * @brief State of a game both engines can be brought to
+ */
+typedef struct {
+  /// @brief Field rows
+  uint16_t rows[BOARD_HEIGHT];
+  /// @brief Current tetromino type
+  int type;
+  /// @brief Current tetromino rotation
+  int rot;
+  /// @brief Next tetromino type
+  int next;
+  /// @brief Position of the current tetromino at X
+  int x;
+  /// @brief Position of the current tetromino at Y
+  int y;
+  /// @brief Score
+  int score;
+  /// @brief Level
+  int level;
+  /// @brief Set when the game is over, the fields above are not compared
+  /// then
+  int over;
+} DiffState_t;
+
+/**
+ * @brief Engine under test
+ */
+typedef struct {
+  /// @brief Name shown in reports
+  const char *name;
+  /// @brief Makes an engine instance, NULL on an error
+  void *(*create)(void);
+  /// @brief Starts a game with a piece seed, as stats_seed() does, then puts
+  /// it in a state unless that is NULL
+  void (*reset)(void *engine, unsigned int seed, const DiffState_t *start,
+                DiffState_t *out);
+  /// @brief Makes one step
+  void (*step)(void *engine, UserAction_t sig, DiffState_t *out);
+  /// @brief Frees an instance
+  void (*destroy)(void *engine);
+} DiffEngine_t;
+
+/**
+ * @brief Seed and signals of a case
+ */
+typedef struct {
+  /// @brief Piece seed
+  unsigned int seed;
+  /// @brief Set when the game starts from start, not from the first spawn
+  int placed;
+  /// @brief Field, tetrominos, position, score and level to start from
+  DiffState_t start;
+  /// @brief Number of signals
+  int len;
+  /// @brief Signals
+  uint8_t sigs[DIFF_MAX_STEPS];
+} DiffCase_t;
+
+/**
+ * @brief Where and how a case diverged
+ */
+typedef struct {
+  /// @brief Step after which the states differ, -1 if they never do
+  int step;
+  /// @brief Steps played, up to the divergence or the end of the game
+  int played;
+  /// @brief Name of the first field that differs
+  const char *field;
+  /// @brief Field row that differs, -1 for the other fields
+  int row;
+  /// @brief Its value in the reference engine
+  int expected;
+  /// @brief Its value in the engine under test
+  int actual;
+} DiffReport_t;
+
+extern const DiffEngine_t diff_batch_engine;
+extern const DiffEngine_t diff_packed_engine;
+
+/**
+ * @defgroup diff_funcs Differential testing
+ */
+int diff_run(const DiffEngine_t *engine, void *instance, const DiffCase_t *test,
+             DiffReport_t *report);
+int diff_shrink(const DiffEngine_t *engine, void *instance, DiffCase_t *test,
+                DiffReport_t *report);
+void diff_random(DiffCase_t *test, unsigned int *rng, int len);
+int diff_corpus(DiffCase_t *cases, int max);
+void diff_print(const DiffEngine_t *engine, const DiffCase_t *test,
+                const DiffReport_t *report, FILE *out);
+
+#endif /* DIFFTEST_H */
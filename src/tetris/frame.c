@@ -0,0 +1,110 @@
+/**
+ * @file frame.c
+ * @brief Lock-free handoff of game snapshots from the engine to the renderer
+ */
+
+#include "frame.h"
+
+#include <string.h>
+
+/**
+ * @ingroup frame_funcs
+ * @brief Triple buffer initialization
+ * @param[in] *buffer Triple buffer
+ */
+void frame_init(FrameBuffer_t *buffer) {
+  memset(buffer, 0, sizeof(FrameBuffer_t));
+  buffer->back = 0;
+  buffer->middle = 1;
+  buffer->front = 2;
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Frame the engine fills before publishing it
+ * @param[in] *buffer Triple buffer
+ * @return Returns the back frame
+ */
+Frame_t *frame_back(FrameBuffer_t *buffer) {
+  return &buffer->frames[buffer->back];
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Hands the back frame over to the renderer
+ * @param[in] *buffer Triple buffer
+ */
+void frame_publish(FrameBuffer_t *buffer) {
+  int fresh = buffer->back | FRAME_FRESH;
+  int middle = __atomic_exchange_n(&buffer->middle, fresh, __ATOMIC_ACQ_REL);
+  buffer->back = middle & ~FRAME_FRESH;
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Takes the latest published frame
+ * @param[in] *buffer Triple buffer
+ * @return Returns the frame, NULL if nothing was published since last time
+ */
+Frame_t *frame_latest(FrameBuffer_t *buffer) {
+  if (!(__atomic_load_n(&buffer->middle, __ATOMIC_ACQUIRE) & FRAME_FRESH))
+    return NULL;
+  int middle =
+      __atomic_exchange_n(&buffer->middle, buffer->front, __ATOMIC_ACQ_REL);
+  buffer->front = middle & ~FRAME_FRESH;
+  return &buffer->frames[buffer->front];
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Records the delay of a drawn frame
+ * @param[in] *stats Latency statistics
+ * @param[in] delay_us Delay from publishing to the screen, us
+ */
+void latency_add(LatencyStats_t *stats, long delay_us) {
+  stats->samples[stats->count % LATENCY_SAMPLES] = delay_us;
+  stats->count++;
+  if (delay_us > stats->max) stats->max = delay_us;
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Comparator for qsort()
+ */
+static int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a;
+  long y = *(const long *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Percentile of the recorded delays
+ * @param[in] *stats Latency statistics
+ * @param[in] percent Percentile, 0 to 100
+ * @return Returns the delay, us, 0 if nothing was recorded
+ */
+long latency_percentile(LatencyStats_t *stats, int percent) {
+  long n = stats->count < LATENCY_SAMPLES ? stats->count : LATENCY_SAMPLES;
+  if (n == 0) return 0;
+  long *sorted = malloc(n * sizeof(long));
+  if (sorted == NULL) return 0;
+  memcpy(sorted, stats->samples, n * sizeof(long));
+  qsort(sorted, n, sizeof(long), compare_long);
+  long result = sorted[(n - 1) * percent / 100];
+  free(sorted);
+  return result;
+}
+
+/**
+ * @ingroup frame_funcs
+ * @brief Prints the latency statistics
+ * @param[in] *stats Latency statistics
+ * @param[in] *fp Output stream
+ */
+void latency_report(LatencyStats_t *stats, FILE *fp) {
+  fprintf(fp, "frames drawn %ld, skipped %ld\n", stats->count, stats->skipped);
+  fprintf(fp, "state change to screen: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+          latency_percentile(stats, 50) / 1000.0,
+          latency_percentile(stats, 99) / 1000.0, stats->max / 1000.0);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file frame.h
+ * @brief Lock-free handoff of game snapshots from the engine to the renderer
+ *
+ * A triple buffer: the engine fills the back frame and swaps it with the
+ * middle one, the renderer swaps the middle one with its front frame when a
+ * new one is there. Neither side ever waits for the other, the renderer
+ * simply skips frames it was too slow to draw.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+#include <stdint.h>
+
+#include "tetris.h"
+
+/// Set in FrameBuffer_t::middle when it holds a frame not yet taken
+#define FRAME_FRESH 4
+/// Number of latency samples kept for the percentiles
+#define LATENCY_SAMPLES 65536
+
+/**
+ * @brief Immutable snapshot of the game
+ */
+typedef struct {
+  /// @brief Game stats
+  GameInfo_t stats;
+  /// @brief Game state
+  FSM_STATES_g state;
+  /// @brief Set in versus mode, the fields below are used then
+  int versus;
+  /// @brief Game stats of the opponent's board
+  GameInfo_t rival;
+  /// @brief Game state of the opponent's board
+  FSM_STATES_g rival_state;
+  /// @brief Pending garbage rows of both boards
+  int garbage[2];
+  /// @brief Set when the hint below is shown
+  int hinted;
+  /// @brief Hinted placement of the current tetromino
+  tetromino hint;
+  /// @brief Position of the hinted placement at X
+  int hint_x;
+  /// @brief Position of the hinted placement at Y
+  int hint_y;
+  /// @brief Time the engine produced the snapshot, us
+  long published_us;
+  /// @brief Sequence number of the snapshot
+  unsigned long seq;
+} Frame_t;
+
+/**
+ * @brief Triple buffer of snapshots
+ */
+typedef struct {
+  /// @brief Snapshots
+  Frame_t frames[3];
+  /// @brief Index of the frame owned by the engine
+  int back;
+  /// @brief Index of the frame owned by the renderer
+  int front;
+  /// @brief Index of the shared frame, FRAME_FRESH if not taken yet
+  int middle;
+} FrameBuffer_t;
+
+/**
+ * @brief Delay from a snapshot being published to it being on screen
+ */
+typedef struct {
+  /// @brief Samples, us
+  long samples[LATENCY_SAMPLES];
+  /// @brief Number of frames drawn
+  long count;
+  /// @brief Number of frames published but never drawn
+  long skipped;
+  /// @brief Largest delay, us
+  long max;
+} LatencyStats_t;
+
+/**
+ * @defgroup frame_funcs Snapshot handoff
+ */
+void frame_init(FrameBuffer_t *buffer);
+Frame_t *frame_back(FrameBuffer_t *buffer);
+void frame_publish(FrameBuffer_t *buffer);
+Frame_t *frame_latest(FrameBuffer_t *buffer);
+void latency_add(LatencyStats_t *stats, long delay_us);
+long latency_percentile(LatencyStats_t *stats, int percent);
+void latency_report(LatencyStats_t *stats, FILE *fp);
+
+#endif /* FRAME_H */
@@ -0,0 +1,133 @@
+/**
+ * @file hint.c
+ * @brief Background search suggesting where the falling tetromino should go
+ */
+
+#include "hint.h"
+
+/**
+ * @ingroup hint_funcs
+ * @brief Packs a choice into one word
+ * @param[in] game Number of the game it is for
+ * @param[in] depth Depth of the search that chose it
+ * @param[in] *best Placement
+ * @return Returns the packed choice, never 0
+ */
+static uint64_t hint_pack(unsigned long game, int depth,
+                          const Placement_t *best) {
+  return (uint64_t)(uint32_t)game << 32 | (uint64_t)depth << 16 |
+         best->rot << 12 | (best->x + 8) << 6 | best->y;
+}
+
+/**
+ * @ingroup hint_funcs
+ * @brief Worker thread: searches every game posted, deepening until it is
+ * done or a newer game comes
+ * @param[in] *arg Hints
+ * @return NULL
+ */
+static void *hint_worker(void *arg) {
+  Hint_t *hint = arg;
+  struct timespec pause = {0, HINT_POLL_US * 1000};
+  GameInfo_t game;
+  Placement_t best;
+  while (!__atomic_load_n(&hint->done, __ATOMIC_ACQUIRE)) {
+    Frame_t *frame = frame_latest(&hint->requests);
+    if (frame == NULL) {
+      nanosleep(&pause, NULL);
+      continue;
+    }
+    game = frame->stats;
+    unsigned long number = frame->seq;
+    hint->bot->watched = number;
+    for (int depth = 1; depth <= hint->depth; depth++) {
+      if (__atomic_load_n(&hint->posted, __ATOMIC_RELAXED) != number) break;
+      hint->bot->config.depth = depth;
+      if (bot_search(hint->bot, &game, &best) != 0) break;
+      if (hint->bot->depth_reached < depth) {
+        __atomic_fetch_add(&hint->stopped, 1, __ATOMIC_RELAXED);
+        break;
+      }
+      __atomic_store_n(&hint->best, hint_pack(number, depth, &best),
+                       __ATOMIC_RELEASE);
+      __atomic_fetch_add(&hint->searches, 1, __ATOMIC_RELAXED);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @ingroup hint_funcs
+ * @brief Starts the hint worker
+ * @param[in] depth Deepest search to refine to, HINT_MAX_DEPTH at most
+ * @param[in] threads Threads searching, the worker included
+ * @return Returns the hints, NULL if the worker could not be started
+ */
+Hint_t *hint_create(int depth, int threads) {
+  Hint_t *hint = calloc(1, sizeof(Hint_t));
+  if (hint == NULL) return NULL;
+  BotConfig_t config = {1, 0, threads};
+  hint->bot = bot_create(&config);
+  hint->depth = depth < 1 ? 1 : depth;
+  if (hint->depth > HINT_MAX_DEPTH) hint->depth = HINT_MAX_DEPTH;
+  frame_init(&hint->requests);
+  if (hint->bot != NULL) hint->bot->watch = &hint->posted;
+  if (hint->bot == NULL ||
+      pthread_create(&hint->thread, NULL, hint_worker, hint) != 0) {
+    bot_free(hint->bot);
+    free(hint);
+    return NULL;
+  }
+  return hint;
+}
+
+/**
+ * @ingroup hint_funcs
+ * @brief Stops the worker, cutting its search short, and frees the hints
+ * @param[in] *hint Hints, may be NULL
+ */
+void hint_free(Hint_t *hint) {
+  if (hint == NULL) return;
+  __atomic_store_n(&hint->done, 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&hint->posted, hint->posted + 1, __ATOMIC_RELEASE);
+  pthread_join(hint->thread, NULL);
+  bot_free(hint->bot);
+  free(hint);
+}
+
+/**
+ * @ingroup hint_funcs
+ * @brief Hands a game over to the worker, called by the engine when a new
+ * tetromino starts to fall
+ *
+ * Never waits: the game is copied into the triple buffer and the search of
+ * the previous one is told to stop.
+ * @param[in] *hint Hints
+ * @param[in] *stats Game, MOVING
+ */
+void hint_post(Hint_t *hint, const GameInfo_t *stats) {
+  Frame_t *frame = frame_back(&hint->requests);
+  frame->stats = *stats;
+  frame->state = MOVING;
+  frame->seq = hint->posted + 1;
+  frame_publish(&hint->requests);
+  __atomic_store_n(&hint->posted, frame->seq, __ATOMIC_RELEASE);
+}
+
+/**
+ * @ingroup hint_funcs
+ * @brief Best placement found so far for the game posted last
+ * @param[in] *hint Hints
+ * @param[out] *move Placement
+ * @return Returns 0 on success, 1 if there is none yet
+ */
+int hint_best(Hint_t *hint, HintMove_t *move) {
+  uint64_t best = __atomic_load_n(&hint->best, __ATOMIC_ACQUIRE);
+  uint32_t game = __atomic_load_n(&hint->posted, __ATOMIC_RELAXED);
+  if (best == 0 || (uint32_t)(best >> 32) != game) return 1;
+  move->depth = best >> 16 & 0xFF;
+  move->rot = best >> 12 & 3;
+  move->x = (int)(best >> 6 & 0x3F) - 8;
+  move->y = best & 0x3F;
+  return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file hint.h
+ * @brief Background search suggesting where the falling tetromino should go
+ *
+ * The engine posts the game whenever a new tetromino starts to fall. A
+ * worker thread searches it as an anytime search: greedy first, then with
+ * the next tetromino, then with every further chance layer, publishing the
+ * choice of every level it completes until HINT_MAX_DEPTH or until a newer
+ * game is posted, which stops the search at once.
+ *
+ * Neither side ever waits for the other. Games are handed over through a
+ * triple buffer, the newest choice is one 64-bit word tagged with the
+ * number of the game it is for, so a choice for an older tetromino is never
+ * shown. An idle worker looks for a new game every HINT_POLL_US.
+ */
+
+#ifndef HINT_H
+#define HINT_H
+#include <pthread.h>
+#include <stdint.h>
+
+#include "bot.h"
+#include "frame.h"
+
+/// Deepest search the worker refines the hint to
+#define HINT_MAX_DEPTH 4
+/// Time an idle worker waits before looking for a new game, us
+#define HINT_POLL_US 1000
+
+/**
+ * @brief Hinted placement of the falling tetromino
+ */
+typedef struct {
+  /// @brief Rotation of the tetromino
+  int rot;
+  /// @brief Position of the tetromino at X
+  int x;
+  /// @brief Position of the tetromino at Y when it attaches
+  int y;
+  /// @brief Depth of the search that chose it
+  int depth;
+} HintMove_t;
+
+/**
+ * @brief Hint worker and the state it shares with the engine
+ */
+typedef struct {
+  /// @brief Search run by the worker
+  Bot_t *bot;
+  /// @brief Deepest search to refine to
+  int depth;
+  /// @brief Games posted by the engine
+  FrameBuffer_t requests;
+  /// @brief Number of the last game posted
+  unsigned long posted;
+  /// @brief Newest choice: game number, depth and placement packed
+  uint64_t best;
+  /// @brief Worker thread
+  pthread_t thread;
+  /// @brief Set to stop the worker
+  int done;
+  /// @brief Searches completed
+  long searches;
+  /// @brief Searches stopped by a newer game
+  long stopped;
+} Hint_t;
+
+/**
+ * @defgroup hint_funcs Hints
+ */
+Hint_t *hint_create(int depth, int threads);
+void hint_free(Hint_t *hint);
+void hint_post(Hint_t *hint, const GameInfo_t *stats);
+int hint_best(Hint_t *hint, HintMove_t *move);
+
+#endif /* HINT_H */
@@ -0,0 +1,266 @@
+/**
+ * @file input.c
+ * @brief Buffered input queue with DAS/ARR auto-repeat
+ *
+ * The terminal only reports key presses, never releases, so a key counts as
+ * held while its own autorepeat keeps arriving. The first repeat comes only
+ * after the terminal's typematic delay, a few hundred ms, the next ones every
+ * few tens of ms; both are measured on the first hold and a key is released
+ * when its next repeat is overdue. Until then the first repeat is expected
+ * between TYPEMATIC_MIN_MS and TYPEMATIC_MAX_MS after the press, and the
+ * same key sooner or later is a new press.
+ *
+ * Repeats reported by the terminal only keep the key held; the shifts
+ * themselves are produced here on the DAS/ARR schedule, independent of the
+ * terminal's rate. They start no earlier than the terminal's first repeat, a
+ * single tap never auto-shifts.
+ */
+
+#include "input.h"
+
+#include <string.h>
+
+/**
+ * @ingroup input_funcs
+ * @brief Checks whether a signal auto-repeats while held
+ * @param[in] sig Human-readable signal from user
+ * @return 1 for Left, Right and Down, 0 otherwise
+ */
+static int is_repeatable(UserAction_t sig) {
+  return sig == Left || sig == Right || sig == Down;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Delay before the first auto-repeat of a held signal
+ * @param[in] sig Human-readable signal from user
+ * @return Delay in ms, soft drop repeats without the auto-shift delay
+ */
+static long first_repeat_delay(UserAction_t sig) {
+  return sig == Down ? ARR_MS : DAS_MS;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Window within which the terminal's next repeat of a repeating key
+ * is due
+ * @param[in] *queue Pointer to the queue
+ * @return Window, ms
+ */
+static long repeat_window(const InputQueue_t *queue) {
+  return 2 * queue->repeat_gap > RELEASE_MS ? 2 * queue->repeat_gap
+                                            : RELEASE_MS;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Time after which the held key counts as released
+ * @param[in] *queue Pointer to the queue
+ * @return Time, ms
+ */
+static long held_until(const InputQueue_t *queue) {
+  if (queue->repeats > 0) return queue->last_seen + repeat_window(queue);
+  if (queue->delay > 0) return queue->pressed + queue->delay + RELEASE_MS;
+  return queue->pressed + TYPEMATIC_MAX_MS;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Checks whether an event is the terminal repeating the held key
+ * @param[in] *queue Pointer to the queue
+ * @param[in] *ev Event taken from the queue
+ * @return 1 if it is a repeat, 0 if it is a new press
+ */
+static int is_terminal_repeat(const InputQueue_t *queue,
+                              const InputEvent_t *ev) {
+  if (queue->held == 0 || ev->sig != queue->held) return 0;
+  long gap = ev->time - queue->last_seen;
+  if (queue->repeats > 0) return gap <= repeat_window(queue);
+  if (queue->delay > 0) return labs(gap - queue->delay) <= RELEASE_MS;
+  return gap >= TYPEMATIC_MIN_MS && gap <= TYPEMATIC_MAX_MS;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Counts a repeat of the held key sent by the terminal
+ *
+ * The first repeat lets the auto-shifts start, the second one gives the
+ * delay and the gap of the terminal, as only then is the first one known
+ * not to be a second press.
+ * @param[in] *queue Pointer to the queue
+ * @param[in] time Arrival time, ms
+ */
+static void count_repeat(InputQueue_t *queue, long time) {
+  if (queue->repeats == 0 && queue->next_repeat < time)
+    queue->next_repeat = time;
+  if (queue->repeats > 0) queue->repeat_gap = time - queue->last_seen;
+  if (queue->repeats == 1) queue->delay = queue->last_seen - queue->pressed;
+  queue->repeats++;
+  queue->last_seen = time;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Input queue initialization
+ * @param[in] *queue Pointer to the queue
+ */
+void input_init(InputQueue_t *queue) {
+  queue->head = 0;
+  queue->count = 0;
+  queue->held = 0;
+  queue->pressed = 0;
+  queue->last_seen = 0;
+  queue->next_repeat = 0;
+  queue->repeats = 0;
+  queue->delay = 0;
+  queue->repeat_gap = 0;
+  queue->pending_len = 0;
+  queue->pending_time = 0;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Appends a signal to the queue
+ * @param[in] *queue Pointer to the queue
+ * @param[in] sig Human-readable signal from user
+ * @param[in] time Arrival time, ms
+ * @return 0 on success, 1 if the queue is full and the signal was dropped
+ */
+int input_push(InputQueue_t *queue, UserAction_t sig, long time) {
+  if (queue->count == INPUT_QUEUE_SIZE) return 1;
+  int tail = (queue->head + queue->count) % INPUT_QUEUE_SIZE;
+  queue->events[tail].sig = sig;
+  queue->events[tail].time = time;
+  queue->count++;
+  return 0;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Takes the next signal due no later than the given time
+ *
+ * Queued signals and auto-repeats of the held key are merged in time order,
+ * so the caller can apply each one at its own timestamp.
+ * @param[in] *queue Pointer to the queue
+ * @param[in] until Current time, ms
+ * @param[out] *event Signal to apply and its timestamp
+ * @return 1 if a signal was taken, 0 if nothing is due yet
+ */
+int input_next(InputQueue_t *queue, long until, InputEvent_t *event) {
+  while (1) {
+    InputEvent_t *front = &queue->events[queue->head];
+    int has_event = queue->count > 0 && front->time <= until;
+    int has_repeat = queue->held != 0 && queue->repeats > 0 &&
+                     queue->next_repeat <= until &&
+                     queue->next_repeat <= held_until(queue);
+    if (has_event && (!has_repeat || front->time <= queue->next_repeat)) {
+      InputEvent_t ev = *front;
+      queue->head = (queue->head + 1) % INPUT_QUEUE_SIZE;
+      queue->count--;
+      if (is_repeatable(ev.sig)) {
+        if (is_terminal_repeat(queue, &ev)) {
+          count_repeat(queue, ev.time);
+          continue;
+        }
+        queue->held = ev.sig;
+        queue->pressed = ev.time;
+        queue->last_seen = ev.time;
+        queue->repeats = 0;
+        queue->next_repeat = ev.time + first_repeat_delay(ev.sig);
+      }
+      *event = ev;
+      return 1;
+    }
+    if (has_repeat) {
+      event->sig = queue->held;
+      event->time = queue->next_repeat;
+      queue->next_repeat += ARR_MS;
+      return 1;
+    }
+    if (queue->held != 0 && until > held_until(queue)) queue->held = 0;
+    return 0;
+  }
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Decodes one key from raw terminal input
+ *
+ * Used when the terminal is read directly rather than through getch().
+ * Arrow keys are mapped to the ncurses key codes, carriage return to '\n',
+ * so the result can be passed to get_signal().
+ * @param[in] *buf Bytes read from the terminal
+ * @param[in] len Number of bytes
+ * @param[out] *key Key code, 0 for an unknown escape sequence
+ * @return Returns the number of bytes used, 0 if len is 0 or the bytes end
+ * inside an escape sequence
+ */
+int input_decode(const char *buf, int len, int *key) {
+  if (len <= 0) return 0;
+  if (buf[0] != '\033') {
+    *key = buf[0] == '\r' ? '\n' : (unsigned char)buf[0];
+    return 1;
+  }
+  if (len >= 2 && buf[1] != '[' && buf[1] != 'O') {
+    *key = 0;
+    return 1;
+  }
+  if (len < 3) return 0;
+  switch (buf[2]) {
+    case 'A':
+      *key = KEY_UP;
+      break;
+    case 'B':
+      *key = KEY_DOWN;
+      break;
+    case 'C':
+      *key = KEY_RIGHT;
+      break;
+    case 'D':
+      *key = KEY_LEFT;
+      break;
+    default:
+      *key = 0;
+  }
+  return 3;
+}
+
+/**
+ * @ingroup input_funcs
+ * @brief Decodes raw terminal input and queues its signals
+ *
+ * An escape sequence cut by the end of the read is kept in the queue and
+ * completed by the next read. If that read comes more than INPUT_ESC_MS
+ * later, the kept bytes were a lone Esc and are dropped.
+ * @param[in] *queue Pointer to the queue
+ * @param[in] *buf Bytes read from the terminal
+ * @param[in] len Number of bytes
+ * @param[in] time Arrival time, ms
+ * @return Returns the number of signals queued
+ */
+int input_feed(InputQueue_t *queue, const char *buf, int len, long time) {
+  char bytes[64];
+  int queued = 0;
+  if (queue->pending_len > 0 && time - queue->pending_time > INPUT_ESC_MS)
+    queue->pending_len = 0;
+  int was_pending = queue->pending_len > 0;
+  while (len > 0) {
+    int n = queue->pending_len;
+    int take = len < (int)sizeof(bytes) - n ? len : (int)sizeof(bytes) - n;
+    memcpy(bytes, queue->pending, n);
+    memcpy(bytes + n, buf, take);
+    buf += take;
+    len -= take;
+    n += take;
+    int pos = 0, used = 0, key = 0;
+    while (pos < n && (used = input_decode(bytes + pos, n - pos, &key)) > 0) {
+      pos += used;
+      UserAction_t sig = get_signal(key);
+      if (sig != 0 && input_push(queue, sig, time) == 0) queued++;
+    }
+    queue->pending_len = n - pos;
+    memcpy(queue->pending, bytes + pos, n - pos);
+  }
+  if (queue->pending_len > 0 && !was_pending) queue->pending_time = time;
+  return queued;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file input.h
+ * @brief Buffered input queue with DAS/ARR auto-repeat
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+#include "tetris.h"
+
+/// Capacity of the input event queue
+#define INPUT_QUEUE_SIZE 64
+/// Bytes of an escape sequence cut by the end of a read that are kept
+#define INPUT_PENDING_SIZE 2
+/// Longest an escape sequence waits for its end from the next read, ms
+#define INPUT_ESC_MS 100
+/// Delayed auto-shift: how long Left/Right must be held before repeating, ms
+#define DAS_MS 170
+/// Auto-repeat rate: interval between repeated shifts, ms
+#define ARR_MS 50
+/// Once the terminal repeats a held key, the key is released when no repeat
+/// arrives within twice the measured repeat gap and at least this window, ms
+#define RELEASE_MS 60
+/// Range the terminal's delay before its first repeat is expected in until it
+/// has been measured, ms
+#define TYPEMATIC_MIN_MS 200
+#define TYPEMATIC_MAX_MS 700
+
+/**
+ * @brief Timestamped user signal
+ */
+typedef struct {
+  /// @brief Signal
+  UserAction_t sig;
+  /// @brief Arrival time, ms (monotonic clock)
+  long time;
+} InputEvent_t;
+
+/**
+ * @brief Ring buffer of pending signals plus the auto-repeat state
+ */
+typedef struct {
+  /// @brief Pending events in arrival order
+  InputEvent_t events[INPUT_QUEUE_SIZE];
+  /// @brief Index of the oldest event
+  int head;
+  /// @brief Number of pending events
+  int count;
+  /// @brief Direction currently held, 0 if none
+  UserAction_t held;
+  /// @brief Time the held key was pressed
+  long pressed;
+  /// @brief Time the held key was last reported by the terminal
+  long last_seen;
+  /// @brief Time of the next auto-repeat of the held key
+  long next_repeat;
+  /// @brief Repeats of the held key the terminal has sent
+  int repeats;
+  /// @brief Measured delay before the terminal's first repeat, 0 if unknown
+  long delay;
+  /// @brief Measured gap between the terminal's repeats, 0 if unknown
+  long repeat_gap;
+  /// @brief Start of an escape sequence the last read ended in
+  char pending[INPUT_PENDING_SIZE];
+  /// @brief Number of pending bytes
+  int pending_len;
+  /// @brief Time the pending bytes were read, ms
+  long pending_time;
+} InputQueue_t;
+
+/**
+ * @defgroup input_funcs Input queue and auto-repeat
+ */
+void input_init(InputQueue_t *queue);
+int input_push(InputQueue_t *queue, UserAction_t sig, long time);
+int input_next(InputQueue_t *queue, long until, InputEvent_t *event);
+int input_decode(const char *buf, int len, int *key);
+int input_feed(InputQueue_t *queue, const char *buf, int len, long time);
+
+#endif /* INPUT_H */
@@ -0,0 +1,318 @@
+/**
+ * @file journal.c
+ * @brief Crash-safe session log of inputs and key state transitions
+ */
+
+#include "journal.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(JournalHeader_t) == JOURNAL_HEADER_BYTES,
+               "journal header must fill one page");
+_Static_assert(sizeof(JournalRecord_t) == 160,
+               "journal records must keep their size");
+
+/// Bytes of a log file
+#define JOURNAL_BYTES \
+  (JOURNAL_HEADER_BYTES + JOURNAL_SLOTS * sizeof(JournalRecord_t))
+/// Ticks recovery waits at most for a tetromino to appear
+#define JOURNAL_SETTLE_TICKS 64
+
+/**
+ * @ingroup journal_funcs
+ * @brief Ticks a game has run for, counted the way step_ticks() counts them
+ * @param[in] *stats Pointer to stats struct
+ * @return Returns the number of ticks
+ */
+static uint32_t journal_ticks(const GameInfo_t *stats) {
+  long ticks = 0;
+  for (int i = 0; i <= EXIT_STATE; i++) ticks += stats->counters.state_ticks[i];
+  return ticks;
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Checksum of a record
+ * @param[in] *record Record
+ * @return Returns the CRC-32 of the bytes after the checksum field
+ */
+static uint32_t journal_crc(const JournalRecord_t *record) {
+  size_t from = offsetof(JournalRecord_t, seq);
+  return crc32_compute((const uint8_t *)record + from,
+                       sizeof(JournalRecord_t) - from);
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Numbers a record, seals it and copies it into the ring
+ * @param[in] *journal Log
+ * @param[in] *record Record, filled but for the number and checksum
+ * @param[in] *stats Game the record is about
+ */
+static void journal_append(Journal_t *journal, JournalRecord_t *record,
+                           const GameInfo_t *stats) {
+  record->seq = ++journal->seq;
+  record->tick = journal_ticks(stats);
+  record->score = stats->score;
+  record->pieces = stats->counters.pieces;
+  record->crc = journal_crc(record);
+  size_t slot = (record->seq - 1) % JOURNAL_SLOTS;
+  memcpy(&journal->records[slot], record, sizeof(JournalRecord_t));
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Creates a log file of full size and maps it
+ *
+ * Allocating the file up front means appending never extends it, so a full
+ * disk shows up here and not in the middle of a game.
+ * @param[out] *journal Log
+ * @param[in] *path File name, an existing file is replaced
+ * @return Returns 0 on success, 1 on an error
+ */
+int journal_open(Journal_t *journal, const char *path) {
+  memset(journal, 0, sizeof(Journal_t));
+  journal->snapshot_pieces = -1;
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return 1;
+  void *base = MAP_FAILED;
+  if (posix_fallocate(fd, 0, JOURNAL_BYTES) == 0)
+    base = mmap(NULL, JOURNAL_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return 1;
+  journal->base = base;
+  journal->records = (JournalRecord_t *)(journal->base + JOURNAL_HEADER_BYTES);
+  JournalHeader_t *header = base;
+  header->magic = JOURNAL_MAGIC;
+  header->version = JOURNAL_VERSION;
+  header->record_bytes = sizeof(JournalRecord_t);
+  header->slots = JOURNAL_SLOTS;
+  header->clean = 0;
+  return 0;
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Marks the session as ended normally and unmaps the log
+ * @param[in] *journal Log, may be closed already
+ */
+void journal_close(Journal_t *journal) {
+  if (journal->base == NULL) return;
+  ((JournalHeader_t *)journal->base)->clean = 1;
+  munmap(journal->base, JOURNAL_BYTES);
+  journal->base = NULL;
+  journal->records = NULL;
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Logs a signal about to be given to the game
+ * @param[in] *journal Log
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] sig Signal
+ */
+void journal_input(Journal_t *journal, const GameInfo_t *stats,
+                   UserAction_t sig) {
+  if (journal->base == NULL) return;
+  JournalRecord_t record = {0};
+  record.type = JOURNAL_INPUT;
+  record.sig = sig;
+  journal_append(journal, &record, stats);
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Logs a snapshot of the game if a tetromino appeared since the last
+ * one
+ *
+ * Called after every step of the game, a snapshot is only taken while a
+ * tetromino is falling.
+ * @param[in] *journal Log
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] state Current game state
+ */
+void journal_spawn(Journal_t *journal, const GameInfo_t *stats,
+                   FSM_STATES_g state) {
+  if (journal->base == NULL || state != MOVING ||
+      stats->counters.pieces == journal->snapshot_pieces)
+    return;
+  JournalRecord_t record = {0};
+  if (save_pack(stats, &record.game)) return;
+  record.type = JOURNAL_SPAWN;
+  journal->snapshot_pieces = stats->counters.pieces;
+  journal_append(journal, &record, stats);
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Logs the end of a game
+ * @param[in] *journal Log
+ * @param[in] *stats Pointer to stats struct
+ */
+void journal_game_over(Journal_t *journal, const GameInfo_t *stats) {
+  if (journal->base == NULL) return;
+  JournalRecord_t record = {0};
+  record.type = JOURNAL_GAME_OVER;
+  journal_append(journal, &record, stats);
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Lock hook logging every tetromino attaching
+ * @param[in] *event Tetromino that attached
+ * @param[in] *arg Log
+ */
+void journal_lock_hook(const LockEvent_t *event, void *arg) {
+  Journal_t *journal = arg;
+  if (journal->base == NULL) return;
+  JournalRecord_t record = {0};
+  record.type = JOURNAL_ATTACHING;
+  record.lines = event->lines;
+  journal_append(journal, &record, updateCurrentState());
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Record with a given sequence number, if it is in the ring intact
+ * @param[in] *records Ring
+ * @param[in] seq Sequence number
+ * @return Returns the record, NULL if it is missing or damaged
+ */
+static const JournalRecord_t *journal_find(const JournalRecord_t *records,
+                                           uint32_t seq) {
+  const JournalRecord_t *record = &records[(seq - 1) % JOURNAL_SLOTS];
+  if (seq == 0 || record->seq != seq || record->crc != journal_crc(record))
+    return NULL;
+  return record;
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Replays the records after a snapshot on the game bound to the
+ * calling thread
+ *
+ * An attaching whose score differs from the replay means the records cannot
+ * be trusted from there on, the game goes back to the last attaching that
+ * matched. Replay ends with the game, a new game would need the seed the
+ * next snapshot brings.
+ * @param[in] *records Ring
+ * @param[in] first Sequence number of the snapshot
+ * @param[in] last Sequence number of the last record to replay
+ * @param[in,out] *state Current game state
+ * @param[out] *report Counts of the records used
+ */
+static void journal_replay(const JournalRecord_t *records, uint32_t first,
+                           uint32_t last, FSM_STATES_g *state,
+                           JournalReport_t *report) {
+  GameInfo_t *stats = updateCurrentState();
+  GameInfo_t verified = *stats;
+  FSM_STATES_g verified_state = *state;
+  uint32_t seq = first + 1;
+  for (; seq <= last && *state != GAME_OVER && *state != EXIT_STATE; seq++) {
+    const JournalRecord_t *record = journal_find(records, seq);
+    step_ticks(state, (long)record->tick - journal_ticks(stats));
+    if (record->type == JOURNAL_INPUT && *state != SPAWN)
+      userInput(state, record->sig);
+    if (record->type == JOURNAL_ATTACHING) {
+      if ((uint32_t)stats->counters.pieces != record->pieces ||
+          stats->score != record->score) {
+        *stats = verified;
+        *state = verified_state;
+        break;
+      }
+      verified = *stats;
+      verified_state = *state;
+      report->verified++;
+    }
+    report->replayed++;
+  }
+  report->dropped += last + 1 - seq;
+}
+
+/**
+ * @ingroup journal_funcs
+ * @brief Rebuilds the last consistent state of a logged game
+ *
+ * Finds the newest snapshot followed by an unbroken run of valid records,
+ * replays the run and lets the game go on until a tetromino falls, so it
+ * can be resumed from a pause.
+ * @param[in] *path Log file
+ * A log the session closed normally is still replayed for the report, but
+ * there is nothing to recover from it.
+ * @param[out] *stats Pointer to stats struct, left as it was unless a game
+ * was rebuilt
+ * @param[out] *state State of the rebuilt game, MOVING
+ * @param[out] *report What was found in the log
+ * @return Returns 0 if a game was rebuilt, 1 if there is no usable log or
+ * snapshot, 2 if the logged game had ended, 3 if the log was closed
+ */
+int journal_recover(const char *path, GameInfo_t *stats, FSM_STATES_g *state,
+                    JournalReport_t *report) {
+  memset(report, 0, sizeof(JournalReport_t));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 1;
+  struct stat info;
+  const uint8_t *base = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size == (off_t)JOURNAL_BYTES)
+    base = mmap(NULL, JOURNAL_BYTES, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return 1;
+  const JournalHeader_t *header = (const JournalHeader_t *)base;
+  const JournalRecord_t *records =
+      (const JournalRecord_t *)(base + JOURNAL_HEADER_BYTES);
+  if (header->magic != JOURNAL_MAGIC || header->version != JOURNAL_VERSION ||
+      header->record_bytes != sizeof(JournalRecord_t) ||
+      header->slots != JOURNAL_SLOTS) {
+    munmap((void *)base, JOURNAL_BYTES);
+    return 1;
+  }
+  report->clean = header->clean;
+  for (int i = 0; i < JOURNAL_SLOTS; i++) {
+    if (records[i].seq == 0 || records[i].crc != journal_crc(&records[i]))
+      continue;
+    report->records++;
+    if (records[i].seq > report->last) report->last = records[i].seq;
+  }
+
+  uint32_t last = report->last;
+  for (uint32_t seq = last; seq > 0 && report->last - seq < JOURNAL_SLOTS;
+       seq--) {
+    const JournalRecord_t *record = journal_find(records, seq);
+    if (record == NULL) {
+      last = seq - 1;
+    } else if (record->type == JOURNAL_SPAWN) {
+      report->snapshot = seq;
+      break;
+    }
+  }
+  report->dropped = report->last - last;
+
+  int result = 1;
+  GameInfo_t game = {0};
+  bind_game_state(&game);
+  stats_init(&game);
+  if (report->snapshot != 0 &&
+      save_unpack(&journal_find(records, report->snapshot)->game, &game) ==
+          0) {
+    *state = MOVING;
+    journal_replay(records, report->snapshot, last, state, report);
+    for (int t = 0; t < JOURNAL_SETTLE_TICKS &&
+                    (*state == ATTACHING || *state == SPAWN);
+         t++)
+      step_ticks(state, 1);
+    if (*state == PAUSE) {
+      game.pause = 0;
+      *state = MOVING;
+    }
+    result = *state != MOVING ? 2 : report->clean ? 3 : 0;
+  }
+  bind_game_state(NULL);
+  if (result == 0) *stats = game;
+  munmap((void *)base, JOURNAL_BYTES);
+  return result;
+}
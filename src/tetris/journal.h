@@ -0,0 +1,140 @@
+/**
+ * @file journal.h
+ * @brief Crash-safe session log of inputs and key state transitions
+ *
+ * The log is a file of fixed size: a header page and a ring of
+ * JOURNAL_SLOTS fixed-size records, allocated up front and mapped shared.
+ * Appending a record is a copy into the mapping and never calls into the
+ * kernel, the page cache writes the pages back whenever it likes. If the
+ * process dies, the kernel still writes back what was copied; if the
+ * machine dies, some records may be torn or missing.
+ *
+ * Every record carries a sequence number and a CRC-32, so recovery takes
+ * only an unbroken run of valid records. The run starts from a snapshot of
+ * the game taken when a tetromino appears, replays the inputs that followed
+ * and checks the score against every attaching logged after it. Replay is
+ * exact because the engine depends only on the game state and the tick
+ * count, and every record carries the game's tick count.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include <stdint.h>
+
+#include "save.h"
+
+/// First bytes of a log file, "TJL1" read as little-endian
+#define JOURNAL_MAGIC 0x314C4A54u
+/// Version of the log layout and rules, 2 since turns take SRS kicks
+#define JOURNAL_VERSION 2
+/// Records in the ring
+#define JOURNAL_SLOTS 8192
+/// Bytes of the header, one page
+#define JOURNAL_HEADER_BYTES 4096
+
+/**
+ * @brief Kinds of records
+ */
+typedef enum {
+  JOURNAL_INPUT = 1,
+  JOURNAL_SPAWN,
+  JOURNAL_ATTACHING,
+  JOURNAL_GAME_OVER
+} JournalType_t;
+
+/**
+ * @brief First page of a log file
+ */
+typedef struct {
+  /// @brief JOURNAL_MAGIC
+  uint32_t magic;
+  /// @brief JOURNAL_VERSION
+  uint16_t version;
+  /// @brief sizeof(JournalRecord_t)
+  uint16_t record_bytes;
+  /// @brief JOURNAL_SLOTS
+  uint32_t slots;
+  /// @brief Set when the session ended normally
+  uint32_t clean;
+  /// @brief Zero
+  uint8_t reserved[JOURNAL_HEADER_BYTES - 16];
+} JournalHeader_t;
+
+/**
+ * @brief One record, 160 bytes
+ */
+typedef struct {
+  /// @brief CRC-32 of the bytes following this field
+  uint32_t crc;
+  /// @brief Sequence number, the first record is 1
+  uint32_t seq;
+  /// @brief Ticks the game had run for
+  uint32_t tick;
+  /// @brief JournalType_t
+  uint8_t type;
+  /// @brief Signal of an input
+  uint8_t sig;
+  /// @brief Rows cleared by an attaching
+  uint8_t lines;
+  /// @brief Zero
+  uint8_t reserved;
+  /// @brief Score after the record
+  int32_t score;
+  /// @brief Tetrominos attached after the record
+  uint32_t pieces;
+  /// @brief Zero
+  uint32_t reserved2;
+  /// @brief Game when a tetromino appeared, only in a spawn record
+  SaveFile_t game;
+} JournalRecord_t;
+
+/**
+ * @brief Log being written
+ */
+typedef struct {
+  /// @brief Mapped file
+  uint8_t *base;
+  /// @brief Records
+  JournalRecord_t *records;
+  /// @brief Sequence number of the last record
+  uint32_t seq;
+  /// @brief Tetrominos attached when the last snapshot was taken, -1 if
+  /// there was none
+  long snapshot_pieces;
+} Journal_t;
+
+/**
+ * @brief What recovery found in a log
+ */
+typedef struct {
+  /// @brief Set if the session ended normally
+  int clean;
+  /// @brief Valid records in the ring
+  uint32_t records;
+  /// @brief Highest valid sequence number
+  uint32_t last;
+  /// @brief Sequence number of the snapshot replay started from, 0 if none
+  uint32_t snapshot;
+  /// @brief Records replayed after the snapshot
+  uint32_t replayed;
+  /// @brief Attachings whose score matched
+  uint32_t verified;
+  /// @brief Records after the snapshot that were not used
+  uint32_t dropped;
+} JournalReport_t;
+
+/**
+ * @defgroup journal_funcs Session log
+ */
+int journal_open(Journal_t *journal, const char *path);
+void journal_close(Journal_t *journal);
+void journal_input(Journal_t *journal, const GameInfo_t *stats,
+                   UserAction_t sig);
+void journal_spawn(Journal_t *journal, const GameInfo_t *stats,
+                   FSM_STATES_g state);
+void journal_game_over(Journal_t *journal, const GameInfo_t *stats);
+void journal_lock_hook(const LockEvent_t *event, void *arg);
+int journal_recover(const char *path, GameInfo_t *stats, FSM_STATES_g *state,
+                    JournalReport_t *report);
+
+#endif /* JOURNAL_H */
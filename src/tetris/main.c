@@ -2,51 +2,588 @@
  * @file main.c
  * @brief Точка запуска игры
  * @author nataliak
+ *
+ * Игра считается в главном потоке, рисуется в отдельном. Потоки обмениваются
+ * снимками игры через тройной буфер, поэтому медленный терминал не
+ * задерживает ни гравитацию, ни обработку нажатий. Все вызовы ncurses
+ * делает только поток отрисовки, нажатия читаются напрямую из stdin.
+ *
+ * Переменная окружения TETRIS_RENDER=ansi включает вывод ANSI-кодами без
+ * ncurses, он передаёт только изменившиеся участки экрана одним write() на
+ * кадр. С переменной TETRIS_STATS после выхода в stderr выводится задержка
+ * отрисовки и объём вывода на кадр. TETRIS_TELEMETRY=файл дописывает в файл
+ * запись телеметрии о каждой законченной игре. TETRIS_DATASET=файл пишет в
+ * файл набор данных: поле, фигуры, положение и очки каждой упавшей фигуры.
+ *
+ * Выход посреди игры сохраняет её в SAVE_FILE, следующий запуск продолжает
+ * её с паузы. Во время игры нажатия, появление и падение фигур и конец игры
+ * пишутся в журнал JOURNAL_FILE. Если процесс был убит и игра не сохранилась,
+ * следующий запуск восстанавливает её из журнала.
+ *
+ * TETRIS_VERSUS=N включает игру против бота на двух досках: бот играет
+ * правой доской и подаёт сигнал раз в N тиков. Очищенные ряды отправляют
+ * мусор сопернику. Такая игра не сохраняется и не меняет рекорд.
+ *
+ * TETRIS_HINT=N включает подсказку: пока фигура падает, отдельный поток ищет
+ * для неё место, углубляя поиск до N фигур, и лучшее найденное место
+ * рисуется контуром. Клавиша R возвращает игру на одну фигуру назад.
+ *
+ * TETRIS_BOT=файл.so отдаёт игру боту из разделяемой библиотеки с
+ * интерфейсом bot_plugin.h. Бот подаёт один сигнал за проход цикла через
+ * тот же автомат, что и нажатия; пауза, выход и новая игра остаются за
+ * игроком.
  */
 
-#include "tetris.h"
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../gui/ansi.h"
+#include "dataset.h"
+#include "frame.h"
+#include "hint.h"
+#include "input.h"
+#include "journal.h"
+#include "plugin.h"
+#include "rewind.h"
+#include "save.h"
+#include "telemetry.h"
+#include "versus.h"
+
+/// Файл прерванной игры
+#define SAVE_FILE "suspended"
+/// Журнал текущей игры
+#define JOURNAL_FILE "session.log"
+/// Столбец, с которого рисуется доска соперника: сразу за панелью игрока,
+/// так обе доски умещаются в терминал 80x24
+#define VERSUS_OFFSET PANEL_COLS
+/// Тиков между сигналами бота, если в TETRIS_VERSUS не число
+#define VERSUS_INTERVAL 10
+
+/**
+ * @brief Общие данные потоков игры и отрисовки
+ */
+typedef struct {
+  /// @brief Тройной буфер снимков
+  FrameBuffer_t frames;
+  /// @brief Задержка от изменения игры до экрана
+  LatencyStats_t latency;
+  /// @brief Номер последнего нарисованного снимка
+  unsigned long drawn_seq;
+  /// @brief Была ли на последнем нарисованном снимке проиграна доска
+  int drawn_over;
+  /// @brief Флаг завершения потока отрисовки
+  int done;
+  /// @brief Вывод ANSI-кодами, если выбран
+  AnsiScreen_t ansi;
+} Screen_t;
+
+static Screen_t screen;
+
+/// Файл телеметрии, NULL если она не пишется
+static const char *telemetry_path = NULL;
+/// Состояние, с которого начинается игра
+static FSM_STATES_g first_state = START;
+/// Время восстановления прерванной игры, мкс, -1 если её не было
+static long resume_us = -1;
+/// Тиков между сигналами бота в игре против него, 0 в обычной игре
+static int versus_interval = 0;
+/// Поток набора данных, NULL если он не пишется
+static DatasetStream_t *dataset = NULL;
+/// Журнал игры, не открыт в игре против бота
+static Journal_t journal;
+/// История упавших фигур для шага назад
+static Rewind_t history;
+/// Поиск подсказки, NULL если подсказки выключены
+static Hint_t *hint = NULL;
+/// Бот, играющий вместо игрока, NULL если играет человек
+static Plugin_t *controller = NULL;
+/// Пауза или выход, нажатые до появления фигуры, 0 если их не было
+static UserAction_t deferred = 0;
+/// Записан ли конец текущей игры: после шага назад из конца игры новый
+/// проигрыш уже не пишется
+static int game_recorded = 0;
+
+/**
+ * @brief Вывод задержки отрисовки и объёма вывода
+ * @param[in] bytes Байт записано процессом до начала игры
+ * @param[in] writes Вызовов write() до начала игры
+ */
+static void report_stats(long bytes, long writes) {
+  long frames = screen.latency.count > 0 ? screen.latency.count : 1;
+  long bytes_now = 0, writes_now = 0;
+  latency_report(&screen.latency, stderr);
+  if (resume_us >= 0) fprintf(stderr, "resume: %ld us\n", resume_us);
+  if (hint != NULL)
+    fprintf(stderr, "hint: %ld searches, %ld stopped by a new piece\n",
+            __atomic_load_n(&hint->searches, __ATOMIC_RELAXED),
+            __atomic_load_n(&hint->stopped, __ATOMIC_RELAXED));
+  if (controller != NULL && controller->calls > 0)
+    fprintf(stderr, "bot %s: %ld decisions, %.0f ns each\n",
+            controller->api->name, controller->calls,
+            (double)controller->call_ns / controller->calls);
+  if (output_counters(&bytes_now, &writes_now) == 0) {
+    fprintf(stderr, "output (%s): %.1f bytes/frame, %.2f writes/frame\n",
+            ansi_screen() != NULL ? "ansi" : "ncurses",
+            (double)(bytes_now - bytes) / frames,
+            (double)(writes_now - writes) / frames);
+  }
+}
+
+/**
+ * @brief Восстановление игры, прерванной при прошлом запуске
+ *
+ * Игра продолжается с паузы. Повреждённый файл удаляется, игра начинается
+ * заново. Если файла нет, а прошлый запуск не закрыл журнал, игра
+ * восстанавливается из журнала.
+ */
+static void resume_game() {
+  long start = get_time_us();
+  GameInfo_t *stats = updateCurrentState();
+  FSM_STATES_g state;
+  JournalReport_t report;
+  if (load_game(SAVE_FILE, stats) == 0 ||
+      journal_recover(JOURNAL_FILE, stats, &state, &report) == 0) {
+    stats->pause = 1;
+    first_state = PAUSE;
+    resume_us = get_time_us() - start;
+  }
+}
+
+/**
+ * @brief Передача упавшей фигуры набору данных, журналу и истории шагов
+ * назад
+ *
+ * В игре против бота не ставится: там нет ни журнала, ни шага назад.
+ * @param[in] *event Упавшая фигура
+ * @param[in] *arg Не используется
+ */
+static void session_lock_hook(const LockEvent_t *event, void *arg) {
+  (void)arg;
+  if (dataset != NULL) dataset_lock_hook(event, dataset);
+  journal_lock_hook(event, &journal);
+  rewind_lock_hook(event, &history);
+}
 
 /**
  * @brief Точка входа в игру
  */
 int main() {
   srand(time(NULL));
-  initscr();
-  noecho();
-  curs_set(0);
-  keypad(stdscr, true);
-  timeout(10);
+  telemetry_path = getenv("TETRIS_TELEMETRY");
+  const char *versus = getenv("TETRIS_VERSUS");
+  if (versus != NULL) {
+    versus_interval = atoi(versus);
+    if (versus_interval <= 0) versus_interval = VERSUS_INTERVAL;
+    set_score_file(NULL);
+  } else {
+    resume_game();
+    journal_open(&journal, JOURNAL_FILE);
+    const char *depth = getenv("TETRIS_HINT");
+    if (depth != NULL)
+      hint = hint_create(atoi(depth) > 0 ? atoi(depth) : HINT_MAX_DEPTH, 1);
+    const char *bot = getenv("TETRIS_BOT");
+    if (bot != NULL &&
+        (controller = plugin_load(bot, updateCurrentState())) == NULL) {
+      fprintf(stderr, "cannot load bot %s\n", bot);
+      return 1;
+    }
+  }
+  const char *dataset_path = getenv("TETRIS_DATASET");
+  DatasetWriter_t *writer =
+      dataset_path != NULL && versus == NULL ? dataset_create(dataset_path)
+                                             : NULL;
+  if (writer != NULL) dataset = dataset_stream(writer);
+  if (versus == NULL) set_lock_hook(session_lock_hook, NULL);
+  long bytes = 0, writes = 0;
+  output_counters(&bytes, &writes);
+  const char *render = getenv("TETRIS_RENDER");
+  if (render != NULL && strcmp(render, "ansi") == 0 &&
+      ansi_init(&screen.ansi, STDOUT_FILENO) == 0) {
+    ansi_attach(&screen.ansi);
+  } else {
+    initscr();
+    cbreak();
+    noecho();
+    curs_set(0);
+    keypad(stdscr, true);
+  }
   game_loop();
-  endwin();
+  if (ansi_screen() != NULL)
+    ansi_end(&screen.ansi);
+  else
+    endwin();
+  set_lock_hook(NULL, NULL);
+  journal_close(&journal);
+  if (writer != NULL) {
+    dataset_stream_close(dataset);
+    dataset_close(writer);
+  }
+  if (getenv("TETRIS_STATS") != NULL) report_stats(bytes, writes);
+  hint_free(hint);
+  plugin_free(controller);
+  TRACE_WRITE();
   return 0;
 }
 
 /**
- * @brief Старт и инициализация игры
+ * @brief Отрисовка последнего снимка игры, если он новый
  */
-void game_loop() {
-  FSM_STATES_g state = START;
+static void render_frame() {
+  Frame_t *frame = frame_latest(&screen.frames);
+  if (frame == NULL) return;
+  int over = frame->state == GAME_OVER || frame->rival_state == GAME_OVER;
+  if (screen.drawn_over && !over) clear_screen();
+  bind_game_state(&frame->stats);
+  set_hint(frame->hinted ? &frame->hint : NULL, frame->hint_x, frame->hint_y);
+  print_something(frame->state);
+  set_hint(NULL, 0, 0);
+  if (frame->versus) {
+    print_garbage(frame->garbage[0]);
+    set_draw_offset(VERSUS_OFFSET);
+    bind_game_state(&frame->rival);
+    print_something(frame->rival_state);
+    print_garbage(frame->garbage[1]);
+    set_draw_offset(0);
+  }
+  bind_game_state(NULL);
+  if (ansi_screen() != NULL)
+    ansi_flush(ansi_screen());
+  else
+    refresh();
+  latency_add(&screen.latency, get_time_us() - frame->published_us);
+  if (screen.drawn_seq != 0 && frame->seq > screen.drawn_seq + 1)
+    screen.latency.skipped += frame->seq - screen.drawn_seq - 1;
+  screen.drawn_seq = frame->seq;
+  screen.drawn_over = over;
+}
+
+/**
+ * @brief Поток отрисовки
+ * @param[in] *arg Не используется
+ * @return NULL
+ */
+static void *render_loop(void *arg) {
+  (void)arg;
+  struct timespec pause = {0, 1000000};
+  while (!__atomic_load_n(&screen.done, __ATOMIC_ACQUIRE)) {
+    render_frame();
+    nanosleep(&pause, NULL);
+  }
+  render_frame();
+  return NULL;
+}
+
+/**
+ * @brief Копия игры для снимка
+ *
+ * Счётчики тиков не видны на экране и обнуляются, чтобы не мешать сравнению
+ * снимков.
+ * @param[out] *view Копия
+ * @param[in] *stats Игра
+ */
+static void frame_view(GameInfo_t *view, const GameInfo_t *stats) {
+  *view = *stats;
+  view->gravity_ticks = 0;
+  view->delay_ticks = 0;
+  view->seed = 0;
+  view->counters = (GameCounters_t){0};
+}
+
+/**
+ * @brief Передача снимка потоку отрисовки, если он отличается от прошлого
+ * @param[in] *view Снимок без времени и номера
+ */
+static void publish_view(const Frame_t *view) {
+  static Frame_t last;
+  static unsigned long seq = 0;
+  if (seq != 0 && memcmp(view, &last, sizeof(Frame_t)) == 0) return;
+  last = *view;
+  Frame_t *frame = frame_back(&screen.frames);
+  *frame = *view;
+  frame->published_us = get_time_us();
+  frame->seq = ++seq;
+  frame_publish(&screen.frames);
+}
+
+/**
+ * @brief Передача снимка игры потоку отрисовки, если игра изменилась
+ * @param[in] state Текущее состояние игры
+ */
+static void publish_frame(FSM_STATES_g state) {
+  static Frame_t view;
+  memset(&view, 0, sizeof(Frame_t));
+  frame_view(&view.stats, updateCurrentState());
+  view.state = state;
+  HintMove_t move;
+  if (hint != NULL && state == MOVING && hint_best(hint, &move) == 0) {
+    view.hinted = 1;
+    view.hint =
+        piece_tetromino(view.stats.current_tetromino.type, move.rot);
+    view.hint_x = move.x;
+    view.hint_y = move.y;
+  }
+  publish_view(&view);
+}
+
+/**
+ * @brief Передача новой падающей фигуры поиску подсказки
+ *
+ * Фигура передаётся в том же проходе цикла, в котором появилась.
+ * @param[in] state Текущее состояние игры
+ */
+static void post_hint(FSM_STATES_g state) {
+  static int posted_pieces = -1;
+  GameInfo_t *stats = updateCurrentState();
+  if (hint == NULL || state != MOVING ||
+      stats->counters.pieces == posted_pieces)
+    return;
+  posted_pieces = stats->counters.pieces;
+  hint_post(hint, stats);
+}
+
+/**
+ * @brief Передача снимка обеих досок потоку отрисовки, если они изменились
+ * @param[in] *match Матч
+ */
+static void publish_versus(const Versus_t *match) {
+  static Frame_t view;
+  memset(&view, 0, sizeof(Frame_t));
+  view.versus = 1;
+  frame_view(&view.stats, &match->sides[0].game);
+  view.state = match->sides[0].state;
+  frame_view(&view.rival, &match->sides[1].game);
+  view.rival_state = match->sides[1].state;
+  for (int i = 0; i < 2; i++) view.garbage[i] = match->sides[i].pending.rows;
+  publish_view(&view);
+}
+
+/**
+ * @brief Перенос всех ожидающих нажатий в очередь ввода
+ *
+ * Ждёт ввода до TICK_MS мс, затем забирает всё, что накопилось.
+ * @param[in] *queue Очередь ввода
+ */
+static void poll_input(InputQueue_t *queue) {
+  struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+  if (poll(&fd, 1, TICK_MS) <= 0) return;
+  char buf[64];
+  int len = read(STDIN_FILENO, buf, sizeof(buf));
+  if (len > 0) input_feed(queue, buf, len, get_time_ms());
+}
+
+/**
+ * @brief Действия по окончании игры
+ *
+ * Рекорд записывается здесь, а не при каждом падении фигуры. Выход посреди
+ * игры сохраняет её, чтобы продолжить при следующем запуске. Проигрыш, а
+ * также выход, если игру не удалось сохранить, дописывают запись телеметрии.
+ * Конец игры попадает в журнал, набор данных и телеметрию один раз: игра,
+ * продолженная шагом назад после проигрыша, считается тренировкой.
+ * @param[in] before Состояние игры до шага
+ * @param[in] after Состояние игры после шага
+ */
+static void finish_game(FSM_STATES_g before, FSM_STATES_g after) {
+  if (before == after) return;
+  if (before == GAME_OVER && after == SPAWN) game_recorded = 0;
+  GameInfo_t *stats = updateCurrentState();
+  int first = !game_recorded;
+  if (after == GAME_OVER && first) {
+    journal_game_over(&journal, stats);
+    if (dataset != NULL) dataset->game++;
+  }
+  if (after == GAME_OVER || after == EXIT_STATE) save_score();
+  int quit = after == EXIT_STATE && before != START && before != GAME_OVER;
+  if (after == GAME_OVER) game_recorded = 1;
+  if (quit && save_game(SAVE_FILE, stats) == 0) return;
+  if ((after == GAME_OVER || quit) && first && telemetry_path != NULL) {
+    TelemetryRecord_t record;
+    telemetry_record(stats, &record);
+    telemetry_append(telemetry_path, &record);
+  }
+}
+
+/**
+ * @brief Обработка одного сигнала пользователя
+ *
+ * Движения во время паузы перед появлением фигуры не обрабатываются, пауза
+ * и выход откладываются до её появления. Остальные нажатия пишутся в журнал
+ * до того, как попадут в игру. Шаг назад в
+ * журнал не пишется: после него журнал продолжается с нового снимка игры.
+ * @param[in] *state Текущее состояние игры
+ * @param[in] sig Сигнал пользователя
+ */
+static void apply_signal(FSM_STATES_g *state, UserAction_t sig) {
+  if (*state == SPAWN) {
+    if (sig == Terminate || (sig == Pause && deferred == 0))
+      deferred = sig;
+    else if (sig == Pause && deferred == Pause)
+      deferred = 0;
+    return;
+  }
+  FSM_STATES_g before = *state;
+  if (sig == Rewind) {
+    if (rewind_step(&history, state, 1) > 0) journal.snapshot_pieces = -1;
+  } else {
+    journal_input(&journal, updateCurrentState(), sig);
+    userInput(state, sig);
+  }
+  journal_spawn(&journal, updateCurrentState(), *state);
+  finish_game(before, *state);
+}
+
+/**
+ * @brief Ход бота: один сигнал его плана
+ *
+ * Бота спрашивают, когда начинает падать новая фигура, а также после паузы
+ * и шага назад. Когда сигналы плана кончаются, бот опускает фигуру.
+ * @param[in] *state Текущее состояние игры
+ */
+static void controller_step(FSM_STATES_g *state) {
+  static Placement_t plan;
+  static int planned = -1, step = 0;
   GameInfo_t *stats = updateCurrentState();
-  struct timespec ts;
-  clock_gettime(CLOCK_MONOTONIC, &ts);
-  long last_time = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-  long current_time;
-  UserAction_t sig = 0;
+  if (*state != MOVING) {
+    planned = -1;
+    return;
+  }
+  if (planned != stats->counters.pieces) {
+    if (plugin_plan(controller, &plan) != 0) plan.path_len = 0;
+    planned = stats->counters.pieces;
+    step = 0;
+  }
+  apply_signal(state, step < plan.path_len ? plan.path[step++] : Down);
+}
+
+/**
+ * @brief Продвижение игровых часов до заданного момента
+ *
+ * Время переводится в целое число тиков, остаток копится до следующего
+ * вызова. Пауза и выход, отложенные до появления фигуры, применяются сразу
+ * после него.
+ * @param[in] *state Текущее состояние игры
+ * @param[in] sim_time Момент, до которого игра уже просчитана, мс
+ * @param[in] time Момент, до которого нужно досчитать, мс
+ * @return Новый момент, до которого просчитана игра, мс
+ */
+static long advance_clock(FSM_STATES_g *state, long sim_time, long time) {
+  long ticks = (time - sim_time) / TICK_MS;
+  if (ticks <= 0) return sim_time;
+  FSM_STATES_g before = *state;
+  step_ticks(state, ticks);
+  journal_spawn(&journal, updateCurrentState(), *state);
+  finish_game(before, *state);
+  if (*state != SPAWN && deferred != 0) {
+    UserAction_t sig = deferred;
+    deferred = 0;
+    apply_signal(state, sig);
+  }
+  return sim_time + ticks * TICK_MS;
+}
+
+/**
+ * @brief Обычная игра
+ * @param[in] *queue Очередь ввода
+ * @param[in] threaded Запущен ли поток отрисовки
+ */
+static void play_single(InputQueue_t *queue, int threaded) {
+  FSM_STATES_g state = first_state;
+  InputEvent_t event;
+  publish_frame(state);
+  long sim_time = get_time_ms();
   while (state != EXIT_STATE) {
-    print_something(state);
-    sig = getch();
-    userInput(&state, get_signal(sig));
-    while (state == MOVING) {
-      sig = getch();
-      moving_state(&state, get_signal(sig));
-      print_game();
-      clock_gettime(CLOCK_MONOTONIC, &ts);
-      current_time = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-      if (current_time - last_time > stats->speed) {
-        move_down(&state);
-        last_time = current_time;
-      }
+    if (!threaded) render_frame();
+    poll_input(queue);
+    long now = get_time_ms();
+    while (state != EXIT_STATE && input_next(queue, now, &event)) {
+      sim_time = advance_clock(&state, sim_time, event.time);
+      apply_signal(&state, event.sig);
     }
-    refresh();
+    if (controller != NULL) controller_step(&state);
+    sim_time = advance_clock(&state, sim_time, now);
+    post_hint(state);
+    publish_frame(state);
   }
 }
+
+/**
+ * @brief Начало матча против бота
+ * @param[out] *match Матч
+ */
+static void start_versus(Versus_t *match) {
+  versus_init(match, rand());
+  match->sides[1].bot.interval = versus_interval;
+}
+
+/**
+ * @brief Продвижение матча до заданного момента
+ * @param[in] *match Матч
+ * @param[in] sim_time Момент, до которого матч уже просчитан, мс
+ * @param[in] time Момент, до которого нужно досчитать, мс
+ * @param[in] paused Стоит ли матч на паузе
+ * @return Новый момент, до которого просчитан матч, мс
+ */
+static long advance_versus(Versus_t *match, long sim_time, long time,
+                           int paused) {
+  long ticks = (time - sim_time) / TICK_MS;
+  if (ticks <= 0) return sim_time;
+  for (long t = 0; t < ticks && !paused; t++) versus_tick(match);
+  return sim_time + ticks * TICK_MS;
+}
+
+/**
+ * @brief Игра против бота
+ *
+ * Игрок управляет левой доской. Пауза останавливает обе доски, после конца
+ * матча Enter начинает новый.
+ * @param[in] *queue Очередь ввода
+ * @param[in] threaded Запущен ли поток отрисовки
+ */
+static void play_versus(InputQueue_t *queue, int threaded) {
+  static Versus_t match;
+  InputEvent_t event;
+  int paused = 0, done = 0;
+  start_versus(&match);
+  publish_versus(&match);
+  long sim_time = get_time_ms();
+  while (!done) {
+    if (!threaded) render_frame();
+    poll_input(queue);
+    long now = get_time_ms();
+    while (!done && input_next(queue, now, &event)) {
+      sim_time = advance_versus(&match, sim_time, event.time, paused);
+      if (event.sig == Terminate)
+        done = 1;
+      else if (event.sig == Pause && match.winner == VERSUS_PLAYING)
+        paused = !paused;
+      else if (event.sig == Start && match.winner != VERSUS_PLAYING)
+        start_versus(&match);
+      else if (!paused)
+        versus_input(&match, 0, event.sig);
+    }
+    sim_time = advance_versus(&match, sim_time, now, paused);
+    publish_versus(&match);
+  }
+}
+
+/**
+ * @brief Старт и инициализация игры
+ *
+ * Ввод и гравитация считаются в тиках, снимок игры публикуется после каждого
+ * прохода цикла, в котором она изменилась. Если поток отрисовки не удалось
+ * запустить, снимки рисуются здесь же.
+ */
+void game_loop() {
+  InputQueue_t queue;
+  pthread_t renderer;
+  input_init(&queue);
+  frame_init(&screen.frames);
+  int threaded = pthread_create(&renderer, NULL, render_loop, NULL) == 0;
+  if (versus_interval > 0)
+    play_versus(&queue, threaded);
+  else
+    play_single(&queue, threaded);
+  __atomic_store_n(&screen.done, 1, __ATOMIC_RELEASE);
+  if (threaded) pthread_join(renderer, NULL);
+}
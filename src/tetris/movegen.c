@@ -0,0 +1,198 @@
+/**
+ * @file movegen.c
+ * @brief Breadth-first move generator over tetromino positions
+ *
+ * The rules are those of the reference engine, quirks included: a shift
+ * and a turn are checked one row above the position, a Down at the
+ * position itself, and a Down that collides attaches the tetromino one row
+ * above. A turn takes the first kick of board_kicks that fits.
+ *
+ * Before the search, the columns a rotation fits in are worked out for
+ * every row at once with shifts of the row words, so every move of the
+ * search, every kick of a turn included, is checked by testing one bit.
+ */
+
+#include "movegen.h"
+
+#include <string.h>
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Index of a state
+ * @param[in] rot Rotation
+ * @param[in] x Position at X
+ * @param[in] y Position at Y
+ * @return Returns the index
+ */
+static int movegen_index(int rot, int x, int y) {
+  return (rot * MOVEGEN_ROWS + y + 1) * MOVEGEN_COLS + x + BOARD_SHIFT;
+}
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Fills the columns every rotation of a tetromino fits in
+ * @param[in] *gen Search
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ */
+static void movegen_fits(MoveGen_t *gen, const uint16_t *rows, int type) {
+  const uint16_t columns = (1 << MOVEGEN_COLS) - 1;
+  for (int rot = 0; rot < piece_rotations(type); rot++) {
+    const uint8_t *mask = piece_masks[type][rot];
+    for (int r = -MOVEGEN_ABOVE; r <= MOVEGEN_ROWS; r++) {
+      uint16_t blocked = 0;
+      for (int j = 0; j < 4 && blocked != columns; j++) {
+        if (mask[j] == 0) continue;
+        if (r + j < 0 || r + j >= BOARD_HEIGHT) {
+          blocked = columns;
+          break;
+        }
+        for (int b = 0; b < 4; b++) {
+          if (mask[j] & (1 << b)) blocked |= rows[r + j] >> b;
+        }
+      }
+      gen->fits[rot][r + MOVEGEN_ABOVE] = ~blocked & columns;
+    }
+  }
+}
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Checks whether a rotation fits at a position
+ * @param[in] *gen Search
+ * @param[in] rot Rotation
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ * @return Returns 1 if it fits
+ */
+static int movegen_fit(const MoveGen_t *gen, int rot, int x, int row) {
+  return x >= -BOARD_SHIFT && x < BOARD_WIDTH &&
+         (gen->fits[rot][row + MOVEGEN_ABOVE] >> (x + BOARD_SHIFT) & 1);
+}
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Queues a state unless it was already visited
+ * @param[in] *gen Search
+ * @param[in] *tail Number of queued states
+ * @param[in] rot Rotation
+ * @param[in] x Position at X
+ * @param[in] y Position at Y
+ * @param[in] from State it is reached from
+ * @param[in] action Signal it is reached with
+ */
+static void movegen_push(MoveGen_t *gen, int *tail, int rot, int x, int y,
+                         int from, UserAction_t action) {
+  uint16_t bit = 1 << (x + BOARD_SHIFT);
+  if (gen->visited[rot][y + 1] & bit) return;
+  gen->visited[rot][y + 1] |= bit;
+  int index = movegen_index(rot, x, y);
+  gen->parent[index] = from;
+  gen->action[index] = action;
+  gen->queue[(*tail)++] = index;
+}
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Records an attach position unless one covering the same cells was
+ * found before
+ * @param[in] *gen Search
+ * @param[in] *mask Row masks of the tetromino
+ * @param[in] rot Rotation
+ * @param[in] x Position at X
+ * @param[in] y Position at Y
+ * @param[in] state State the final Down is given in
+ */
+static void movegen_lock(MoveGen_t *gen, const uint8_t *mask, int rot, int x,
+                         int y, int state) {
+  uint64_t cells = 0;
+  int first = -1;
+  for (int j = 0; j < 4; j++) {
+    if (mask[j] == 0) continue;
+    if (first < 0) first = j;
+    cells |= (uint64_t)(mask[j] << (x + BOARD_SHIFT)) << (13 * (j - first));
+  }
+  cells |= (uint64_t)(y + first) << 52;
+  int slot = (cells * 0x9E3779B97F4A7C15ull) >> 56;
+  while (gen->seen[slot] != 0) {
+    if (gen->seen[slot] == cells) return;
+    slot = (slot + 1) % MOVEGEN_HASH;
+  }
+  if (gen->lock_count == MOVEGEN_MAX_LOCKS) return;
+  gen->seen[slot] = cells;
+  MoveLock_t *lock = &gen->locks[gen->lock_count++];
+  lock->rot = rot;
+  lock->x = x;
+  lock->y = y;
+  lock->state = state;
+}
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Finds every position a tetromino can attach in
+ * @param[out] *gen Search
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation of the tetromino
+ * @param[in] x Position of the tetromino at X
+ * @param[in] y Position of the tetromino at Y
+ * @return Returns the number of attach positions
+ */
+int movegen_run(MoveGen_t *gen, const uint16_t *rows, int type, int rot,
+                int x, int y) {
+  memset(gen->visited, 0, sizeof(gen->visited));
+  memset(gen->seen, 0, sizeof(gen->seen));
+  gen->lock_count = 0;
+  movegen_fits(gen, rows, type);
+  int head = 0, tail = 0;
+  movegen_push(gen, &tail, rot, x, y, movegen_index(rot, x, y), 0);
+  while (head < tail) {
+    int state = gen->queue[head++];
+    int sx = state % MOVEGEN_COLS - BOARD_SHIFT;
+    int sy = state / MOVEGEN_COLS % MOVEGEN_ROWS - 1;
+    int sr = state / (MOVEGEN_COLS * MOVEGEN_ROWS);
+    if (movegen_fit(gen, sr, sx - 1, sy - 1))
+      movegen_push(gen, &tail, sr, sx - 1, sy, state, Left);
+    if (movegen_fit(gen, sr, sx + 1, sy - 1))
+      movegen_push(gen, &tail, sr, sx + 1, sy, state, Right);
+    if (type != PIECE_O) {
+      int next = (sr + 1) & 3;
+      const BoardKick_t *kick = board_kicks[type][sr];
+      int k = 0;
+      while (k < BOARD_KICKS &&
+             !movegen_fit(gen, next, sx + kick[k].x, sy - 1 + kick[k].y))
+        k++;
+      int ky = k < BOARD_KICKS ? sy + kick[k].y : -2;
+      if (ky >= -1 && ky <= BOARD_HEIGHT)
+        movegen_push(gen, &tail, next, sx + kick[k].x, ky, state, Action);
+    }
+    if (movegen_fit(gen, sr, sx, sy))
+      movegen_push(gen, &tail, sr, sx, sy + 1, state, Down);
+    else
+      movegen_lock(gen, piece_masks[type][sr], sr, sx, sy, state);
+  }
+  gen->states = tail;
+  return gen->lock_count;
+}
+
+/**
+ * @ingroup movegen_funcs
+ * @brief Shortest signal sequence to an attach position
+ * @param[in] *gen Finished search
+ * @param[in] lock Index of the attach position
+ * @param[out] *path Signals, the last one is the Down that attaches
+ * @param[in] max Room in path
+ * @return Returns the number of signals, -1 if they do not fit
+ */
+int movegen_path(const MoveGen_t *gen, int lock, UserAction_t *path,
+                 int max) {
+  int len = 1;
+  for (int s = gen->locks[lock].state; gen->parent[s] != s; s = gen->parent[s])
+    len++;
+  if (len > max) return -1;
+  path[len - 1] = Down;
+  int i = len - 2;
+  for (int s = gen->locks[lock].state; gen->parent[s] != s; s = gen->parent[s])
+    path[i--] = gen->action[s];
+  return len;
+}
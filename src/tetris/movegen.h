@@ -0,0 +1,79 @@
+/**
+ * @file movegen.h
+ * @brief Breadth-first move generator over tetromino positions
+ *
+ * Explores every (x, y, rotation) a tetromino can reach with Left, Right,
+ * Down and Action from where it is, under the reference engine's collision
+ * rules, and lists every distinct position it can attach in. Slides under
+ * overhangs and rotations into tight slots, kicks included, are found as
+ * well. Thanks to the
+ * breadth-first order, the first path to a position is the shortest one.
+ */
+
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+#include "board.h"
+
+/// Positions at X, from -BOARD_SHIFT to BOARD_WIDTH - 1
+#define MOVEGEN_COLS (BOARD_WIDTH + BOARD_SHIFT)
+/// Positions at Y, from -1, where a kick can lift a tetromino, to
+/// BOARD_HEIGHT
+#define MOVEGEN_ROWS (BOARD_HEIGHT + 2)
+/// Rows above the field the fit table starts at, a kick lifting a
+/// tetromino at position -1 two rows higher
+#define MOVEGEN_ABOVE 4
+/// Number of (x, y, rotation) states
+#define MOVEGEN_STATES (4 * MOVEGEN_ROWS * MOVEGEN_COLS)
+/// Most distinct attach positions kept
+#define MOVEGEN_MAX_LOCKS 128
+/// Slots of the table of attach positions seen
+#define MOVEGEN_HASH 256
+
+/**
+ * @brief Position a tetromino can attach in
+ */
+typedef struct {
+  /// @brief Rotation
+  int8_t rot;
+  /// @brief Position at X
+  int8_t x;
+  /// @brief Position at Y, the tetromino is drawn one row above
+  int8_t y;
+  /// @brief State the final Down is given in
+  uint16_t state;
+} MoveLock_t;
+
+/**
+ * @brief Workspace and result of one search
+ */
+typedef struct {
+  /// @brief Positions at X where a rotation fits with its mask row 0 at
+  /// field row r, bit x + BOARD_SHIFT of [rot][r + MOVEGEN_ABOVE]
+  uint16_t fits[4][MOVEGEN_ROWS + MOVEGEN_ABOVE + 1];
+  /// @brief Visited states, bit x + BOARD_SHIFT of [rot][y + 1]
+  uint16_t visited[4][MOVEGEN_ROWS];
+  /// @brief State every state was first reached from
+  uint16_t parent[MOVEGEN_STATES];
+  /// @brief Signal every state was first reached with
+  uint8_t action[MOVEGEN_STATES];
+  /// @brief States waiting to be expanded
+  uint16_t queue[MOVEGEN_STATES];
+  /// @brief Cells of the attach positions seen, 0 for a free slot
+  uint64_t seen[MOVEGEN_HASH];
+  /// @brief Attach positions in the order they were found
+  MoveLock_t locks[MOVEGEN_MAX_LOCKS];
+  /// @brief Number of attach positions
+  int lock_count;
+  /// @brief Number of states visited
+  int states;
+} MoveGen_t;
+
+/**
+ * @defgroup movegen_funcs Move generator
+ */
+int movegen_run(MoveGen_t *gen, const uint16_t *rows, int type, int rot,
+                int x, int y);
+int movegen_path(const MoveGen_t *gen, int lock, UserAction_t *path,
+                 int max);
+
+#endif /* MOVEGEN_H */
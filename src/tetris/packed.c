@@ -0,0 +1,183 @@
+/**
+ * @file packed.c
+ * @brief Game state packed into one cache line for simulating many games
+ */
+
+#include "packed.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(PackedGame_t) == 64, "PackedGame_t is one cache line");
+
+/// Score for 0, 1, 2, 3 and 4 cleared rows, as in attaching_state()
+static const int packed_row_score[5] = {0, 100, 300, 700, 1500};
+
+/**
+ * @ingroup packed_funcs
+ * @brief Spawns the next tetromino, as spawn_state() does
+ * @param[in] *game Packed game
+ * @return Returns 1 if the tetromino does not fit and the game is over
+ */
+static int packed_spawn(PackedGame_t *game) {
+  int type = game->next;
+  game->type = type;
+  game->next = rand_r(&game->seed) % RAND;
+  game->rot = 0;
+  game->x = 4;
+  game->y = 1;
+  if (board_collides(game->rows, piece_masks[type][0], 4, 1)) {
+    if (type != PIECE_I) return 1;
+    if (!board_collides(game->rows, piece_masks[type][1], 4, 1)) {
+      game->rot = 1;
+      game->x = 3;
+      game->y = 0;
+    }
+  }
+  return board_collides(game->rows, piece_masks[type][game->rot], game->x,
+                        game->y);
+}
+
+/**
+ * @ingroup packed_funcs
+ * @brief Attaches the tetromino, clears rows and scores them, as
+ * attaching_state() does
+ * @param[in] *game Packed game
+ * @return Returns the score gained
+ */
+static int packed_attach(PackedGame_t *game) {
+  board_place(game->rows, piece_masks[game->type][game->rot], game->x,
+              game->y - 1);
+  int cleared = board_clear_rows(game->rows);
+  int reward = packed_row_score[cleared > 4 ? 4 : cleared];
+  game->pieces++;
+  game->score += reward;
+  int level = game->score / 600;
+  game->level = level > 10 ? 10 : level;
+  return reward;
+}
+
+/**
+ * @ingroup packed_funcs
+ * @brief Starts a new game, as stats_init() followed by spawn_state() does
+ * @param[out] *game Packed game
+ * @param[in] seed Seed of the piece sequence, same meaning as in stats_seed()
+ * @return Returns 1 if the first tetromino does not fit
+ */
+int packed_reset(PackedGame_t *game, unsigned int seed) {
+  memset(game, 0, sizeof(PackedGame_t));
+  for (int r = 0; r < BOARD_HEIGHT; r++) game->rows[r] = BOARD_EMPTY_ROW;
+  game->seed = seed;
+  game->next = rand_r(&game->seed) % RAND;
+  int over = packed_spawn(game);
+  game->state = over ? GAME_OVER : MOVING;
+  return over;
+}
+
+/**
+ * @ingroup packed_funcs
+ * @brief Makes one step of a packed game
+ * @param[in] *game Packed game
+ * @param[in] sig Human-readable signal from user
+ * @param[out] *reward Score gained
+ * @return Returns 1 if the game is over, it stays over until packed_reset()
+ */
+int packed_step(PackedGame_t *game, UserAction_t sig, int *reward) {
+  *reward = 0;
+  if (game->state == GAME_OVER) return 1;
+  if (sig == Pause) {
+    game->pause = game->state == MOVING;
+    game->state = game->pause ? PAUSE : MOVING;
+  }
+  if (game->state != MOVING) return 0;
+
+  int type = game->type, rot = game->rot, x = game->x, y = game->y;
+  int locked = 0;
+  if (sig == Left || sig == Right) {
+    int nx = sig == Left ? x - 1 : x + 1;
+    if (!board_collides(game->rows, piece_masks[type][rot], nx, y - 1)) x = nx;
+  } else if (sig == Action && type != PIECE_O) {
+    int kick = board_kick(game->rows, type, rot, x, y - 1);
+    if (kick >= 0) {
+      x += board_kicks[type][rot][kick].x;
+      y += board_kicks[type][rot][kick].y;
+      rot = (rot + 1) & 3;
+    }
+  } else if (sig == Down) {
+    if (board_collides(game->rows, piece_masks[type][rot], x, y))
+      locked = 1;
+    else
+      y++;
+  }
+  if (!locked) {
+    if (board_collides(game->rows, piece_masks[type][rot], x, y))
+      locked = 1;
+    else
+      y++;
+  }
+  game->rot = rot;
+  game->x = x;
+  game->y = y;
+  if (!locked) return 0;
+  *reward = packed_attach(game);
+  if (!packed_spawn(game)) return 0;
+  game->state = GAME_OVER;
+  return 1;
+}
+
+/**
+ * @ingroup packed_funcs
+ * @brief Packs a game of tetris.c
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] state Game state
+ * @param[out] *game Packed game
+ * @return Returns 0 on success, 1 if the tetrominos cannot be packed
+ */
+int packed_from_game(const GameInfo_t *stats, FSM_STATES_g state,
+                     PackedGame_t *game) {
+  int rot = piece_rotation(&stats->current_tetromino);
+  if (rot < 0 || stats->next_tetromino.type < 0 ||
+      stats->next_tetromino.type >= RAND)
+    return 1;
+  memset(game, 0, sizeof(PackedGame_t));
+  board_from_field(stats, game->rows);
+  game->seed = stats->seed;
+  game->score = stats->score;
+  game->pieces = stats->counters.pieces;
+  game->type = stats->current_tetromino.type;
+  game->rot = rot;
+  game->next = stats->next_tetromino.type;
+  game->state = state;
+  game->x = stats->cur_x;
+  game->y = stats->cur_y;
+  game->level = stats->level;
+  game->pause = stats->pause != 0;
+  return 0;
+}
+
+/**
+ * @ingroup packed_funcs
+ * @brief Fills a GameInfo_t with a packed game for the renderer and the
+ * tests
+ *
+ * The speed follows from the level as in attaching_state(). A packed game
+ * has no timers, so the gravity and delay ticks are 0. The high score and
+ * the telemetry counters other than the tetrominos attached are left as
+ * they were.
+ * @param[in] *game Packed game
+ * @param[out] *view Pointer to stats struct
+ */
+void packed_view(const PackedGame_t *game, GameInfo_t *view) {
+  board_to_field(game->rows, view);
+  view->current_tetromino = piece_tetromino(game->type, game->rot);
+  view->next_tetromino = get_tetromino(game->next);
+  view->score = game->score;
+  view->level = game->level;
+  view->speed = 700 - (game->level * (game->level > 5 ? 50 : 60));
+  view->pause = game->pause;
+  view->cur_x = game->x;
+  view->cur_y = game->y;
+  view->gravity_ticks = 0;
+  view->delay_ticks = 0;
+  view->seed = game->seed;
+  view->counters.pieces = game->pieces;
+}
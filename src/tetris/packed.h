@@ -0,0 +1,76 @@
+/**
+ * @file packed.h
+ * @brief Game state packed into one cache line for simulating many games
+ *
+ * GameInfo_t keeps the field as 12x22 ints and both tetrominos as 4x4 int
+ * arrays, over 1.4 KB a game. A PackedGame_t holds the same game in 64
+ * bytes: the field as bitboard rows, the tetrominos as type and rotation,
+ * the position and the small counters as narrow integers. Thousands of
+ * games fit in L2.
+ *
+ * A packed game is stepped as the batch engine steps a lane: one signal,
+ * one row of gravity and, if the tetromino attached, its rows cleared and
+ * the next one spawned. Pause stops the game until the next Pause. Steps
+ * stand for rows of gravity, not for time, so the game keeps no speed and
+ * no timers; packed_view() works the speed out from the level.
+ *
+ * The rules are those of the batch engine, kept on a game rather than a
+ * lane. The batch engine wins when every game is stepped in lockstep, but a
+ * game there is spread over a dozen arrays, so touching one game, to reset
+ * it, to copy it or to look at it, touches a dozen cache lines. A packed
+ * game is one line: a search or a replay buffer can pick games out at
+ * random, copy them a line at a time and reset them without the rest.
+ * difftest.h runs both against tetris.c, so the three cannot drift apart.
+ *
+ * GameInfo_t stays the layout of tetris.c; packed_view() fills one from a
+ * packed game for the renderer and the tests, and packed_from_game() packs
+ * one. The high score and the telemetry counters other than the tetrominos
+ * attached are not packed, a view keeps its own.
+ */
+
+#ifndef PACKED_H
+#define PACKED_H
+#include <stdint.h>
+
+#include "board.h"
+
+/**
+ * @brief Game in one cache line
+ */
+typedef struct __attribute__((aligned(64))) {
+  /// @brief Field rows, as in board.h
+  uint16_t rows[BOARD_HEIGHT];
+  /// @brief State of the piece generator
+  uint32_t seed;
+  /// @brief Score
+  int32_t score;
+  /// @brief Tetrominos attached
+  uint32_t pieces;
+  /// @brief Current tetromino type
+  uint8_t type;
+  /// @brief Current tetromino rotation
+  uint8_t rot;
+  /// @brief Next tetromino type
+  uint8_t next;
+  /// @brief Game state, FSM_STATES_g
+  uint8_t state;
+  /// @brief Position of the current tetromino at X
+  int8_t x;
+  /// @brief Position of the current tetromino at Y
+  int8_t y;
+  /// @brief Level
+  uint8_t level;
+  /// @brief Is the game paused
+  uint8_t pause;
+} PackedGame_t;
+
+/**
+ * @defgroup packed_funcs Packed game state
+ */
+int packed_reset(PackedGame_t *game, unsigned int seed);
+int packed_step(PackedGame_t *game, UserAction_t sig, int *reward);
+int packed_from_game(const GameInfo_t *stats, FSM_STATES_g state,
+                     PackedGame_t *game);
+void packed_view(const PackedGame_t *game, GameInfo_t *view);
+
+#endif /* PACKED_H */
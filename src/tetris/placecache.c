@@ -0,0 +1,183 @@
+/**
+ * @file placecache.c
+ * @brief Cache of the best placements keyed by the surface of the stack
+ */
+
+#include "placecache.h"
+
+#include <string.h>
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Creates an empty cache
+ * @param[in] bits Bits of the set index, the cache has
+ * PLACE_CACHE_WAYS << bits entries, 1 to 30
+ * @return Returns the cache, NULL if out of memory or bits is out of range
+ */
+PlaceCache_t *place_cache_create(int bits) {
+  if (bits < 1 || bits > 30) return NULL;
+  PlaceCache_t *cache = calloc(1, sizeof(PlaceCache_t));
+  if (cache == NULL) return NULL;
+  cache->bits = bits;
+  cache->sets = calloc((size_t)1 << bits, sizeof(PlaceCacheSet_t));
+  if (cache->sets == NULL) {
+    free(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Frees a cache nobody uses any more
+ * @param[in] *cache Cache, may be NULL
+ */
+void place_cache_free(PlaceCache_t *cache) {
+  if (cache == NULL) return;
+  free(cache->sets);
+  free(cache);
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Key of a surface and a tetromino type
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @return Returns the key, never 0
+ */
+uint64_t place_cache_key(const uint16_t *rows, int type) {
+  int heights[BOARD_WIDTH] = {0};
+  const uint16_t field = (uint16_t)~BOARD_EMPTY_ROW;
+  uint16_t seen = 0;
+  for (int r = 0; r < BOARD_HEIGHT && seen != field; r++) {
+    uint16_t filled = rows[r] & field;
+    for (uint16_t top = filled & ~seen; top != 0; top &= top - 1)
+      heights[__builtin_ctz(top) - BOARD_SHIFT] = BOARD_HEIGHT - r;
+    seen |= filled;
+  }
+  uint64_t key = 1ull << 63 | (uint64_t)type << 40;
+  for (int i = 1; i < BOARD_WIDTH; i++) {
+    int d = heights[i] - heights[i - 1];
+    if (d < -PLACE_CACHE_CLIP) d = -PLACE_CACHE_CLIP;
+    if (d > PLACE_CACHE_CLIP) d = PLACE_CACHE_CLIP;
+    key |= (uint64_t)(d + PLACE_CACHE_CLIP) << (4 * i);
+  }
+  return key;
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Locks a set
+ * @param[in] *set Set
+ */
+static void place_cache_lock(PlaceCacheSet_t *set) {
+  while (__atomic_test_and_set(&set->lock, __ATOMIC_ACQUIRE))
+    while (__atomic_load_n(&set->lock, __ATOMIC_RELAXED)) continue;
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Locks the set a key maps to
+ * @param[in] *cache Cache
+ * @param[in] key Key
+ * @return Returns the set, locked
+ */
+static PlaceCacheSet_t *place_cache_set(PlaceCache_t *cache, uint64_t key) {
+  PlaceCacheSet_t *set =
+      &cache->sets[(key * 0x9E3779B97F4A7C15ull) >> (64 - cache->bits)];
+  place_cache_lock(set);
+  return set;
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Unlocks a set
+ * @param[in] *set Set
+ */
+static void place_cache_unlock(PlaceCacheSet_t *set) {
+  __atomic_clear(&set->lock, __ATOMIC_RELEASE);
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Looks a key up and marks its entry as used
+ * @param[in] *cache Cache
+ * @param[in] key Key
+ * @param[out] *out Copy of the entry
+ * @return Returns 0 on a hit, 1 on a miss
+ */
+int place_cache_lookup(PlaceCache_t *cache, uint64_t key,
+                       PlaceCacheEntry_t *out) {
+  PlaceCacheSet_t *set = place_cache_set(cache, key);
+  int miss = 1;
+  for (int w = 0; w < PLACE_CACHE_WAYS && miss; w++) {
+    if (set->ways[w].key != key) continue;
+    set->ways[w].ref = 1;
+    *out = set->ways[w];
+    miss = 0;
+  }
+  if (miss)
+    set->misses++;
+  else
+    set->hits++;
+  place_cache_unlock(set);
+  return miss;
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Stores an entry, replacing the one with the same key
+ *
+ * With no entry for the key and no free one, the CLOCK hand picks the
+ * entry to evict.
+ * @param[in] *cache Cache
+ * @param[in] *entry Entry
+ */
+void place_cache_store(PlaceCache_t *cache, const PlaceCacheEntry_t *entry) {
+  PlaceCacheSet_t *set = place_cache_set(cache, entry->key);
+  int slot = -1;
+  for (int w = 0; w < PLACE_CACHE_WAYS && slot < 0; w++)
+    if (set->ways[w].key == entry->key) slot = w;
+  for (int w = 0; w < PLACE_CACHE_WAYS && slot < 0; w++) {
+    if (set->ways[w].key == 0) {
+      slot = w;
+      set->inserts++;
+    }
+  }
+  while (slot < 0) {
+    PlaceCacheEntry_t *way = &set->ways[set->hand];
+    if (way->ref)
+      way->ref = 0;
+    else
+      slot = set->hand;
+    set->hand = (set->hand + 1) % PLACE_CACHE_WAYS;
+    if (slot >= 0) set->evictions++;
+  }
+  set->ways[slot] = *entry;
+  set->ways[slot].ref = 0;
+  place_cache_unlock(set);
+}
+
+/**
+ * @ingroup place_cache_funcs
+ * @brief Sums the counters of every set
+ * @param[in] *cache Cache
+ * @param[out] *out Counters
+ */
+void place_cache_stats(PlaceCache_t *cache, PlaceCacheStats_t *out) {
+  memset(out, 0, sizeof(PlaceCacheStats_t));
+  long sets = 1L << cache->bits;
+  for (long s = 0; s < sets; s++) {
+    PlaceCacheSet_t *set = &cache->sets[s];
+    place_cache_lock(set);
+    out->hits += set->hits;
+    out->lookups += set->hits + set->misses;
+    out->inserts += set->inserts;
+    out->evictions += set->evictions;
+    for (int w = 0; w < PLACE_CACHE_WAYS; w++)
+      out->used += set->ways[w].key != 0;
+    place_cache_unlock(set);
+  }
+  out->stale = __atomic_load_n(&cache->stale, __ATOMIC_RELAXED);
+  out->capacity = sets * PLACE_CACHE_WAYS;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file placecache.h
+ * @brief Cache of the best placements keyed by the surface of the stack
+ *
+ * The board evaluation mostly depends on the top surface of the stack, so
+ * boards with the same surface mostly share the best placements. The key is
+ * the height differences of the 9 pairs of neighbouring columns, each
+ * clipped to +-PLACE_CACHE_CLIP, together with the tetromino type; how high
+ * the stack stands is not part of it. An entry keeps the PLACE_CACHE_KEEP
+ * best placements found for the key with their values.
+ *
+ * The table is set-associative: a key maps to one set of PLACE_CACHE_WAYS
+ * entries, and each set has its own spin lock, so any number of threads
+ * and games can share one cache. A full set evicts by CLOCK: the hand skips
+ * and clears entries used since it last passed them and evicts the first
+ * one that was not. The statistics are counted per set under its lock.
+ */
+
+#ifndef PLACECACHE_H
+#define PLACECACHE_H
+#include <stdint.h>
+
+#include "board.h"
+
+/// Placements kept for a key
+#define PLACE_CACHE_KEEP 3
+/// Entries of a set
+#define PLACE_CACHE_WAYS 4
+/// Largest height difference of neighbouring columns kept in a key, either
+/// way
+#define PLACE_CACHE_CLIP 3
+
+/**
+ * @brief Best placements for one surface and tetromino type
+ */
+typedef struct {
+  /// @brief Key, 0 for a free entry
+  uint64_t key;
+  /// @brief Board evaluation of every placement, best first
+  float value[PLACE_CACHE_KEEP];
+  /// @brief Rotation of every placement
+  int8_t rot[PLACE_CACHE_KEEP];
+  /// @brief Position at X of every placement
+  int8_t x[PLACE_CACHE_KEEP];
+  /// @brief Number of placements
+  uint8_t count;
+  /// @brief Set when the entry was used since the CLOCK hand passed it
+  uint8_t ref;
+} PlaceCacheEntry_t;
+
+/**
+ * @brief Set of entries a key can be stored in
+ */
+typedef struct {
+  /// @brief Spin lock guarding the set
+  uint8_t lock;
+  /// @brief Entry the CLOCK hand points to
+  uint8_t hand;
+  /// @brief Lookups that found their key
+  uint32_t hits;
+  /// @brief Lookups that did not
+  uint32_t misses;
+  /// @brief Entries stored in a free slot
+  uint32_t inserts;
+  /// @brief Entries stored over another key
+  uint32_t evictions;
+  /// @brief Entries
+  PlaceCacheEntry_t ways[PLACE_CACHE_WAYS];
+} PlaceCacheSet_t;
+
+/**
+ * @brief Cache shared between threads
+ */
+typedef struct {
+  /// @brief Sets, a power of two
+  PlaceCacheSet_t *sets;
+  /// @brief Bits of the set index
+  int bits;
+  /// @brief Hits whose placements could not be reached on the board
+  long stale;
+} PlaceCache_t;
+
+/**
+ * @brief Counters of a cache, summed over the sets
+ */
+typedef struct {
+  /// @brief Lookups
+  long lookups;
+  /// @brief Lookups that found their key
+  long hits;
+  /// @brief Hits whose placements could not be reached on the board
+  long stale;
+  /// @brief Entries stored in a free slot
+  long inserts;
+  /// @brief Entries stored over another key
+  long evictions;
+  /// @brief Entries in use
+  long used;
+  /// @brief Entries in all
+  long capacity;
+} PlaceCacheStats_t;
+
+/**
+ * @defgroup place_cache_funcs Placement cache
+ */
+PlaceCache_t *place_cache_create(int bits);
+void place_cache_free(PlaceCache_t *cache);
+uint64_t place_cache_key(const uint16_t *rows, int type);
+int place_cache_lookup(PlaceCache_t *cache, uint64_t key,
+                       PlaceCacheEntry_t *out);
+void place_cache_store(PlaceCache_t *cache, const PlaceCacheEntry_t *entry);
+void place_cache_stats(PlaceCache_t *cache, PlaceCacheStats_t *out);
+
+#endif /* PLACECACHE_H */
@@ -0,0 +1,131 @@
+/**
+ * @file plugin.c
+ * @brief Bot controllers loaded at runtime through the ABI of bot_plugin.h
+ */
+
+#include "plugin.h"
+
+#include <dlfcn.h>
+
+_Static_assert(sizeof(int) == sizeof(int32_t),
+               "the view points at the int fields of the game");
+_Static_assert(BOT_SIGNAL_LEFT == (int)Left && BOT_SIGNAL_RIGHT == (int)Right &&
+                   BOT_SIGNAL_DOWN == (int)Down &&
+                   BOT_SIGNAL_TURN == (int)Action,
+               "controller signals must keep the values of UserAction_t");
+_Static_assert(BOT_PLUGIN_MAX_SIGNALS <= BOT_MAX_PATH,
+               "every decision must fit a placement path");
+
+/**
+ * @ingroup plugin_funcs
+ * @brief Binds a controller to a game
+ * @param[in] *api Entry points of the controller
+ * @param[in] *stats Game, must outlive the controller
+ * @return Returns the controller, NULL if it was built for another ABI or
+ * its instance could not be made
+ */
+Plugin_t *plugin_attach(const BotPlugin_t *api, const GameInfo_t *stats) {
+  if (api == NULL || api->abi != BOT_PLUGIN_ABI ||
+      api->size < sizeof(BotPlugin_t) || api->decide == NULL)
+    return NULL;
+  Plugin_t *plugin = calloc(1, sizeof(Plugin_t));
+  if (plugin == NULL) return NULL;
+  plugin->api = api;
+  plugin->bot = api->create != NULL ? api->create() : NULL;
+  if (api->create != NULL && plugin->bot == NULL) {
+    free(plugin);
+    return NULL;
+  }
+  plugin->stats = stats;
+  plugin->view = (BotView_t){BOT_PLUGIN_ABI,
+                             sizeof(BotView_t),
+                             BOARD_WIDTH,
+                             BOARD_HEIGHT,
+                             sizeof(stats->field[0]) / sizeof(int),
+                             &stats->field[0][0],
+                             &stats->current_tetromino.tet[0][0],
+                             &stats->current_tetromino.type,
+                             &stats->next_tetromino.type,
+                             &stats->cur_x,
+                             &stats->cur_y,
+                             &stats->score,
+                             &stats->level};
+  return plugin;
+}
+
+/**
+ * @ingroup plugin_funcs
+ * @brief Loads a controller from a shared object and binds it to a game
+ * @param[in] *path Shared object exporting BOT_PLUGIN_SYMBOL
+ * @param[in] *stats Game, must outlive the controller
+ * @return Returns the controller, NULL if the object cannot be loaded, does
+ * not export the entry point or plugin_attach() refuses it
+ */
+Plugin_t *plugin_load(const char *path, const GameInfo_t *stats) {
+  void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) return NULL;
+  BotPluginEntry_t entry = (BotPluginEntry_t)dlsym(handle, BOT_PLUGIN_SYMBOL);
+  Plugin_t *plugin = entry != NULL ? plugin_attach(entry(), stats) : NULL;
+  if (plugin == NULL) {
+    dlclose(handle);
+    return NULL;
+  }
+  plugin->handle = handle;
+  return plugin;
+}
+
+/**
+ * @ingroup plugin_funcs
+ * @brief Frees the instance of a controller and unloads it
+ * @param[in] *plugin Controller, may be NULL
+ */
+void plugin_free(Plugin_t *plugin) {
+  if (plugin == NULL) return;
+  if (plugin->api->destroy != NULL) plugin->api->destroy(plugin->bot);
+  if (plugin->handle != NULL) dlclose(plugin->handle);
+  free(plugin);
+}
+
+/**
+ * @ingroup plugin_funcs
+ * @brief Asks the controller where the falling tetromino goes
+ *
+ * A placement gets the signals leading to it from bot_place(). Signals are
+ * taken as they are, rot and x of the plan are then -1.
+ * @param[in] *plugin Controller
+ * @param[out] *plan Placement with its signals
+ * @return Returns 0 on success, 1 if the controller gave up or answered
+ * with a placement that cannot be reached or a signal it may not give
+ */
+int plugin_plan(Plugin_t *plugin, Placement_t *plan) {
+  const GameInfo_t *stats = plugin->stats;
+  BotDecision_t decision;
+  decision.kind = -1;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int failed = plugin->api->decide(plugin->bot, &plugin->view, &decision);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  plugin->calls++;
+  plugin->call_ns += (end.tv_sec - start.tv_sec) * 1000000000L +
+                     end.tv_nsec - start.tv_nsec;
+  if (failed) return 1;
+  if (decision.kind == BOT_DECIDE_PLACEMENT) {
+    int type = stats->current_tetromino.type;
+    int rot = piece_rotation(&stats->current_tetromino);
+    if (rot < 0) return 1;
+    rot = (rot + (decision.turns & 3)) % piece_rotations(type);
+    return bot_place(stats, rot, decision.x, plan);
+  }
+  if (decision.kind != BOT_DECIDE_SIGNALS || decision.count < 0 ||
+      decision.count > BOT_PLUGIN_MAX_SIGNALS)
+    return 1;
+  for (int i = 0; i < decision.count; i++) {
+    int sig = decision.signals[i];
+    if (sig != Left && sig != Right && sig != Down && sig != Action) return 1;
+    plan->path[i] = sig;
+  }
+  plan->path_len = decision.count;
+  plan->rot = -1;
+  plan->x = -1;
+  return 0;
+}
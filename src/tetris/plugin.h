@@ -0,0 +1,45 @@
+/**
+ * @file plugin.h
+ * @brief Bot controllers loaded at runtime through the ABI of bot_plugin.h
+ *
+ * The view a controller gets is filled once, when it is bound to a game,
+ * with pointers into that game, so a decision costs one indirect call and
+ * nothing is copied. The answer becomes a Placement_t, whose signals the
+ * caller gives to the state machine as bot_execute() does or one at a time
+ * as the game goes on.
+ */
+
+#ifndef PLUGIN_H
+#define PLUGIN_H
+#include "bot.h"
+#include "bot_plugin.h"
+
+/**
+ * @brief Controller bound to a game
+ */
+typedef struct {
+  /// @brief Handle of the shared object, NULL for a controller linked in
+  void *handle;
+  /// @brief Entry points
+  const BotPlugin_t *api;
+  /// @brief Instance made by create()
+  void *bot;
+  /// @brief Game the controller is bound to
+  const GameInfo_t *stats;
+  /// @brief View of the game
+  BotView_t view;
+  /// @brief Calls of decide()
+  long calls;
+  /// @brief Time spent in decide(), ns
+  long call_ns;
+} Plugin_t;
+
+/**
+ * @defgroup plugin_funcs Bot controllers
+ */
+Plugin_t *plugin_load(const char *path, const GameInfo_t *stats);
+Plugin_t *plugin_attach(const BotPlugin_t *api, const GameInfo_t *stats);
+void plugin_free(Plugin_t *plugin);
+int plugin_plan(Plugin_t *plugin, Placement_t *plan);
+
+#endif /* PLUGIN_H */
@@ -0,0 +1,128 @@
+/**
+ * @file rewind.c
+ * @brief History of the last tetrominos attached, for stepping a game back
+ */
+
+#include "rewind.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(RewindEntry_t) == 16,
+               "rewind entries must keep their size");
+
+/// Cell of an entry outside the field, never written
+#define REWIND_NO_CELL 0xFF
+
+/**
+ * @ingroup rewind_funcs
+ * @brief Empties the history
+ * @param[out] *rewind History
+ */
+void rewind_reset(Rewind_t *rewind) { memset(rewind, 0, sizeof(Rewind_t)); }
+
+/**
+ * @ingroup rewind_funcs
+ * @brief Lock hook recording what every tetromino attaching changes
+ *
+ * The rows clean_rows() clears are the ones full once the tetromino is
+ * written, counted the way it counts them.
+ * @param[in] *event Tetromino that attached
+ * @param[in] *arg History
+ */
+void rewind_lock_hook(const LockEvent_t *event, void *arg) {
+  Rewind_t *rewind = arg;
+  RewindEntry_t *entry = &rewind->entries[rewind->head++ % REWIND_DEPTH];
+  if (rewind->count < REWIND_DEPTH) rewind->count++;
+  memset(entry, 0, sizeof(RewindEntry_t));
+  int filled[BOARD_HEIGHT] = {0};
+  int n = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (event->current.tet[i][j] != 1) continue;
+      int x = event->x + i, y = event->y + j - 1;
+      if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) {
+        entry->cells[n++] = REWIND_NO_CELL;
+        continue;
+      }
+      entry->cells[n++] = x + y * BOARD_WIDTH;
+      filled[y]++;
+    }
+  }
+  for (; n < 4; n++) entry->cells[n] = REWIND_NO_CELL;
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    for (int i = 0; i < BOARD_WIDTH; i++) filled[j] += event->field[i][j] == 1;
+    if (filled[j] == BOARD_WIDTH) entry->cleared |= 1u << j;
+  }
+  entry->seed = updateCurrentState()->seed;
+  entry->reward = event->reward;
+  entry->type = event->current.type;
+}
+
+/**
+ * @ingroup rewind_funcs
+ * @brief Takes the changes of one entry back out of the game
+ *
+ * Cleared rows are put back from the bottom one up: the rows above each
+ * are shifted back up, row 0 getting the copy clean_rows() left in row 1.
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] *entry Newest entry of the history
+ */
+static void rewind_undo(GameInfo_t *stats, const RewindEntry_t *entry) {
+  for (int j = BOARD_HEIGHT - 1; j >= 0; j--) {
+    if ((entry->cleared >> j & 1) == 0) continue;
+    for (int k = 1; k <= j; k++) {
+      for (int m = 0; m < BOARD_WIDTH; m++)
+        stats->field[m][k - 1] = stats->field[m][k];
+    }
+    for (int m = 0; m < BOARD_WIDTH; m++) stats->field[m][j] = 1;
+  }
+  for (int n = 0; n < 4; n++) {
+    if (entry->cells[n] == REWIND_NO_CELL) continue;
+    stats->field[entry->cells[n] % BOARD_WIDTH]
+                [entry->cells[n] / BOARD_WIDTH] = 0;
+  }
+  int lines = __builtin_popcount(entry->cleared);
+  if (lines >= 1) stats->counters.clears[(lines < 4 ? lines : 4) - 1]--;
+  stats->counters.pieces--;
+  stats->score -= entry->reward;
+  stats->level = stats->score / 600;
+  if (stats->level > 10) stats->level = 10;
+  stats->speed = 700 - (stats->level * (stats->level > 5 ? 50 : 60));
+}
+
+/**
+ * @ingroup rewind_funcs
+ * @brief Steps the game bound to the calling thread back by a number of
+ * tetrominos
+ *
+ * Works while a tetromino is falling or once the game is over. Every step
+ * undoes one entry; the last tetromino undone then appears again through
+ * spawn_state(), with the next tetromino and the piece generator it had.
+ * Entries left from an earlier game are never undone: a game cannot step
+ * back past its first tetromino.
+ * @param[in] *rewind History of the game
+ * @param[in,out] *state Current game state, MOVING after a step
+ * @param[in] pieces Tetrominos to step back by
+ * @return Returns the number of tetrominos stepped back by
+ */
+int rewind_step(Rewind_t *rewind, FSM_STATES_g *state, int pieces) {
+  if (*state != MOVING && *state != GAME_OVER) return 0;
+  GameInfo_t *stats = updateCurrentState();
+  int next = stats->current_tetromino.type;
+  const RewindEntry_t *entry = NULL;
+  int done = 0;
+  for (; done < pieces && rewind->count > 0 && stats->counters.pieces > 0;
+       done++) {
+    if (entry != NULL) next = entry->type;
+    entry = &rewind->entries[--rewind->head % REWIND_DEPTH];
+    rewind->count--;
+    rewind_undo(stats, entry);
+  }
+  if (entry == NULL) return 0;
+  stats->next_tetromino = get_tetromino(entry->type);
+  spawn_state(state);
+  stats->next_tetromino = get_tetromino(next);
+  stats->seed = entry->seed;
+  stats->delay_ticks = 0;
+  return done;
+}
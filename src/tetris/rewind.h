@@ -0,0 +1,63 @@
+/**
+ * @file rewind.h
+ * @brief History of the last tetrominos attached, for stepping a game back
+ *
+ * Every entry keeps only what the tetromino changed: the four cells it
+ * wrote, the rows it cleared and the score it brought, 16 bytes in all.
+ * Cleared rows were full, and clean_rows() leaves row 0 as it was, so
+ * shifting the rows above back up restores them exactly. Undoing an entry
+ * touches at most the field once and puts the tetromino back where it
+ * appeared, with the next tetromino and the piece generator as they were,
+ * so the game goes on with the same tetrominos.
+ *
+ * The entries fill a ring of REWIND_DEPTH, the oldest ones are overwritten.
+ * Entries are recorded by a lock hook and undone newest first.
+ */
+
+#ifndef REWIND_H
+#define REWIND_H
+#include <stdint.h>
+
+#include "board.h"
+
+/// Tetrominos kept in the history
+#define REWIND_DEPTH 256
+
+/**
+ * @brief What one tetromino changed when it attached
+ */
+typedef struct {
+  /// @brief Rows cleared, bit j is field row j as clean_rows() found it
+  uint32_t cleared;
+  /// @brief State of the piece generator while the tetromino was falling
+  uint32_t seed;
+  /// @brief Score gained
+  int16_t reward;
+  /// @brief Cells written, x + y * BOARD_WIDTH
+  uint8_t cells[4];
+  /// @brief Tetromino type
+  uint8_t type;
+  /// @brief Zero
+  uint8_t reserved;
+} RewindEntry_t;
+
+/**
+ * @brief History of one game
+ */
+typedef struct {
+  /// @brief Ring of entries
+  RewindEntry_t entries[REWIND_DEPTH];
+  /// @brief Entries recorded in all, the next one goes to head % REWIND_DEPTH
+  uint32_t head;
+  /// @brief Entries that can be undone
+  uint32_t count;
+} Rewind_t;
+
+/**
+ * @defgroup rewind_funcs Rewind
+ */
+void rewind_reset(Rewind_t *rewind);
+void rewind_lock_hook(const LockEvent_t *event, void *arg);
+int rewind_step(Rewind_t *rewind, FSM_STATES_g *state, int pieces);
+
+#endif /* REWIND_H */
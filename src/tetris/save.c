@@ -0,0 +1,205 @@
+/**
+ * @file save.c
+ * @brief Suspending a game to a binary file and resuming it
+ */
+
+#include "save.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(SaveFile_t) == 132,
+               "save file layout must not change within a version");
+
+/// CRC-32 of every byte value, filled on first use
+static uint32_t crc_table[256];
+/// Guards the filling of crc_table
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @ingroup save_funcs
+ * @brief Fills the CRC-32 table (reflected polynomial 0xEDB88320)
+ */
+static void crc32_init() {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    crc_table[i] = crc;
+  }
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief CRC-32 of a block of bytes, the one used by zlib and PNG
+ * @param[in] *data Bytes
+ * @param[in] len Number of bytes
+ * @return Returns the checksum
+ */
+uint32_t crc32_compute(const void *data, size_t len) {
+  pthread_once(&crc_once, crc32_init);
+  const uint8_t *bytes = data;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; i++)
+    crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief Checksum of a save file record
+ * @param[in] *save Record
+ * @return Returns the CRC-32 of the bytes after the checksum field
+ */
+static uint32_t save_checksum(const SaveFile_t *save) {
+  size_t from = offsetof(SaveFile_t, checksum) + sizeof(save->checksum);
+  return crc32_compute((const uint8_t *)save + from, sizeof(SaveFile_t) - from);
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief Packs a game into a save file record
+ * @param[in] *stats Pointer to stats struct
+ * @param[out] *save Record
+ * @return Returns 0 on success, 1 if the tetrominos cannot be stored
+ */
+int save_pack(const GameInfo_t *stats, SaveFile_t *save) {
+  memset(save, 0, sizeof(SaveFile_t));
+  int rot = piece_rotation(&stats->current_tetromino);
+  if (rot < 0 || stats->next_tetromino.type < 0 ||
+      stats->next_tetromino.type >= RAND)
+    return 1;
+  save->magic = SAVE_MAGIC;
+  save->version = SAVE_VERSION;
+  save->size = sizeof(SaveFile_t);
+  save->seed = stats->seed;
+  board_from_field(stats, save->rows);
+  save->current = stats->current_tetromino.type;
+  save->rot = rot;
+  save->next = stats->next_tetromino.type;
+  save->x = stats->cur_x;
+  save->y = stats->cur_y;
+  save->gravity_ticks = stats->gravity_ticks;
+  save->delay_ticks = stats->delay_ticks;
+  save->score = stats->score;
+  save->level = stats->level;
+  save->speed = stats->speed;
+  save->pieces = stats->counters.pieces;
+  save->actions = stats->counters.actions;
+  for (int i = 0; i < 4; i++) save->clears[i] = stats->counters.clears[i];
+  for (int i = 0; i <= EXIT_STATE; i++)
+    save->state_ticks[i] = stats->counters.state_ticks[i];
+  save->checksum = save_checksum(save);
+  return 0;
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief Writes the game to a save file
+ *
+ * The record is written to a temporary file that then replaces the save
+ * file, so an interrupted save never leaves half a record behind.
+ * @param[in] *path Save file
+ * @param[in] *stats Pointer to stats struct
+ * @return Returns 0 on success, 1 on an error
+ */
+int save_game(const char *path, const GameInfo_t *stats) {
+  SaveFile_t save;
+  if (save_pack(stats, &save)) return 1;
+
+  char temp[4096];
+  if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp))
+    return 1;
+  int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return 1;
+  int failed = write(fd, &save, sizeof(save)) != sizeof(save);
+  failed |= close(fd) != 0;
+  if (!failed) failed = rename(temp, path) != 0;
+  if (failed) unlink(temp);
+  return failed;
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief Checks that a save file record describes a playable game
+ * @param[in] *save Record
+ * @return Returns 1 if the record can be restored, 0 otherwise
+ */
+static int save_valid(const SaveFile_t *save) {
+  if (save->magic != SAVE_MAGIC || save->version != SAVE_VERSION ||
+      save->size != sizeof(SaveFile_t) || save->checksum != save_checksum(save))
+    return 0;
+  if (save->current >= RAND || save->next >= RAND ||
+      save->rot >= piece_rotations(save->current))
+    return 0;
+  uint16_t empty[BOARD_HEIGHT];
+  for (int j = 0; j < BOARD_HEIGHT; j++) {
+    if ((save->rows[j] & BOARD_EMPTY_ROW) != BOARD_EMPTY_ROW) return 0;
+    empty[j] = BOARD_EMPTY_ROW;
+  }
+  // The tetromino is drawn one row above its position; saves from before
+  // turns were checked in that row may have it overlap the field, so it only
+  // has to stay inside
+  return !board_collides(empty, piece_masks[save->current][save->rot], save->x,
+                         save->y - 1);
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief Restores a game from a save file record
+ * @param[in] *save Record
+ * @param[out] *stats Pointer to stats struct, left as it was if the record
+ * is not valid
+ * @return Returns 0 on success, 1 if the record is damaged
+ */
+int save_unpack(const SaveFile_t *save, GameInfo_t *stats) {
+  if (!save_valid(save)) return 1;
+  stats->seed = save->seed;
+  board_to_field(save->rows, stats);
+  stats->current_tetromino = piece_tetromino(save->current, save->rot);
+  stats->next_tetromino = get_tetromino(save->next);
+  stats->cur_x = save->x;
+  stats->cur_y = save->y;
+  stats->gravity_ticks = save->gravity_ticks;
+  stats->delay_ticks = save->delay_ticks;
+  stats->score = save->score;
+  stats->level = save->level;
+  stats->speed = save->speed;
+  stats->counters.pieces = save->pieces;
+  stats->counters.actions = save->actions;
+  for (int i = 0; i < 4; i++) stats->counters.clears[i] = save->clears[i];
+  for (int i = 0; i <= EXIT_STATE; i++)
+    stats->counters.state_ticks[i] = save->state_ticks[i];
+  return 0;
+}
+
+/**
+ * @ingroup save_funcs
+ * @brief Restores a game from a save file and removes the file
+ *
+ * The file is mapped and checked in place, only a valid record is copied
+ * into the game. A damaged file is removed as well, the game is left as it
+ * was.
+ * @param[in] *path Save file
+ * @param[out] *stats Pointer to stats struct
+ * @return Returns 0 if the game was restored, 1 if there is no save file,
+ * 2 if the file was damaged
+ */
+int load_game(const char *path, GameInfo_t *stats) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 1;
+  struct stat info;
+  const SaveFile_t *save = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size == sizeof(SaveFile_t))
+    save = mmap(NULL, sizeof(SaveFile_t), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  int valid = save != MAP_FAILED && save_unpack(save, stats) == 0;
+  if (save != MAP_FAILED) munmap((void *)save, sizeof(SaveFile_t));
+  unlink(path);
+  return valid ? 0 : 2;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file save.h
+ * @brief Suspending a game to a binary file and resuming it
+ *
+ * The file is one fixed-size record with explicit-width fields and no
+ * pointers, so it can be memory-mapped and checked in place. The field is
+ * stored as bitboard rows and the tetrominos as type and rotation. A CRC-32
+ * over everything after the checksum rejects torn or damaged files.
+ */
+
+#ifndef SAVE_H
+#define SAVE_H
+#include <stdint.h>
+
+#include "board.h"
+
+/// First bytes of a save file, "TSV1" read as little-endian
+#define SAVE_MAGIC 0x31565354u
+/// Version of the save file layout
+#define SAVE_VERSION 1
+
+/**
+ * @brief Suspended game as stored in the file, 132 bytes
+ */
+typedef struct {
+  /// @brief SAVE_MAGIC
+  uint32_t magic;
+  /// @brief SAVE_VERSION
+  uint16_t version;
+  /// @brief sizeof(SaveFile_t)
+  uint16_t size;
+  /// @brief CRC-32 of the bytes following this field
+  uint32_t checksum;
+  /// @brief State of the piece generator
+  uint32_t seed;
+  /// @brief Field rows
+  uint16_t rows[BOARD_HEIGHT];
+  /// @brief Current tetromino type
+  uint8_t current;
+  /// @brief Current tetromino rotation
+  uint8_t rot;
+  /// @brief Next tetromino type
+  uint8_t next;
+  /// @brief Zero
+  uint8_t reserved;
+  /// @brief Position of the current tetromino at X
+  int8_t x;
+  /// @brief Position of the current tetromino at Y
+  int8_t y;
+  /// @brief Ticks accumulated towards the next gravity drop
+  int16_t gravity_ticks;
+  /// @brief Ticks left before the next spawn
+  int16_t delay_ticks;
+  /// @brief Zero
+  int16_t reserved2;
+  /// @brief Score
+  int32_t score;
+  /// @brief Level
+  int32_t level;
+  /// @brief Speed
+  int32_t speed;
+  /// @brief Tetrominos attached
+  uint32_t pieces;
+  /// @brief Signals handled while a tetromino was moving
+  uint32_t actions;
+  /// @brief Clears of 1, 2, 3 and 4 rows at once
+  uint32_t clears[4];
+  /// @brief Ticks spent in every state
+  uint32_t state_ticks[EXIT_STATE + 1];
+} SaveFile_t;
+
+/**
+ * @defgroup save_funcs Suspend and resume
+ */
+uint32_t crc32_compute(const void *data, size_t len);
+int save_pack(const GameInfo_t *stats, SaveFile_t *save);
+int save_unpack(const SaveFile_t *save, GameInfo_t *stats);
+int save_game(const char *path, const GameInfo_t *stats);
+int load_game(const char *path, GameInfo_t *stats);
+
+#endif /* SAVE_H */
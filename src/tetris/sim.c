@@ -0,0 +1,129 @@
+/**
+ * @file sim.c
+ * @brief Compact binary protocol driving the engine from a byte stream
+ */
+
+#include "sim.h"
+
+_Static_assert(sizeof(SimFrame_t) == 52, "sim frames must keep their size");
+
+/**
+ * @ingroup sim_funcs
+ * @brief Starts a new seeded game, the caller has bound it
+ * @param[in] *sim Game
+ * @param[in] seed Piece seed
+ */
+static void sim_start(Sim_t *sim, unsigned int seed) {
+  stats_init(&sim->game);
+  stats_seed(&sim->game, seed);
+  sim->state = SPAWN;
+  userInput(&sim->state, 0);
+}
+
+/**
+ * @ingroup sim_funcs
+ * @brief Makes a game to drive, seeded
+ * @param[out] *sim Game
+ * @param[in] seed Piece seed
+ */
+void sim_init(Sim_t *sim, unsigned int seed) {
+  sim->pending = 0;
+  sim->seed = 0;
+  sim->commands = 0;
+  bind_game_state(&sim->game);
+  sim_start(sim, seed);
+  bind_game_state(NULL);
+}
+
+/**
+ * @ingroup sim_funcs
+ * @brief Rows cleared in a game so far
+ * @param[in] *stats Pointer to stats struct
+ * @return Returns the number of rows
+ */
+static int sim_lines(const GameInfo_t *stats) {
+  const int *clears = stats->counters.clears;
+  return clears[0] + 2 * clears[1] + 3 * clears[2] + 4 * clears[3];
+}
+
+/**
+ * @ingroup sim_funcs
+ * @brief One step: the signal, one row of gravity and, if the tetromino
+ * attached, the next spawn
+ * @param[in,out] *state Current game state
+ * @param[in] sig Signal
+ */
+static void sim_step(FSM_STATES_g *state, UserAction_t sig) {
+  userInput(state, sig);
+  if (*state == MOVING) move_down(state);
+  if (*state == ATTACHING) userInput(state, 0);
+  if (*state == SPAWN) userInput(state, 0);
+}
+
+/**
+ * @ingroup sim_funcs
+ * @brief Writes the frame of a game
+ * @param[in] *sim Game
+ * @param[in] lines Rows cleared by the command
+ * @param[out] *frame Frame
+ */
+static void sim_frame(const Sim_t *sim, int lines, SimFrame_t *frame) {
+  const GameInfo_t *stats = &sim->game;
+  board_from_field(stats, frame->rows);
+  for (int r = 0; r < BOARD_HEIGHT; r++)
+    frame->rows[r] = frame->rows[r] >> BOARD_SHIFT & 0x3FF;
+  int rot = piece_rotation(&stats->current_tetromino);
+  frame->type = stats->current_tetromino.type;
+  frame->rot = rot < 0 ? 0 : rot;
+  frame->next = stats->next_tetromino.type;
+  frame->state = sim->state;
+  frame->x = stats->cur_x;
+  frame->y = stats->cur_y;
+  frame->lines = lines;
+  frame->level = stats->level;
+  frame->score = stats->score;
+}
+
+/**
+ * @ingroup sim_funcs
+ * @brief Processes commands until the input ends or the frames run out
+ *
+ * A command that starts a new game counts its rows from 0, not from those
+ * of the game before.
+ * @param[in,out] *sim Game
+ * @param[in] *in Commands
+ * @param[in] len Bytes in in
+ * @param[out] *out Frames of the commands
+ * @param[in] max Room in out
+ * @param[out] *used Bytes of in processed
+ * @return Returns the number of frames written
+ */
+size_t sim_feed(Sim_t *sim, const uint8_t *in, size_t len, SimFrame_t *out,
+                size_t max, size_t *used) {
+  size_t pos = 0, frames = 0;
+  bind_game_state(&sim->game);
+  for (; pos < len && frames < max; pos++) {
+    uint8_t cmd = in[pos];
+    int lines = sim_lines(&sim->game);
+    if (sim->pending > 0) {
+      sim->seed |= (uint32_t)cmd << 8 * (4 - sim->pending);
+      if (--sim->pending > 0) continue;
+      sim_start(sim, sim->seed);
+      lines = 0;
+    } else if (cmd == SIM_NEW_GAME) {
+      sim->pending = 4;
+      sim->seed = 0;
+      continue;
+    } else if (cmd <= Action) {
+      if (sim->state == GAME_OVER && cmd == Start) lines = 0;
+      sim_step(&sim->state, cmd);
+    } else {
+      continue;
+    }
+    sim->commands++;
+    sim_frame(sim, sim_lines(&sim->game) - lines, &out[frames++]);
+  }
+  bind_game_state(NULL);
+  *used = pos;
+  return frames;
+}
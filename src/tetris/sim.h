@@ -0,0 +1,80 @@
+/**
+ * @file sim.h
+ * @brief Compact binary protocol driving the engine from a byte stream
+ *
+ * Every input byte is one command:
+ * - 0 to Action: one step with that signal, 0 being no signal. A step
+ *   is the signal, one row of gravity and, if the tetromino attached, its
+ *   rows cleared and the next one spawned, as in the batch engine.
+ * - SIM_NEW_GAME followed by 4 bytes of seed, little-endian: a new game
+ *   with that piece seed.
+ *
+ * Other bytes are skipped. Every command answers with one SimFrame_t of
+ * the game after it, written as it lies in memory: little-endian, 52 bytes,
+ * no padding.
+ *
+ * The game is bound to the calling thread only while a chunk of input is
+ * processed, so a stream can be fed in pieces of any size, a seed split
+ * between two of them included.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+/// Command starting a new seeded game
+#define SIM_NEW_GAME 0x80
+
+/**
+ * @brief State of the game after a command
+ */
+typedef struct {
+  /// @brief Field rows, top first, bit x set if column x is filled
+  uint16_t rows[BOARD_HEIGHT];
+  /// @brief Current tetromino type
+  uint8_t type;
+  /// @brief Current tetromino rotation
+  uint8_t rot;
+  /// @brief Next tetromino type
+  uint8_t next;
+  /// @brief Game state, FSM_STATES_g
+  uint8_t state;
+  /// @brief Position of the current tetromino at X
+  int8_t x;
+  /// @brief Position of the current tetromino at Y
+  int8_t y;
+  /// @brief Rows cleared by the command
+  uint8_t lines;
+  /// @brief Level
+  uint8_t level;
+  /// @brief Score
+  int32_t score;
+} SimFrame_t;
+
+/**
+ * @brief Game driven by a command stream
+ */
+typedef struct {
+  /// @brief Game
+  GameInfo_t game;
+  /// @brief Game state
+  FSM_STATES_g state;
+  /// @brief Seed bytes still to come for SIM_NEW_GAME, 0 between commands
+  int pending;
+  /// @brief Seed read so far
+  uint32_t seed;
+  /// @brief Commands processed
+  long commands;
+} Sim_t;
+
+/**
+ * @defgroup sim_funcs Binary protocol
+ */
+void sim_init(Sim_t *sim, unsigned int seed);
+size_t sim_feed(Sim_t *sim, const uint8_t *in, size_t len, SimFrame_t *out,
+                size_t max, size_t *used);
+
+#endif /* SIM_H */
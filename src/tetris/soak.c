@@ -0,0 +1,127 @@
+/**
+ * @file soak.c
+ * @brief Samples of a long-running process and detection of their drift
+ */
+
+#include "soak.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+/**
+ * @ingroup soak_funcs
+ * @brief Resident memory of the process
+ * @return Returns the resident memory, KiB, -1 if /proc cannot be read
+ */
+long soak_rss_kb(void) {
+  FILE *fp = fopen("/proc/self/statm", "r");
+  if (fp == NULL) return -1;
+  long size, resident;
+  int read = fscanf(fp, "%ld %ld", &size, &resident);
+  fclose(fp);
+  if (read != 2) return -1;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @ingroup soak_funcs
+ * @brief Open file descriptors of the process
+ * @return Returns the number of descriptors, not counting the one used to
+ * count them, -1 if /proc cannot be read
+ */
+int soak_fd_count(void) {
+  DIR *dir = opendir("/proc/self/fd");
+  if (dir == NULL) return -1;
+  int count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) count += entry->d_name[0] != '.';
+  closedir(dir);
+  return count - 1;
+}
+
+/**
+ * @ingroup soak_funcs
+ * @brief Median of the p99 latencies of a window of samples
+ * @param[in] *samples First sample of the window
+ * @return Returns the median
+ */
+static double soak_median_p99(const SoakSample_t *samples) {
+  double v[SOAK_WINDOW];
+  for (int i = 0; i < SOAK_WINDOW; i++) {
+    int j = i;
+    for (; j > 0 && v[j - 1] > samples[i].p99_us; j--) v[j] = v[j - 1];
+    v[j] = samples[i].p99_us;
+  }
+  return v[SOAK_WINDOW / 2];
+}
+
+/**
+ * @ingroup soak_funcs
+ * @brief Checks whether a run drifted from its baseline
+ *
+ * The baseline is the first SOAK_WINDOW samples, the caller leaves warm-up
+ * out. Latency is checked once there are two full windows. A value of -1,
+ * unknown, is never taken for drift.
+ * @param[in] *samples Samples, oldest first
+ * @param[in] count Number of samples
+ * @param[in] *limits Largest changes allowed
+ * @param[out] *why What drifted, may be NULL
+ * @param[in] size Room in why
+ * @return Returns 1 if the run drifted, 0 if not or if there are fewer
+ * samples than a baseline
+ */
+int soak_drift(const SoakSample_t *samples, int count,
+               const SoakLimits_t *limits, char *why, size_t size) {
+  if (count < SOAK_WINDOW) return 0;
+  long rss = -1;
+  int fds = -1;
+  for (int i = 0; i < SOAK_WINDOW; i++) {
+    if (samples[i].rss_kb > rss) rss = samples[i].rss_kb;
+    if (samples[i].fds > fds) fds = samples[i].fds;
+  }
+  const SoakSample_t *last = &samples[count - 1];
+  char none[1];
+  if (why == NULL) why = none, size = sizeof(none);
+  if (rss >= 0 && last->rss_kb > rss + limits->rss_kb) {
+    snprintf(why, size, "resident memory grew from %ld to %ld KiB", rss,
+             last->rss_kb);
+    return 1;
+  }
+  if (fds >= 0 && last->fds > fds + limits->fds) {
+    snprintf(why, size, "open descriptors grew from %d to %d", fds,
+             last->fds);
+    return 1;
+  }
+  if (count < 2 * SOAK_WINDOW) return 0;
+  double base = soak_median_p99(samples);
+  double now = soak_median_p99(samples + count - SOAK_WINDOW);
+  if (now > base * limits->latency) {
+    snprintf(why, size, "p99 step latency rose from %.2f to %.2f us", base,
+             now);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @ingroup soak_funcs
+ * @brief Prints the header line of a sample series
+ * @param[in] *out Stream
+ */
+void soak_print_header(FILE *out) {
+  fprintf(out,
+          "time_ms,pieces,games,records,rss_kb,fds,p50_us,p99_us,max_us\n");
+}
+
+/**
+ * @ingroup soak_funcs
+ * @brief Prints a sample as one line of comma-separated values
+ * @param[in] *sample Sample
+ * @param[in] *out Stream
+ */
+void soak_print(const SoakSample_t *sample, FILE *out) {
+  fprintf(out, "%ld,%ld,%ld,%ld,%ld,%d,%.2f,%.2f,%.2f\n", sample->time_ms,
+          sample->pieces, sample->games, sample->records, sample->rss_kb,
+          sample->fds, sample->p50_us, sample->p99_us, sample->max_us);
+  fflush(out);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file soak.h
+ * @brief Samples of a long-running process and detection of their drift
+ *
+ * A soak run samples the resident memory, the open file descriptors and the
+ * step latency percentiles of the process at intervals. The first samples
+ * after warm-up make the baseline; the run drifts if the resident memory
+ * grows or descriptors are left open beyond the limits, or if the median
+ * p99 latency of the newest SOAK_WINDOW samples rises past a factor of the
+ * baseline one. Memory and descriptors are compared with the largest
+ * baseline value, latency with the median, so one slow sample is not taken
+ * for drift.
+ */
+
+#ifndef SOAK_H
+#define SOAK_H
+#include <stddef.h>
+#include <stdio.h>
+
+/// Samples of the baseline and of the newest window
+#define SOAK_WINDOW 3
+
+/**
+ * @brief State of the process at one moment
+ */
+typedef struct {
+  /// @brief Time since the start of the run, ms
+  long time_ms;
+  /// @brief Tetrominos attached since the start
+  long pieces;
+  /// @brief Games played since the start
+  long games;
+  /// @brief High scores saved and read back since the start
+  long records;
+  /// @brief Resident memory, KiB, -1 if unknown
+  long rss_kb;
+  /// @brief Open file descriptors, -1 if unknown
+  int fds;
+  /// @brief Median step latency over the interval, us
+  double p50_us;
+  /// @brief 99th percentile step latency over the interval, us
+  double p99_us;
+  /// @brief Slowest step of the interval, us
+  double max_us;
+} SoakSample_t;
+
+/**
+ * @brief Largest changes from the baseline a run may show
+ */
+typedef struct {
+  /// @brief Resident memory growth, KiB
+  long rss_kb;
+  /// @brief Descriptors left open
+  int fds;
+  /// @brief Factor the p99 latency may rise by
+  double latency;
+} SoakLimits_t;
+
+/**
+ * @defgroup soak_funcs Soak runs
+ */
+long soak_rss_kb(void);
+int soak_fd_count(void);
+int soak_drift(const SoakSample_t *samples, int count,
+               const SoakLimits_t *limits, char *why, size_t size);
+void soak_print_header(FILE *out);
+void soak_print(const SoakSample_t *sample, FILE *out);
+
+#endif /* SOAK_H */
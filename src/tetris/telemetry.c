@@ -0,0 +1,160 @@
+/**
+ * @file telemetry.c
+ * @brief Per-game telemetry records and histograms
+ */
+
+#include "telemetry.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(TelemetryRecord_t) == 96,
+               "telemetry record layout must not change within a version");
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Builds the record of a game from its counters
+ * @param[in] *stats Pointer to stats struct
+ * @param[out] *record Record
+ */
+void telemetry_record(const GameInfo_t *stats, TelemetryRecord_t *record) {
+  *record = (TelemetryRecord_t){0};
+  record->magic = TELEMETRY_MAGIC;
+  record->version = TELEMETRY_VERSION;
+  record->size = sizeof(TelemetryRecord_t);
+  record->finished = time(NULL);
+  record->score = stats->score;
+  record->level = stats->level;
+  record->pieces = stats->counters.pieces;
+  record->actions = stats->counters.actions;
+  for (int i = 0; i < 4; i++) record->clears[i] = stats->counters.clears[i];
+  for (int i = 0; i <= EXIT_STATE; i++)
+    record->state_ms[i] = stats->counters.state_ticks[i] * TICK_MS;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Appends a record to a stream file, creating it if needed
+ *
+ * The record goes out in one write() to a file opened for appending, so
+ * records of concurrent writers never interleave.
+ * @param[in] *path Stream file
+ * @param[in] *record Record
+ * @return Returns 0 on success, 1 on an error
+ */
+int telemetry_append(const char *path, const TelemetryRecord_t *record) {
+  int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0) return 1;
+  ssize_t n = write(fd, record, sizeof(TelemetryRecord_t));
+  close(fd);
+  return n == sizeof(TelemetryRecord_t) ? 0 : 1;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Checks that a record read from a stream has the known layout
+ * @param[in] *record Record
+ * @return Returns 1 if the record can be used, 0 otherwise
+ */
+int telemetry_valid(const TelemetryRecord_t *record) {
+  return record->magic == TELEMETRY_MAGIC &&
+         record->version == TELEMETRY_VERSION &&
+         record->size == sizeof(TelemetryRecord_t);
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Time a game was actually played, without the menus and pauses
+ * @param[in] *record Record
+ * @return Time spent spawning, moving and attaching tetrominos, ms
+ */
+long telemetry_active_ms(const TelemetryRecord_t *record) {
+  return (long)record->state_ms[SPAWN] + record->state_ms[MOVING] +
+         record->state_ms[ATTACHING];
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Pieces per second of play
+ * @param[in] *record Record
+ * @return Pieces per second, 0 for a game that was not played
+ */
+double telemetry_pps(const TelemetryRecord_t *record) {
+  long ms = telemetry_active_ms(record);
+  return ms > 0 ? record->pieces * 1000.0 / ms : 0;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Actions per minute of play
+ * @param[in] *record Record
+ * @return Actions per minute, 0 for a game that was not played
+ */
+double telemetry_apm(const TelemetryRecord_t *record) {
+  long ms = telemetry_active_ms(record);
+  return ms > 0 ? record->actions * 60000.0 / ms : 0;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Empty histogram initialization
+ * @param[in] *hist Histogram
+ * @param[in] min Lower bound of the first bin
+ * @param[in] width Width of a bin
+ */
+void histogram_init(Histogram_t *hist, double min, double width) {
+  *hist = (Histogram_t){0};
+  hist->min = min;
+  hist->width = width;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Adds a value to a histogram
+ * @param[in] *hist Histogram
+ * @param[in] value Value
+ */
+void histogram_add(Histogram_t *hist, double value) {
+  double bin = (value - hist->min) / hist->width;
+  if (bin < 0)
+    hist->under++;
+  else if (bin >= HISTOGRAM_BINS)
+    hist->over++;
+  else
+    hist->bins[(int)bin]++;
+  hist->count++;
+  hist->sum += value;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Adds the values of one histogram to another with the same bins
+ * @param[in] *into Histogram receiving the values
+ * @param[in] *from Histogram to add
+ */
+void histogram_merge(Histogram_t *into, const Histogram_t *from) {
+  for (int i = 0; i < HISTOGRAM_BINS; i++) into->bins[i] += from->bins[i];
+  into->under += from->under;
+  into->over += from->over;
+  into->count += from->count;
+  into->sum += from->sum;
+}
+
+/**
+ * @ingroup telemetry_funcs
+ * @brief Percentile of the values of a histogram
+ * @param[in] *hist Histogram
+ * @param[in] p Percentile, 0 to 100
+ * @return Middle of the bin holding the percentile, the bounds of the range
+ * for values outside it
+ */
+double histogram_percentile(const Histogram_t *hist, double p) {
+  double rank = hist->count * p / 100;
+  double seen = hist->under;
+  if (hist->count == 0 || seen >= rank) return hist->min;
+  for (int i = 0; i < HISTOGRAM_BINS; i++) {
+    seen += hist->bins[i];
+    if (seen >= rank) return hist->min + (i + 0.5) * hist->width;
+  }
+  return hist->min + HISTOGRAM_BINS * hist->width;
+}
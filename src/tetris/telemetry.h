@@ -0,0 +1,86 @@
+/**
+ * @file telemetry.h
+ * @brief Per-game telemetry records and histograms
+ *
+ * When a game ends its counters become one fixed-size binary record that is
+ * appended to a stream file with a single write(), so several games and
+ * processes can share one stream. Records carry raw counts only, rates like
+ * pieces per second are worked out when the stream is read.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <stdint.h>
+
+#include "tetris.h"
+
+/// First bytes of every record, "TLM1" read as little-endian
+#define TELEMETRY_MAGIC 0x314D4C54u
+/// Version of the record layout
+#define TELEMETRY_VERSION 1
+/// Number of bins of a histogram
+#define HISTOGRAM_BINS 64
+
+/**
+ * @brief Summary of one game as stored in the stream, 96 bytes
+ */
+typedef struct {
+  /// @brief TELEMETRY_MAGIC
+  uint32_t magic;
+  /// @brief TELEMETRY_VERSION
+  uint16_t version;
+  /// @brief sizeof(TelemetryRecord_t)
+  uint16_t size;
+  /// @brief Time the game ended, seconds since the epoch
+  int64_t finished;
+  /// @brief Final score
+  int32_t score;
+  /// @brief Final level
+  int32_t level;
+  /// @brief Tetrominos attached
+  uint32_t pieces;
+  /// @brief Signals handled while a tetromino was moving
+  uint32_t actions;
+  /// @brief Clears of 1, 2, 3 and 4 rows at once
+  uint32_t clears[4];
+  /// @brief Time spent in every state, ms
+  uint32_t state_ms[EXIT_STATE + 1];
+  /// @brief Zero, keeps the size a multiple of 8
+  uint32_t reserved[5];
+} TelemetryRecord_t;
+
+/**
+ * @brief Histogram with equal bins and counters for values out of range
+ */
+typedef struct {
+  /// @brief Lower bound of the first bin
+  double min;
+  /// @brief Width of a bin
+  double width;
+  /// @brief Number of values in every bin
+  long bins[HISTOGRAM_BINS];
+  /// @brief Number of values below min
+  long under;
+  /// @brief Number of values above the last bin
+  long over;
+  /// @brief Number of values
+  long count;
+  /// @brief Sum of the values
+  double sum;
+} Histogram_t;
+
+/**
+ * @defgroup telemetry_funcs Telemetry
+ */
+void telemetry_record(const GameInfo_t *stats, TelemetryRecord_t *record);
+int telemetry_append(const char *path, const TelemetryRecord_t *record);
+int telemetry_valid(const TelemetryRecord_t *record);
+long telemetry_active_ms(const TelemetryRecord_t *record);
+double telemetry_pps(const TelemetryRecord_t *record);
+double telemetry_apm(const TelemetryRecord_t *record);
+void histogram_init(Histogram_t *hist, double min, double width);
+void histogram_add(Histogram_t *hist, double value);
+void histogram_merge(Histogram_t *into, const Histogram_t *from);
+double histogram_percentile(const Histogram_t *hist, double p);
+
+#endif /* TELEMETRY_H */
@@ -6,6 +6,10 @@
 
 #include "tetris.h"
 
+#include <string.h>
+
+#include "board.h"
+
 /**
  * @brief Фигуры тетриса
  * @param[in] num Индекс фигуры
@@ -84,41 +88,247 @@ UserAction_t get_signal(int user_input) {
     rc = Start;
   else if (user_input == ' ')
     rc = Action;
+  else if (user_input == 'r' || user_input == 'R')
+    rc = Rewind;
 
   return rc;
 }
 
+/// Counters of the state machine of the calling thread
+static __thread FsmStats_t fsm_counters;
+/// Whether the calling thread times its states
+static __thread int fsm_timed = 0;
+/// Time of the last transition of the calling thread, ns
+static __thread long fsm_since = 0;
+
+/**
+ * @ingroup state_funcs
+ * @brief Monotonic clock in nanoseconds
+ * @return Returns the current time, ns
+ */
+static long fsm_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Counts a change of state, and the time spent in the one left if
+ * the thread times its states
+ * @param[in] from State before
+ * @param[in] to State after
+ */
+static void fsm_transition(FSM_STATES_g from, FSM_STATES_g to) {
+  if (from == to) return;
+  fsm_counters.entries[to]++;
+  if (fsm_timed) {
+    long now = fsm_now_ns();
+    fsm_counters.time_ns[from] += now - fsm_since;
+    fsm_since = now;
+  }
+  TRACE_TRANSITION(from, to);
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Leaves the game
+ * @param[in] *state Current game state
+ * @param[in] sig Unused
+ */
+static void fsm_exit(FSM_STATES_g *state, UserAction_t sig) {
+  (void)sig;
+  *state = EXIT_STATE;
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Starts the first game
+ * @param[in] *state Current game state
+ * @param[in] sig Unused
+ */
+static void fsm_start(FSM_STATES_g *state, UserAction_t sig) {
+  (void)sig;
+  *state = SPAWN;
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Spawns the next tetromino, whatever the signal
+ * @param[in] *state Current game state
+ * @param[in] sig Unused
+ */
+static void fsm_spawn(FSM_STATES_g *state, UserAction_t sig) {
+  (void)sig;
+  spawn_state(state);
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Attaches the tetromino, whatever the signal
+ * @param[in] *state Current game state
+ * @param[in] sig Unused
+ */
+static void fsm_attach(FSM_STATES_g *state, UserAction_t sig) {
+  (void)sig;
+  attaching_state();
+  *state = SPAWN;
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Moves or rotates the falling tetromino
+ * @param[in] *state Current game state
+ * @param[in] sig Action, Left, Right or Down
+ */
+static void fsm_move(FSM_STATES_g *state, UserAction_t sig) {
+  updateCurrentState()->counters.actions++;
+  if (sig == Action)
+    rotate();
+  else if (sig == Left)
+    move_left();
+  else if (sig == Right)
+    move_right();
+  else
+    move_down(state);
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Counts a signal given during a pause, Pause resuming the game
+ * @param[in] *state Current game state
+ * @param[in] sig Signal
+ */
+static void fsm_paused(FSM_STATES_g *state, UserAction_t sig) {
+  GameInfo_t *stats = updateCurrentState();
+  stats->pause += 1;
+  if (sig == Pause && stats->pause > 1) {
+    *state = MOVING;
+    stats->pause = 0;
+  }
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Pauses the game
+ * @param[in] *state Current game state
+ * @param[in] sig Pause
+ */
+static void fsm_pause(FSM_STATES_g *state, UserAction_t sig) {
+  *state = PAUSE;
+  fsm_paused(state, sig);
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Starts a new game once the last one is over
+ * @param[in] *state Current game state
+ * @param[in] sig Unused
+ */
+static void fsm_restart(FSM_STATES_g *state, UserAction_t sig) {
+  (void)sig;
+  stats_init(updateCurrentState());
+  *state = SPAWN;
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Leaves the game once it is over, saving the score
+ * @param[in] *state Current game state
+ * @param[in] sig Unused
+ */
+static void fsm_quit(FSM_STATES_g *state, UserAction_t sig) {
+  (void)sig;
+  *state = EXIT_STATE;
+  save_score();
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Saves the score of a game that is over
+ * @param[in] *state Unused
+ * @param[in] sig Unused
+ */
+static void fsm_over(FSM_STATES_g *state, UserAction_t sig) {
+  (void)state;
+  (void)sig;
+  save_score();
+}
+
+/// Handler of every signal in every state, NULL where a state does not
+/// expect the signal
+static const FsmHandler_t fsm_table[EXIT_STATE + 1][Rewind + 1] = {
+    [START] = {[Start] = fsm_start, [Terminate] = fsm_exit},
+    [SPAWN] = {[0 ... Rewind] = fsm_spawn},
+    [MOVING] = {[Left] = fsm_move,
+                [Right] = fsm_move,
+                [Down] = fsm_move,
+                [Action] = fsm_move,
+                [Pause] = fsm_pause,
+                [Terminate] = fsm_exit},
+    [PAUSE] = {[0 ... Pause] = fsm_paused,
+               [Terminate] = fsm_exit,
+               [Left ... Rewind] = fsm_paused},
+    [ATTACHING] = {[0 ... Rewind] = fsm_attach},
+    [GAME_OVER] = {[0] = fsm_over,
+                   [Start] = fsm_restart,
+                   [Pause] = fsm_over,
+                   [Terminate] = fsm_quit,
+                   [Left ... Rewind] = fsm_over},
+};
+
+/**
+ * @ingroup state_funcs
+ * @brief Handles a signal as a given state does
+ *
+ * A signal the state does not expect changes nothing and is counted, no
+ * signal at all never is.
+ * @param[in] row State whose handler runs
+ * @param[in] *state Current game state
+ * @param[in] sig Human-readable signal from user
+ */
+static void fsm_handle(FSM_STATES_g row, FSM_STATES_g *state,
+                       UserAction_t sig) {
+  FsmHandler_t handler = (unsigned)sig <= Rewind ? fsm_table[row][sig] : NULL;
+  fsm_counters.dispatches++;
+  if (handler != NULL)
+    handler(state, sig);
+  else if (sig != 0)
+    fsm_counters.unexpected[row]++;
+}
+
 /**
  * @ingroup state_funcs
- * @brief Selection of the next function based on the game state
+ * @brief Runs the handler the transition table has for the state and the
+ * signal
  * @param[in] *state Current game state
  * @param[in] action Human-readable signal from user
  */
 void userInput(FSM_STATES_g *state, UserAction_t action) {
-  switch (*state) {
-    case START:
-      start_state(state, action);
-      break;
-    case SPAWN:
-      spawn_state(state);
-      break;
-    case MOVING:
-      moving_state(state, action);
-      break;
-    case ATTACHING:
-      attaching_state();
-      *state = SPAWN;
-      break;
-    case GAME_OVER:
-      *state = GAME_OVER;
-      game_over(state, action);
-      break;
-    case PAUSE:
-      pause_game(state, action);
-      break;
-    case EXIT_STATE:
-      break;
-  }
+  FSM_STATES_g from = *state;
+  fsm_handle(from, state, action);
+  fsm_transition(from, *state);
+}
+
+/**
+ * @ingroup state_funcs
+ * @brief Counters of the state machine of the calling thread
+ *
+ * The time spent in the current state is not counted until it is left.
+ * @param[out] *stats Counters
+ */
+void fsm_stats(FsmStats_t *stats) { *stats = fsm_counters; }
+
+/**
+ * @ingroup state_funcs
+ * @brief Clears the counters of the state machine of the calling thread
+ * @param[in] timed Whether to time the states from now on, which costs two
+ * clock reads a transition
+ */
+void fsm_stats_reset(int timed) {
+  fsm_counters = (FsmStats_t){0};
+  fsm_timed = timed;
+  fsm_since = timed ? fsm_now_ns() : 0;
 }
 
 /**
@@ -128,15 +338,7 @@ void userInput(FSM_STATES_g *state, UserAction_t action) {
  * @param[in] sig Human-readable signal from user
  */
 void game_over(FSM_STATES_g *state, UserAction_t sig) {
-  if (sig == Start) {
-    GameInfo_t *stats = updateCurrentState();
-    stats_init(stats);
-    clear();
-    *state = SPAWN;
-  } else if (sig == Terminate) {
-    *state = EXIT_STATE;
-  }
-  save_score();
+  fsm_handle(GAME_OVER, state, sig);
 }
 
 /**
@@ -146,10 +348,7 @@ void game_over(FSM_STATES_g *state, UserAction_t sig) {
  * @param[in] sig Human-readable signal from user
  */
 void start_state(FSM_STATES_g *state, UserAction_t sig) {
-  if (sig == Start)
-    *state = SPAWN;
-  else if (sig == Terminate)
-    *state = EXIT_STATE;
+  fsm_handle(START, state, sig);
 }
 
 /**
@@ -158,6 +357,7 @@ void start_state(FSM_STATES_g *state, UserAction_t sig) {
  * @param[in] *state Current game state
  */
 void spawn_state(FSM_STATES_g *state) {
+  TRACE_SCOPE("spawn_state");
   GameInfo_t *stats = updateCurrentState();
   for (int i = 0; i < 4; i++) {
     for (int j = 0; j < 4; j++) {
@@ -165,18 +365,18 @@ void spawn_state(FSM_STATES_g *state) {
     }
   }
   stats->current_tetromino.type = stats->next_tetromino.type;
-  stats->next_tetromino = get_tetromino(rand() % RAND);
+  stats->next_tetromino = get_tetromino(rand_r(&stats->seed) % RAND);
   stats->cur_x = 4;
   stats->cur_y = 1;
+  stats->gravity_ticks = 0;
   if (check_field(Down) != 0 && stats->current_tetromino.type != 0) {
     *state = GAME_OVER;
   } else if (stats->current_tetromino.type == 0) {
-    if (check_field(Down) != 0) {
-      rotate();
-      if (stats->current_tetromino.tet[3][1] == 1) {
-        stats->cur_y = 0;
-        stats->cur_x = 3;
-      }
+    tetromino lying = piece_tetromino(PIECE_I, 1);
+    if (check_field(Down) != 0 && check_field_rotate(lying.tet) == 0) {
+      stats->current_tetromino = lying;
+      stats->cur_y = 0;
+      stats->cur_x = 3;
     }
     if (check_field(Down) != 0)
       *state = GAME_OVER;
@@ -194,37 +394,80 @@ void spawn_state(FSM_STATES_g *state) {
  * @param[in] sig Human-readable signal from user
  */
 void moving_state(FSM_STATES_g *state, UserAction_t sig) {
-  switch (sig) {
-    case Action:
-      rotate();
-      break;
-    case Left:
-      move_left();
-      break;
-    case Right:
-      move_right();
+  fsm_handle(MOVING, state, sig);
+}
+
+/**
+ * @ingroup fsm_funcs
+ * @brief Advances the game clock by a number of logical ticks
+ *
+ * Runs the states that do not wait for the user: attaching, the entry delay
+ * before the next spawn and gravity. The result depends only on the game
+ * state and the tick count, never on wall-clock time, so headless runs can
+ * step as fast as they like. Every tick is also counted against the state
+ * it was spent in.
+ * @param[in] *state Current game state
+ * @param[in] ticks Number of ticks, TICK_MS each
+ */
+void step_ticks(FSM_STATES_g *state, long ticks) {
+  GameInfo_t *stats = updateCurrentState();
+  for (long t = 0; t < ticks; t++) {
+    stats->counters.state_ticks[*state]++;
+    if (*state == ATTACHING) userInput(state, 0);
+    if (*state == SPAWN) {
+      if (stats->delay_ticks > 0) {
+        stats->delay_ticks--;
+      } else {
+        userInput(state, 0);
+      }
+      continue;
+    }
+    if (*state != MOVING) {
+      stats->counters.state_ticks[*state] += ticks - t - 1;
       break;
-    case Down:
+    }
+    stats->gravity_ticks++;
+    if (stats->gravity_ticks * TICK_MS >= stats->speed) {
+      stats->gravity_ticks = 0;
       move_down(state);
-      break;
-    case Terminate:
-      *state = EXIT_STATE;
-      break;
-    case Pause:
-      *state = PAUSE;
-      pause_game(state, sig);
-      break;
-    default:
-      break;
+      fsm_transition(MOVING, *state);
+    }
   }
 }
 
+/// Function every attaching tetromino of this thread is reported to
+static __thread LockHook_t lock_hook = NULL;
+/// Argument of lock_hook
+static __thread void *lock_hook_arg = NULL;
+
+/**
+ * @ingroup other_funcs
+ * @brief Makes attaching_state() report every tetromino attaching in the
+ * calling thread, with the field as it was before and the score it brought
+ * @param[in] hook Function to call, NULL to stop reporting
+ * @param[in] *arg Argument passed to the function
+ */
+void set_lock_hook(LockHook_t hook, void *arg) {
+  lock_hook = hook;
+  lock_hook_arg = arg;
+}
+
 /**
  * @ingroup fsm_funcs
  * @brief State of the game during tetromino attaching
  */
 void attaching_state() {
+  TRACE_SCOPE("attaching_state");
   GameInfo_t *stats = updateCurrentState();
+  LockEvent_t event;
+  if (lock_hook != NULL) {
+    memcpy(event.field, stats->field, sizeof(event.field));
+    event.current = stats->current_tetromino;
+    event.next = stats->next_tetromino.type;
+    event.x = stats->cur_x;
+    event.y = stats->cur_y;
+    event.reward = stats->score;
+  }
   for (int i = 0; i < 4; i++) {
     for (int j = 0; j < 4; j++) {
       if (stats->current_tetromino.tet[i][j] == 1) {
@@ -233,17 +476,9 @@ void attaching_state() {
     }
   }
   int row = clean_rows();
-  if (row >= 1) {
-    struct timespec ts;
-    ts.tv_sec = 400 / 1000;
-    ts.tv_nsec = (400 % 1000) * 1000000;
-    nanosleep(&ts, NULL);
-  } else {
-    struct timespec ts;
-    ts.tv_sec = 150 / 1000;
-    ts.tv_nsec = (150 % 1000) * 1000000;
-    nanosleep(&ts, NULL);
-  }
+  stats->counters.pieces++;
+  if (row >= 1) stats->counters.clears[(row < 4 ? row : 4) - 1]++;
+  stats->delay_ticks = (row >= 1 ? CLEAR_DELAY_MS : LOCK_DELAY_MS) / TICK_MS;
   if (row == 1)
     stats->score += 100;
   else if (row == 2)
@@ -255,7 +490,11 @@ void attaching_state() {
   stats->level = stats->score / 600;
   if (stats->level > 10) stats->level = 10;
   stats->speed = 700 - (stats->level * (stats->level > 5 ? 50 : 60));
-  save_score();
+  if (lock_hook != NULL) {
+    event.lines = row;
+    event.reward = stats->score - event.reward;
+    lock_hook(&event, lock_hook_arg);
+  }
 }
 
 /**
@@ -264,6 +503,7 @@ void attaching_state() {
  * @return Returns the number of rows cleared
  */
 int clean_rows() {
+  TRACE_SCOPE("clean_rows");
   GameInfo_t *stats = updateCurrentState();
   int row = 0;
   for (int j = 0; j < 20; j++) {
@@ -386,34 +626,37 @@ int check_field_rotate(int temp[4][4]) {
 /**
  * @ingroup move_funcs
  * @brief Tetromino rotation
+ *
+ * Turns the tetromino clockwise by SRS: in place if it fits there, else at
+ * the first kick of board_kicks that does.
  */
 void rotate() {
   GameInfo_t *stats = updateCurrentState();
-  int size = 3;
-  if (stats->current_tetromino.type == 0) {
-    size = 4;
-  }
-  if (stats->current_tetromino.type == 1) {
-    return;
-  }
-  int temp[4][4] = {0};
-  for (int i = 0; i < size; i++) {
-    for (int j = 0; j < size; j++) {
-      if (stats->current_tetromino.tet[i][j] == 1) temp[size - j - 1][i] = 1;
-    }
-  }
-  if (check_field_rotate(temp) == 0) {
-    for (int i = 0; i < 4; i++) {
-      for (int j = 0; j < 4; j++) {
-        if (temp[i][j] == 1)
-          stats->current_tetromino.tet[i][j] = 1;
-        else
-          stats->current_tetromino.tet[i][j] = 0;
-      }
-    }
-  }
+  int type = stats->current_tetromino.type;
+  int rot = piece_rotation(&stats->current_tetromino);
+  if (type == PIECE_O || rot < 0) return;
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(stats, rows);
+  int kick = board_kick(rows, type, rot, stats->cur_x, stats->cur_y - 1);
+  if (kick < 0) return;
+  stats->current_tetromino = piece_tetromino(type, (rot + 1) & 3);
+  stats->cur_x += board_kicks[type][rot][kick].x;
+  stats->cur_y += board_kicks[type][rot][kick].y;
 }
 
+/// File the high score is kept in, NULL to keep it in memory only
+static const char *score_file = "score";
+
+/**
+ * @ingroup stats_funcs
+ * @brief Sets the file the high score is read from and saved to
+ *
+ * Headless runs such as bot benchmarks pass NULL, so they neither read nor
+ * overwrite the player's high score.
+ * @param[in] *path File name, NULL to disable the score file
+ */
+void set_score_file(const char *path) { score_file = path; }
+
 /**
  * @ingroup stats_funcs
  * @brief Stats initialization
@@ -425,13 +668,17 @@ void stats_init(GameInfo_t *stats) {
       stats->field[i][j] = 0;
     }
   }
-  stats->next_tetromino = get_tetromino(rand() % RAND);
+  stats->counters = (GameCounters_t){0};
+  stats->seed = rand();
+  stats->next_tetromino = get_tetromino(rand_r(&stats->seed) % RAND);
   stats->score = 0;
   stats->speed = 700;
   stats->level = 0;
   stats->cur_x = 4;
   stats->cur_y = 1;
-  FILE *fp = fopen("score", "r");
+  stats->gravity_ticks = 0;
+  stats->delay_ticks = 0;
+  FILE *fp = score_file != NULL ? fopen(score_file, "r") : NULL;
   if (fp != NULL) {
     char temp[13] = "";
     fgets(temp, 12, fp);
@@ -440,14 +687,25 @@ void stats_init(GameInfo_t *stats) {
   }
 }
 
+/**
+ * @ingroup stats_funcs
+ * @brief Reseeds the piece generator, making the game reproducible
+ * @param[in] *stats Pointer to stats struct
+ * @param[in] seed Seed of the piece sequence
+ */
+void stats_seed(GameInfo_t *stats, unsigned int seed) {
+  stats->seed = seed;
+  stats->next_tetromino = get_tetromino(rand_r(&stats->seed) % RAND);
+}
+
 /**
  * @ingroup stats_funcs
  * @brief Saving score to a file
  */
 void save_score() {
   GameInfo_t *stats = updateCurrentState();
-  if (stats->score > stats->high_score) {
-    FILE *fp = fopen("score", "w");
+  if (stats->score > stats->high_score && score_file != NULL) {
+    FILE *fp = fopen(score_file, "w");
     if (fp != NULL) {
       fprintf(fp, "%d", stats->score);
       fclose(fp);
@@ -462,25 +720,25 @@ void save_score() {
  * @param[in] sig Human-readable signal from user
  */
 void pause_game(FSM_STATES_g *state, UserAction_t sig) {
-  GameInfo_t *stats = updateCurrentState();
-  stats->pause += 1;
-  if (sig == Terminate) {
-    *state = EXIT_STATE;
-  } else if (sig == Pause && stats->pause > 1) {
-    *state = MOVING;
-    stats->pause = 0;
-  }
+  fsm_handle(PAUSE, state, sig);
 }
 
+/// Game the calling thread works with instead of the singleton, if set
+static __thread GameInfo_t *bound_state = NULL;
+
 /**
  * @ingroup other_funcs
  * @brief Singleton function for stats update in any time
+ *
+ * A thread that called bind_game_state() gets its own game instead.
  * @return Returns the current game stats
  */
 GameInfo_t *updateCurrentState() {
   static GameInfo_t state;
   static int initialized = 0;
 
+  if (bound_state != NULL) return bound_state;
+
   if (!initialized) {
     stats_init(&state);
     initialized = 1;
@@ -488,3 +746,33 @@ GameInfo_t *updateCurrentState() {
 
   return &state;
 }
+
+/**
+ * @ingroup other_funcs
+ * @brief Makes all game functions of the calling thread work with the given
+ * game
+ * @param[in] *stats Game stats, NULL to return to the singleton
+ */
+void bind_game_state(GameInfo_t *stats) { bound_state = stats; }
+
+/**
+ * @ingroup other_funcs
+ * @brief Monotonic clock in milliseconds
+ * @return Returns the current time, ms
+ */
+long get_time_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @ingroup other_funcs
+ * @brief Monotonic clock in microseconds
+ * @return Returns the current time, us
+ */
+long get_time_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
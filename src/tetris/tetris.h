@@ -10,11 +10,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+
+#include "trace.h"
 /// The number of tetrominos we want to use in the game, 7 in total
 #define RAND 7
+/// Length of one logical tick of the game clock, ms
+#define TICK_MS 10
+/// Pause before the next spawn after a tetromino attaches, ms
+#define LOCK_DELAY_MS 150
+/// Pause before the next spawn after rows are cleared, ms
+#define CLEAR_DELAY_MS 400
+/// Columns a board takes with its side panel: the field, its border and
+/// garbage bar, NEXT, SCORE and GARBAGE; only the start-screen help is wider
+#define PANEL_COLS 40
 
 /**
  * @brief FSM Definition
+ *
+ * Signals are dispatched through a table of handlers indexed by state and
+ * signal, built at compile time in tetris.c. A new state is a value here
+ * and a row of handlers there.
  */
 typedef enum {
   START,
@@ -37,7 +52,8 @@ typedef enum {
   Right,
   Up,
   Down,
-  Action
+  Action,
+  Rewind
 } UserAction_t;
 
 /**
@@ -50,6 +66,60 @@ typedef struct {
   int tet[4][4];
 } tetromino;
 
+/**
+ * @brief Counters of one game, written out as telemetry when it ends
+ */
+typedef struct {
+  /// @brief Tetrominos attached
+  int pieces;
+  /// @brief Signals handled while a tetromino was moving
+  int actions;
+  /// @brief Clears of 1, 2, 3 and 4 rows at once
+  int clears[4];
+  /// @brief Ticks spent in every state
+  long state_ticks[EXIT_STATE + 1];
+} GameCounters_t;
+
+/**
+ * @brief Tetromino that attached, as passed to the lock hook
+ */
+typedef struct {
+  /// @brief Field before the tetromino was written into it
+  int field[12][22];
+  /// @brief Tetromino
+  tetromino current;
+  /// @brief Type of the next tetromino
+  int next;
+  /// @brief Position of the tetromino at X
+  int x;
+  /// @brief Position of the tetromino at Y
+  int y;
+  /// @brief Rows cleared
+  int lines;
+  /// @brief Score gained
+  int reward;
+} LockEvent_t;
+
+/// Handler of one signal in one state, may change the state
+typedef void (*FsmHandler_t)(FSM_STATES_g *state, UserAction_t sig);
+
+/**
+ * @brief Counters of the state machine of one thread
+ */
+typedef struct {
+  /// @brief Times every state was entered
+  long entries[EXIT_STATE + 1];
+  /// @brief Time spent in every state, ns, if the states are timed
+  long time_ns[EXIT_STATE + 1];
+  /// @brief Signals every state got and did not expect
+  long unexpected[EXIT_STATE + 1];
+  /// @brief Signals dispatched
+  long dispatches;
+} FsmStats_t;
+
+/// Function attaching_state() reports every tetromino to
+typedef void (*LockHook_t)(const LockEvent_t *event, void *arg);
+
 /**
  * @brief Structure containing game stats
  */
@@ -74,6 +144,14 @@ typedef struct {
   int cur_x;
   /// @brief Position of the current tetromino at Y
   int cur_y;
+  /// @brief Ticks accumulated towards the next gravity drop
+  int gravity_ticks;
+  /// @brief Ticks left before the next spawn
+  int delay_ticks;
+  /// @brief State of the piece generator
+  unsigned int seed;
+  /// @brief Telemetry counters
+  GameCounters_t counters;
 } GameInfo_t;
 
 /**
@@ -81,12 +159,18 @@ typedef struct {
  */
 void userInput(FSM_STATES_g *state, UserAction_t sig);
 UserAction_t get_signal(int user_input);
+void fsm_stats(FsmStats_t *stats);
+void fsm_stats_reset(int timed);
 
 /**
  * @defgroup other_funcs Other
  */
 GameInfo_t *updateCurrentState();
+void bind_game_state(GameInfo_t *stats);
+void set_lock_hook(LockHook_t hook, void *arg);
 tetromino get_tetromino(int num);
+long get_time_ms();
+long get_time_us();
 void game_loop();
 
 /**
@@ -95,6 +179,7 @@ void game_loop();
 void start_state(FSM_STATES_g *state, UserAction_t sig);
 void spawn_state(FSM_STATES_g *state);
 void moving_state(FSM_STATES_g *state, UserAction_t sig);
+void step_ticks(FSM_STATES_g *state, long ticks);
 void attaching_state();
 void pause_game(FSM_STATES_g *state, UserAction_t sig);
 void game_over(FSM_STATES_g *state, UserAction_t sig);
@@ -103,7 +188,9 @@ void game_over(FSM_STATES_g *state, UserAction_t sig);
  * @defgroup stats_funcs Statistics and score management
  */
 void stats_init(GameInfo_t *stats);
+void stats_seed(GameInfo_t *stats, unsigned int seed);
 void save_score();
+void set_score_file(const char *path);
 
 /**
  * @defgroup graphics_funcs GUI and graphics
@@ -116,6 +203,10 @@ void print_start_banner();
 void print_something(FSM_STATES_g state);
 void clear_field();
 void clear_info();
+void clear_screen();
+void set_draw_offset(int x);
+void set_hint(const tetromino *tet, int x, int y);
+void print_garbage(int rows);
 
 /**
  * @defgroup move_funcs Tetromino controls
@@ -0,0 +1,179 @@
+/**
+ * @file trace.c
+ * @brief Opt-in tracing of FSM transitions and hot-path timings
+ *
+ * Every thread writes only into its own buffer, so recording takes no lock.
+ * Buffers are pushed onto a global list with a compare-and-swap the first
+ * time a thread records something and are never freed before exit.
+ */
+
+#include "tetris.h"
+
+#ifdef TETRIS_TRACE
+
+/**
+ * @brief Single trace event
+ */
+typedef struct {
+  /// @brief Scope name, NULL for a transition
+  const char *name;
+  /// @brief Start time, us
+  long ts;
+  /// @brief Duration, us
+  long dur;
+  /// @brief Previous state of a transition
+  int from;
+  /// @brief New state of a transition
+  int to;
+} trace_record;
+
+/**
+ * @brief Per-thread event buffer
+ */
+typedef struct trace_buffer {
+  /// @brief Next buffer in the global list
+  struct trace_buffer *next;
+  /// @brief Thread number in the trace
+  int tid;
+  /// @brief Number of stored records
+  int count;
+  /// @brief Number of records lost to a full buffer
+  long dropped;
+  /// @brief Records
+  trace_record records[TRACE_BUFFER_SIZE];
+} trace_buffer;
+
+static trace_buffer *trace_buffers = NULL;
+static int trace_threads = 0;
+static __thread trace_buffer *trace_local = NULL;
+
+static const char *trace_state_names[] = {"START",     "SPAWN",
+                                          "MOVING",    "PAUSE",
+                                          "ATTACHING", "GAME_OVER",
+                                          "EXIT_STATE"};
+
+/**
+ * @ingroup trace_funcs
+ * @brief Reserves a record in the calling thread's buffer
+ * @return Returns the record, NULL if the buffer is full
+ */
+static trace_record *trace_reserve() {
+  if (trace_local == NULL) {
+    trace_buffer *buffer = calloc(1, sizeof(trace_buffer));
+    if (buffer == NULL) return NULL;
+    buffer->tid = __atomic_add_fetch(&trace_threads, 1, __ATOMIC_RELAXED);
+    buffer->next = __atomic_load_n(&trace_buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&trace_buffers, &buffer->next, buffer,
+                                        1, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) {
+    }
+    trace_local = buffer;
+  }
+  if (trace_local->count == TRACE_BUFFER_SIZE) {
+    trace_local->dropped++;
+    return NULL;
+  }
+  return &trace_local->records[trace_local->count];
+}
+
+/**
+ * @ingroup trace_funcs
+ * @brief Publishes the record taken by trace_reserve()
+ */
+static void trace_commit() {
+  __atomic_store_n(&trace_local->count, trace_local->count + 1,
+                   __ATOMIC_RELEASE);
+}
+
+/**
+ * @ingroup trace_funcs
+ * @brief Starts a timed scope
+ * @param[in] *name Scope name, must be a string literal
+ * @return Returns the scope to be passed to trace_scope_end()
+ */
+trace_scope trace_scope_begin(const char *name) {
+  trace_scope scope = {name, get_time_us()};
+  return scope;
+}
+
+/**
+ * @ingroup trace_funcs
+ * @brief Records a finished scope, called automatically at the scope exit
+ * @param[in] *scope Scope started by trace_scope_begin()
+ */
+void trace_scope_end(trace_scope *scope) {
+  long now = get_time_us();
+  trace_record *record = trace_reserve();
+  if (record != NULL) {
+    record->name = scope->name;
+    record->ts = scope->start;
+    record->dur = now - scope->start;
+    trace_commit();
+  }
+}
+
+/**
+ * @ingroup trace_funcs
+ * @brief Records a transition of the finite automaton
+ * @param[in] from Previous state
+ * @param[in] to New state
+ */
+void trace_transition(int from, int to) {
+  trace_record *record = trace_reserve();
+  if (record != NULL) {
+    record->name = NULL;
+    record->ts = get_time_us();
+    record->dur = 0;
+    record->from = from;
+    record->to = to;
+    trace_commit();
+  }
+}
+
+/**
+ * @ingroup trace_funcs
+ * @brief Writes all recorded events as Chrome trace-event JSON
+ * @param[in] *path Output file
+ * @return Returns 0 on success, 1 if the file could not be written
+ */
+int trace_write(const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL) return 1;
+  fprintf(fp, "{\"traceEvents\":[");
+  int first = 1;
+  trace_buffer *buffer = __atomic_load_n(&trace_buffers, __ATOMIC_ACQUIRE);
+  for (; buffer != NULL; buffer = buffer->next) {
+    int count = __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+      trace_record *r = &buffer->records[i];
+      fprintf(fp, first ? "\n" : ",\n");
+      first = 0;
+      if (r->name != NULL) {
+        fprintf(fp,
+                "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%ld,\"dur\":%ld,"
+                "\"pid\":1,\"tid\":%d}",
+                r->name, r->ts, r->dur, buffer->tid);
+      } else {
+        fprintf(fp,
+                "{\"name\":\"%s->%s\",\"cat\":\"fsm\",\"ph\":\"i\",\"s\":\"t\","
+                "\"ts\":%ld,\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"from\":\"%s\",\"to\":\"%s\"}}",
+                trace_state_names[r->from], trace_state_names[r->to], r->ts,
+                buffer->tid, trace_state_names[r->from],
+                trace_state_names[r->to]);
+      }
+    }
+    if (buffer->dropped > 0) {
+      fprintf(fp,
+              "%s\n{\"name\":\"dropped\",\"ph\":\"C\",\"ts\":0,\"pid\":1,"
+              "\"tid\":%d,\"args\":{\"records\":%ld}}",
+              first ? "" : ",", buffer->tid, buffer->dropped);
+      first = 0;
+    }
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+  return 0;
+}
+
+#endif /* TETRIS_TRACE */
@@ -0,0 +1,66 @@
+/**
+ * @file trace.h
+ * @brief Opt-in tracing of FSM transitions and hot-path timings
+ *
+ * Build with -DTETRIS_TRACE (make trace) to record events into per-thread
+ * buffers and write them as Chrome trace-event JSON (chrome://tracing,
+ * Perfetto). Without the flag every macro expands to nothing.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/// Name of the file the trace is written to
+#define TRACE_FILE "trace.json"
+/// Records kept per thread, later records are counted and dropped
+#define TRACE_BUFFER_SIZE 65536
+
+#ifdef TETRIS_TRACE
+
+/**
+ * @brief Start of a timed scope
+ */
+typedef struct {
+  /// @brief Scope name
+  const char *name;
+  /// @brief Start time, us
+  long start;
+} trace_scope;
+
+/**
+ * @defgroup trace_funcs Tracing
+ */
+trace_scope trace_scope_begin(const char *name);
+void trace_scope_end(trace_scope *scope);
+void trace_transition(int from, int to);
+int trace_write(const char *path);
+
+/// Times the rest of the enclosing block
+#define TRACE_SCOPE(name)                                               \
+  trace_scope trace_scope_ __attribute__((cleanup(trace_scope_end))) = \
+      trace_scope_begin(name)
+/// Records a state change, does nothing if the state is unchanged
+#define TRACE_TRANSITION(from, to)                  \
+  do {                                              \
+    if ((from) != (to)) trace_transition(from, to); \
+  } while (0)
+/// Writes all recorded events to TRACE_FILE
+#define TRACE_WRITE() trace_write(TRACE_FILE)
+
+#else
+
+#define TRACE_SCOPE(name) \
+  do {                    \
+  } while (0)
+#define TRACE_TRANSITION(from, to) \
+  do {                             \
+    (void)(from);                  \
+    (void)(to);                    \
+  } while (0)
+#define TRACE_WRITE() \
+  do {                \
+  } while (0)
+
+#endif /* TETRIS_TRACE */
+
+#endif /* TRACE_H */
@@ -0,0 +1,226 @@
+/**
+ * @file versus.c
+ * @brief Two-board versus matches with garbage exchange
+ *
+ * The engine works on the game bound to the calling thread, so every step
+ * of a board binds its game first and unbinds it afterwards. A board is
+ * looked at after each tick: a rise in its attach counter means a tetromino
+ * attached, and the clear counters filled from clean_rows() tell how many
+ * rows went with it. The delay before the next spawn is at least one tick,
+ * so garbage always rises before the next tetromino appears.
+ */
+
+#include "versus.h"
+
+#include <string.h>
+
+/// Garbage rows sent for 0, 1, 2, 3 and 4 rows cleared at once
+static const int versus_attack[5] = {0, 0, 1, 2, 4};
+
+/**
+ * @ingroup versus_funcs
+ * @brief Adds a batch of garbage to a queue
+ *
+ * When the queue is full, the rows join the newest batch.
+ * @param[in] *queue Queue
+ * @param[in] rows Number of rows
+ * @param[in] hole Column of the hole
+ */
+void garbage_push(GarbageQueue_t *queue, int rows, int hole) {
+  if (rows <= 0) return;
+  queue->rows += rows;
+  if (queue->count == VERSUS_QUEUE) {
+    int last = (queue->head + queue->count - 1) % VERSUS_QUEUE;
+    queue->batches[last].rows += rows;
+    return;
+  }
+  GarbageBatch_t *batch =
+      &queue->batches[(queue->head + queue->count++) % VERSUS_QUEUE];
+  batch->rows = rows;
+  batch->hole = hole;
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Cancels pending garbage with rows about to be sent, oldest first
+ * @param[in] *queue Queue
+ * @param[in] rows Rows about to be sent
+ * @return Returns the rows left to send
+ */
+int garbage_cancel(GarbageQueue_t *queue, int rows) {
+  while (rows > 0 && queue->count > 0) {
+    GarbageBatch_t *batch = &queue->batches[queue->head];
+    int cancel = rows < batch->rows ? rows : batch->rows;
+    batch->rows -= cancel;
+    queue->rows -= cancel;
+    rows -= cancel;
+    if (batch->rows == 0) {
+      queue->head = (queue->head + 1) % VERSUS_QUEUE;
+      queue->count--;
+    }
+  }
+  return rows;
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Pushes garbage rows into the bitboard from below
+ * @param[in] *rows Field rows
+ * @param[in] count Number of garbage rows
+ * @param[in] hole Column of the hole
+ * @return Returns 1 if filled cells were pushed over the top
+ */
+int garbage_rise(uint16_t *rows, int count, int hole) {
+  if (count > BOARD_HEIGHT) count = BOARD_HEIGHT;
+  int over = 0;
+  for (int j = 0; j < count; j++) over |= rows[j] != BOARD_EMPTY_ROW;
+  memmove(rows, rows + count, (BOARD_HEIGHT - count) * sizeof(uint16_t));
+  for (int j = BOARD_HEIGHT - count; j < BOARD_HEIGHT; j++)
+    rows[j] = BOARD_FULL_ROW & ~(1 << (hole + BOARD_SHIFT));
+  return over;
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Starts a match, both boards get the same piece sequence
+ *
+ * Both sides are left to the player, the caller sets the bots up.
+ * @param[out] *match Match
+ * @param[in] seed Seed of the piece sequence and of the hole columns
+ */
+void versus_init(Versus_t *match, unsigned int seed) {
+  memset(match, 0, sizeof(Versus_t));
+  match->seed = seed;
+  match->winner = VERSUS_PLAYING;
+  for (int i = 0; i < 2; i++) {
+    VersusSide_t *side = &match->sides[i];
+    bind_game_state(&side->game);
+    stats_init(&side->game);
+    stats_seed(&side->game, seed);
+    bind_game_state(NULL);
+    side->state = SPAWN;
+  }
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Gives a player's signal to a board
+ *
+ * Only moves of a falling tetromino are taken, pausing and quitting concern
+ * the whole match and are up to the caller.
+ * @param[in] *match Match
+ * @param[in] side Board
+ * @param[in] sig Signal
+ */
+void versus_input(Versus_t *match, int side, UserAction_t sig) {
+  VersusSide_t *board = &match->sides[side];
+  if (match->winner != VERSUS_PLAYING || board->state != MOVING) return;
+  if (sig != Left && sig != Right && sig != Down && sig != Action) return;
+  bind_game_state(&board->game);
+  userInput(&board->state, sig);
+  bind_game_state(NULL);
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Gives the next signal of a bot, choosing a placement if needed
+ * @param[in] *side Board bound to this thread
+ */
+static void versus_bot_act(VersusSide_t *side) {
+  VersusBot_t *bot = &side->bot;
+  GameInfo_t *stats = &side->game;
+  if (side->state != MOVING) {
+    bot->planned = 0;
+    return;
+  }
+  if (bot->wait > 0) {
+    bot->wait--;
+    return;
+  }
+  if (!bot->planned || stats->cur_y != bot->y) {
+    int stuck = bot->search != NULL ? bot_search(bot->search, stats, &bot->plan)
+                                    : bot_greedy(stats, &bot->plan);
+    if (stuck) return;
+    bot->planned = 1;
+    bot->step = 0;
+  }
+  UserAction_t sig =
+      bot->step < bot->plan.path_len ? bot->plan.path[bot->step++] : Down;
+  userInput(&side->state, sig);
+  bot->y = stats->cur_y;
+  bot->wait = bot->interval - 1;
+  if (side->state != MOVING) bot->planned = 0;
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Settles the garbage of a tetromino that just attached
+ * @param[in] *match Match
+ * @param[in] side Board bound to this thread
+ * @return Returns the garbage rows to send to the opponent
+ */
+static int versus_settle(Versus_t *match, int side) {
+  VersusSide_t *board = &match->sides[side];
+  const GameCounters_t *counters = &board->game.counters;
+  if (counters->pieces == board->pieces_seen) return 0;
+  int lines = 0;
+  for (int k = 0; k < 4; k++) lines += counters->clears[k] * (k + 1);
+  int cleared = lines - board->lines_seen;
+  board->pieces_seen = counters->pieces;
+  board->lines_seen = lines;
+  if (cleared > 0)
+    return garbage_cancel(&board->pending,
+                          versus_attack[cleared < 4 ? cleared : 4]);
+  if (board->pending.count == 0) return 0;
+  uint16_t rows[BOARD_HEIGHT];
+  board_from_field(&board->game, rows);
+  int over = 0;
+  for (int left = VERSUS_MAX_RISE; left > 0 && board->pending.count > 0;) {
+    GarbageBatch_t *batch = &board->pending.batches[board->pending.head];
+    int count = batch->rows < left ? batch->rows : left;
+    over |= garbage_rise(rows, count, batch->hole);
+    garbage_cancel(&board->pending, count);
+    board->received += count;
+    left -= count;
+  }
+  board_to_field(rows, &board->game);
+  if (over) board->state = GAME_OVER;
+  return 0;
+}
+
+/**
+ * @ingroup versus_funcs
+ * @brief Advances both boards by one tick
+ *
+ * Bots give their signals, then the garbage sent during the tick crosses
+ * over, so neither board is favoured. The match ends when a board is over,
+ * or at the tick limit, which goes to the side that sent more rows.
+ * @param[in] *match Match
+ */
+void versus_tick(Versus_t *match) {
+  if (match->winner != VERSUS_PLAYING) return;
+  int sent[2];
+  for (int i = 0; i < 2; i++) {
+    VersusSide_t *side = &match->sides[i];
+    bind_game_state(&side->game);
+    if (side->bot.interval > 0) versus_bot_act(side);
+    step_ticks(&side->state, 1);
+    sent[i] = versus_settle(match, i);
+    bind_game_state(NULL);
+  }
+  for (int i = 0; i < 2; i++) {
+    if (sent[i] == 0) continue;
+    garbage_push(&match->sides[1 - i].pending, sent[i],
+                 rand_r(&match->seed) % BOARD_WIDTH);
+    match->sides[i].sent += sent[i];
+  }
+  match->tick++;
+  int lost0 = match->sides[0].state == GAME_OVER;
+  int lost1 = match->sides[1].state == GAME_OVER;
+  if (lost0 || lost1) {
+    match->winner = lost0 && lost1 ? VERSUS_DRAW : lost0 ? 1 : 0;
+  } else if (match->tick_limit > 0 && match->tick >= match->tick_limit) {
+    int diff = match->sides[0].sent - match->sides[1].sent;
+    match->winner = diff > 0 ? 0 : diff < 0 ? 1 : VERSUS_DRAW;
+  }
+}
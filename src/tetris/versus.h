@@ -0,0 +1,125 @@
+/**
+ * @file versus.h
+ * @brief Two-board versus matches with garbage exchange
+ *
+ * Both boards run the reference engine on the same piece sequence and
+ * advance together one logical tick at a time. Clearing 2, 3 or 4 rows at
+ * once sends 1, 2 or 4 garbage rows to the opponent: full rows with one
+ * hole, pushed in from below. Rows sent first cancel garbage still pending
+ * against the sender, only the rest goes over. Pending garbage rises when
+ * the receiver attaches a tetromino without clearing anything. A board
+ * whose tetromino does not fit or whose cells are pushed over the top
+ * loses.
+ *
+ * Either side can be played by a bot that gives one signal every few ticks,
+ * so bot-vs-bot matches need no wall clock and run as fast as the CPU
+ * allows.
+ */
+
+#ifndef VERSUS_H
+#define VERSUS_H
+#include "bot.h"
+
+/// Most garbage batches pending against one board
+#define VERSUS_QUEUE 16
+/// Most garbage rows rising after one tetromino
+#define VERSUS_MAX_RISE 8
+/// Versus_t::winner while the match goes on
+#define VERSUS_PLAYING -1
+/// Versus_t::winner when neither board won
+#define VERSUS_DRAW 2
+
+/**
+ * @brief Garbage rows sent by one clear
+ */
+typedef struct {
+  /// @brief Number of rows
+  uint8_t rows;
+  /// @brief Column of the hole
+  uint8_t hole;
+} GarbageBatch_t;
+
+/**
+ * @brief Garbage pending against a board, oldest batch first
+ */
+typedef struct {
+  /// @brief Ring of batches
+  GarbageBatch_t batches[VERSUS_QUEUE];
+  /// @brief Index of the oldest batch
+  int head;
+  /// @brief Number of batches
+  int count;
+  /// @brief Rows in all batches
+  int rows;
+} GarbageQueue_t;
+
+/**
+ * @brief Bot playing one side of a match
+ */
+typedef struct {
+  /// @brief Ticks between two signals, 0 if a player controls the side
+  int interval;
+  /// @brief Expectimax bot to search with, NULL for the greedy choice
+  Bot_t *search;
+  /// @brief Ticks left until the next signal
+  int wait;
+  /// @brief Set while plan leads the current tetromino
+  int planned;
+  /// @brief Next signal of the plan
+  int step;
+  /// @brief Position of the tetromino at Y after the last signal, gravity
+  /// moving it makes the bot plan again
+  int y;
+  /// @brief Chosen placement of the current tetromino
+  Placement_t plan;
+} VersusBot_t;
+
+/**
+ * @brief One board of a match
+ */
+typedef struct {
+  /// @brief Game
+  GameInfo_t game;
+  /// @brief Game state
+  FSM_STATES_g state;
+  /// @brief Garbage waiting to rise
+  GarbageQueue_t pending;
+  /// @brief Tetrominos attached when the board was last looked at
+  int pieces_seen;
+  /// @brief Rows cleared when the board was last looked at
+  int lines_seen;
+  /// @brief Garbage rows sent to the opponent after cancelling
+  int sent;
+  /// @brief Garbage rows that rose on this board
+  int received;
+  /// @brief Bot playing the side
+  VersusBot_t bot;
+} VersusSide_t;
+
+/**
+ * @brief Versus match
+ */
+typedef struct {
+  /// @brief Boards
+  VersusSide_t sides[2];
+  /// @brief Generator of the hole columns
+  unsigned int seed;
+  /// @brief Ticks played
+  long tick;
+  /// @brief Ticks the match lasts at most, 0 for no limit
+  long tick_limit;
+  /// @brief Winning side, VERSUS_DRAW or VERSUS_PLAYING
+  int winner;
+} Versus_t;
+
+/**
+ * @defgroup versus_funcs Versus mode
+ */
+void garbage_push(GarbageQueue_t *queue, int rows, int hole);
+int garbage_cancel(GarbageQueue_t *queue, int rows);
+int garbage_rise(uint16_t *rows, int count, int hole);
+void versus_init(Versus_t *match, unsigned int seed);
+void versus_input(Versus_t *match, int side, UserAction_t sig);
+void versus_tick(Versus_t *match);
+
+#endif /* VERSUS_H */
@@ -0,0 +1,45 @@
+/**
+ * @file batch_bench.c
+ * @brief Throughput of batch stepping, environment steps per second per core
+ *
+ * Usage: batch_bench.out [games] [steps]
+ */
+
+#include "../tetris/batch.h"
+
+int main(int argc, char *argv[]) {
+  int games = argc > 1 ? atoi(argv[1]) : 4096;
+  int steps = argc > 2 ? atoi(argv[2]) : 2000;
+  if (games <= 0 || steps <= 0) {
+    fprintf(stderr, "usage: %s [games] [steps]\n", argv[0]);
+    return 1;
+  }
+  TetrisBatch_t *batch = batch_create(games, 1);
+  UserAction_t *actions = calloc(games, sizeof(UserAction_t));
+  int *rewards = calloc(games, sizeof(int));
+  int *dones = calloc(games, sizeof(int));
+  if (batch == NULL || actions == NULL || rewards == NULL || dones == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  static const UserAction_t choice[] = {0, Left, Right, Down, Action};
+  unsigned int seed = 1;
+  long episodes = 0;
+  long start = get_time_ms();
+  for (int s = 0; s < steps; s++) {
+    for (int g = 0; g < games; g++) actions[g] = choice[rand_r(&seed) % 5];
+    tetris_batch_step(batch, actions, rewards, dones);
+    for (int g = 0; g < games; g++) episodes += dones[g];
+  }
+  long elapsed = get_time_ms() - start;
+  if (elapsed == 0) elapsed = 1;
+  double total = (double)games * steps;
+  printf("games %d, steps %d, episodes %ld\n", games, steps, episodes);
+  printf("%.0f env steps/s per core (%.1f ns/step)\n", total * 1000 / elapsed,
+         elapsed * 1e6 / total);
+  batch_free(batch);
+  free(actions);
+  free(rewards);
+  free(dones);
+  return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file bot_bench.c
+ * @brief Expectimax bot against the greedy one on seeded headless games
+ *
+ * Both bots play the same piece sequences on the reference engine. Reports
+ * the mean scores, the share of games the expectimax bot scored more in (a
+ * draw counts half) and its search speed in placements evaluated per second.
+ *
+ * Usage: bot_bench.out [games] [pieces] [depth] [budget_ms] [threads]
+ */
+
+#include "../tetris/bot.h"
+
+/// Sum of the depths the expectimax searches completed
+static long depth_sum = 0;
+
+/**
+ * @brief Plays one seeded game to the end or to the piece limit
+ * @param[in] *bot Expectimax bot, NULL to play greedy
+ * @param[in] seed Seed of the piece sequence
+ * @param[in] pieces Piece limit
+ * @param[out] *placed Pieces placed
+ * @return Returns the score
+ */
+static int play(Bot_t *bot, unsigned int seed, int pieces, int *placed) {
+  GameInfo_t game;
+  FSM_STATES_g state = SPAWN;
+  Placement_t move;
+  bind_game_state(&game);
+  stats_init(&game);
+  stats_seed(&game, seed);
+  userInput(&state, 0);
+  for (*placed = 0; state == MOVING && *placed < pieces; (*placed)++) {
+    int stuck = bot != NULL ? bot_search(bot, &game, &move)
+                            : bot_greedy(&game, &move);
+    if (stuck) break;
+    if (bot != NULL) depth_sum += bot->depth_reached;
+    bot_execute(&state, &move);
+  }
+  bind_game_state(NULL);
+  return game.score;
+}
+
+int main(int argc, char *argv[]) {
+  int games = argc > 1 ? atoi(argv[1]) : 10;
+  int pieces = argc > 2 ? atoi(argv[2]) : 200;
+  BotConfig_t config = {argc > 3 ? atoi(argv[3]) : 3,
+                        argc > 4 ? atol(argv[4]) * 1000 : 50000,
+                        argc > 5 ? atoi(argv[5]) : 4};
+  if (games <= 0 || pieces <= 0 || config.depth <= 0 || config.budget_us < 0) {
+    fprintf(stderr,
+            "usage: %s [games] [pieces] [depth] [budget_ms] [threads]\n",
+            argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  Bot_t *bot = bot_create(&config);
+  if (bot == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  double wins = 0;
+  long greedy_total = 0, expecti_total = 0, moves = 0;
+  for (int g = 0; g < games; g++) {
+    int greedy_placed, expecti_placed;
+    int greedy = play(NULL, g + 1, pieces, &greedy_placed);
+    int expecti = play(bot, g + 1, pieces, &expecti_placed);
+    printf("game %d: greedy %d (%d pieces), expectimax %d (%d pieces)\n", g,
+           greedy, greedy_placed, expecti, expecti_placed);
+    wins += expecti > greedy ? 1 : expecti == greedy ? 0.5 : 0;
+    greedy_total += greedy;
+    expecti_total += expecti;
+    moves += expecti_placed;
+  }
+  double seconds = bot->elapsed_us > 0 ? bot->elapsed_us / 1e6 : 1e-6;
+  printf("depth %d, budget %ld ms, %d threads\n", bot->config.depth,
+         bot->config.budget_us / 1000, bot->config.threads);
+  printf("mean score: greedy %.1f, expectimax %.1f\n",
+         (double)greedy_total / games, (double)expecti_total / games);
+  printf("expectimax win rate vs greedy: %.1f%%\n", wins * 100 / games);
+  if (moves == 0) moves = 1;
+  printf("%.0f nodes/s, %.2f ms/move, mean depth reached %.2f\n",
+         bot->nodes / seconds, bot->elapsed_us / 1e3 / moves,
+         (double)depth_sum / moves);
+  bot_free(bot);
+  return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file bot_plugin_example.c
+ * @brief Example bot controller built as a shared object
+ *
+ * Built on its own against bot_plugin.h only:
+ * gcc -shared -fPIC tools/bot_plugin_example.c -o bot_plugin_example.so
+ *
+ * Tries every turn and column of the falling tetromino and takes the one
+ * leaving the lowest and flattest stack with the fewest holes, full rows
+ * cleared. A placement counts only if the game can get there the way it
+ * moves tetrominos: turns where the tetromino is, without a kick, then shifts
+ * one column at a time in the row it is in, then drops straight down.
+ *
+ * The view only shows the tetromino as it is; the turned ones are worked out
+ * by turning its cells clockwise within their box, 4x4 for I, 2x2 for O,
+ * which never turns, and 3x3 for the others.
+ */
+
+#include <stddef.h>
+
+#include "../tetris/bot_plugin.h"
+
+/// Largest field the controller plays
+#define MAX_WIDTH 16
+#define MAX_HEIGHT 32
+
+/// Weights of the cost: stack height, rows cleared, holes, bumpiness
+#define COST_HEIGHT 51
+#define COST_LINES 76
+#define COST_HOLES 36
+#define COST_BUMPS 18
+
+/**
+ * @brief Whether a tetromino overlaps the field or its walls
+ * @param[in] *view Game
+ * @param[in] *shape Cells of the tetromino, as piece in BotView_t
+ * @param[in] x Position of the tetromino at X
+ * @param[in] y Position of the tetromino at Y
+ * @return Returns 1 if it does
+ */
+static int collides(const BotView_t *view, const int32_t *shape, int x,
+                    int y) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (!shape[i * 4 + j]) continue;
+      int cx = x + i, cy = y + j - 1;
+      if (cx < 0 || cx >= view->width || cy >= view->height) return 1;
+      if (cy >= 0 && view->field[cx * view->stride + cy]) return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Whether a tetromino where the falling one is can be shifted to a
+ * column, one column at a time in the row it is in
+ * @param[in] *view Game
+ * @param[in] *shape Cells of the tetromino
+ * @param[in] to_x Position at X to shift to
+ * @return Returns 1 if it can
+ */
+static int reachable(const BotView_t *view, const int32_t *shape, int to_x) {
+  int x = *view->x, y = *view->y;
+  for (int step = to_x < x ? -1 : 1; x != to_x; x += step)
+    if (collides(view, shape, x + step, y)) return 0;
+  return 1;
+}
+
+/**
+ * @brief Cost of the field once a tetromino attaches, the lower the better
+ * @param[in] *view Game
+ * @param[in] *shape Cells of the tetromino
+ * @param[in] x Position of the tetromino at X
+ * @param[in] y Position of the tetromino at Y when it attaches
+ * @return Returns the weighted sum of the column heights, rows cleared,
+ * holes and height differences of neighbouring columns
+ */
+static int cost(const BotView_t *view, const int32_t *shape, int x, int y) {
+  uint8_t cells[MAX_WIDTH][MAX_HEIGHT];
+  int w = view->width, h = view->height, lines = 0;
+  for (int cx = 0; cx < w; cx++) {
+    for (int cy = 0; cy < h; cy++)
+      cells[cx][cy] = view->field[cx * view->stride + cy] != 0;
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++)
+      if (shape[i * 4 + j] && y + j - 1 >= 0) cells[x + i][y + j - 1] = 1;
+  }
+  int to = h - 1;
+  for (int cy = h - 1; cy >= 0; cy--) {
+    int full = 1;
+    for (int cx = 0; cx < w && full; cx++) full = cells[cx][cy];
+    if (full) {
+      lines++;
+      continue;
+    }
+    for (int cx = 0; cx < w; cx++) cells[cx][to] = cells[cx][cy];
+    to--;
+  }
+  for (; to >= 0; to--) {
+    for (int cx = 0; cx < w; cx++) cells[cx][to] = 0;
+  }
+  int height = 0, holes = 0, bumps = 0, last = 0;
+  for (int cx = 0; cx < w; cx++) {
+    int top = 0;
+    while (top < h && !cells[cx][top]) top++;
+    for (int cy = top; cy < h; cy++) holes += !cells[cx][cy];
+    height += h - top;
+    if (cx > 0) bumps += h - top > last ? h - top - last : last - (h - top);
+    last = h - top;
+  }
+  return COST_HEIGHT * height - COST_LINES * lines + COST_HOLES * holes +
+         COST_BUMPS * bumps;
+}
+
+/**
+ * @brief Size of the box a tetromino turns in
+ * @param[in] *shape Cells of the tetromino
+ * @return Returns 4 if it reaches the last row or column of its 4x4 cells,
+ * 2 if it fits in 2x2, 3 otherwise
+ */
+static int box_size(const int32_t *shape) {
+  int reach = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (shape[i * 4 + j] && i > reach) reach = i;
+      if (shape[i * 4 + j] && j > reach) reach = j;
+    }
+  }
+  return reach + 1;
+}
+
+/**
+ * @brief Chooses the turns and the column for the falling tetromino
+ * @param[in] *bot Unused
+ * @param[in] *view Game
+ * @param[out] *decision Placement
+ * @return Returns 0 on success, 1 if the tetromino fits nowhere
+ */
+static int decide(void *bot, const BotView_t *view, BotDecision_t *decision) {
+  (void)bot;
+  if (view->width > MAX_WIDTH || view->height > MAX_HEIGHT) return 1;
+  int32_t shapes[4][16];
+  for (int k = 0; k < 16; k++) shapes[0][k] = view->piece[k] != 0;
+  int box = box_size(shapes[0]), turns = box == 2 ? 1 : 4;
+  int found = 0, best_turns = 0, best_x = 0, best_cost = 0;
+  for (int t = 0; t < turns; t++) {
+    if (t > 0) {
+      for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++)
+          shapes[t][i * 4 + j] =
+              i < box && j < box && shapes[t - 1][j * 4 + box - 1 - i];
+      }
+      if (collides(view, shapes[t], *view->x, *view->y)) break;
+    }
+    for (int x = -3; x < view->width; x++) {
+      int y = *view->y;
+      if (collides(view, shapes[t], x, y) ||
+          !reachable(view, shapes[t], x))
+        continue;
+      while (!collides(view, shapes[t], x, y + 1)) y++;
+      int c = cost(view, shapes[t], x, y);
+      if (!found || c < best_cost) best_turns = t, best_x = x, best_cost = c;
+      found = 1;
+    }
+  }
+  if (!found) return 1;
+  decision->kind = BOT_DECIDE_PLACEMENT;
+  decision->turns = best_turns;
+  decision->x = best_x;
+  return 0;
+}
+
+/// Entry points of the controller
+static const BotPlugin_t plugin = {
+    BOT_PLUGIN_ABI, sizeof(BotPlugin_t), "lowest-column", NULL, decide, NULL};
+
+/**
+ * @brief Entry point the game looks up
+ * @return Returns the controller
+ */
+const BotPlugin_t *bot_plugin(void) { return &plugin; }
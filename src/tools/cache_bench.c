@@ -0,0 +1,134 @@
+/**
+ * @file cache_bench.c
+ * @brief Greedy bot games on all cores with and without a placement cache
+ *
+ * Plays the same seeded games three times: searching every placement, then
+ * through a cache shared by all threads, starting empty, then again with
+ * the cache already filled. Reports the speed and the mean score of every
+ * run, as the cache keys by the surface alone and may pick a placement the
+ * search would not, and the hit rate and occupancy of the cache.
+ *
+ * Usage: cache_bench.out [games] [threads] [pieces] [bits]
+ */
+
+#include "../tetris/bot.h"
+
+/**
+ * @brief Run shared by the threads
+ */
+typedef struct {
+  /// @brief Number of games
+  int games;
+  /// @brief Piece limit of a game
+  int pieces;
+  /// @brief Number of the next game nobody has taken yet
+  int next;
+  /// @brief Cache, NULL to search every placement
+  PlaceCache_t *cache;
+  /// @brief Tetrominos placed in all games
+  long placed;
+  /// @brief Score of all games
+  long score;
+} Run_t;
+
+/**
+ * @brief Thread playing games until none are left
+ * @param[in] *arg Run
+ * @return NULL
+ */
+static void *play(void *arg) {
+  Run_t *run = arg;
+  GameInfo_t game;
+  Placement_t move;
+  long placed = 0, score = 0;
+  int g;
+  while ((g = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) <
+         run->games) {
+    FSM_STATES_g state = SPAWN;
+    bind_game_state(&game);
+    stats_init(&game);
+    stats_seed(&game, g + 1);
+    userInput(&state, 0);
+    for (int p = 0; state == MOVING && p < run->pieces; p++, placed++) {
+      int stuck = run->cache != NULL
+                      ? bot_greedy_cached(run->cache, &game, &move)
+                      : bot_greedy(&game, &move);
+      if (stuck) break;
+      bot_execute(&state, &move);
+    }
+    score += game.score;
+    bind_game_state(NULL);
+  }
+  __atomic_fetch_add(&run->placed, placed, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&run->score, score, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+/**
+ * @brief Plays all games on a number of threads and prints the result
+ * @param[in] *run Run
+ * @param[in] threads Number of threads
+ * @param[in] *name Name of the run
+ */
+static void play_all(Run_t *run, int threads, const char *name) {
+  pthread_t workers[64];
+  if (threads > 64) threads = 64;
+  run->next = 0;
+  run->placed = 0;
+  run->score = 0;
+  long start = get_time_us();
+  int started = 0;
+  while (started < threads &&
+         pthread_create(&workers[started], NULL, play, run) == 0)
+    started++;
+  if (started == 0) play(run);
+  for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+  double seconds = (get_time_us() - start) / 1e6;
+  printf("%-8s %10.0f pieces/s, mean score %.1f, %.1f pieces/game\n", name,
+         run->placed / seconds, (double)run->score / run->games,
+         (double)run->placed / run->games);
+}
+
+/**
+ * @brief Prints the counters of the cache gathered since the last call
+ * @param[in] *cache Cache
+ * @param[in,out] *last Counters at the last call
+ */
+static void print_stats(PlaceCache_t *cache, PlaceCacheStats_t *last) {
+  PlaceCacheStats_t now;
+  place_cache_stats(cache, &now);
+  long lookups = now.lookups - last->lookups;
+  long hits = now.hits - last->hits;
+  printf("         hit rate %.1f%% (%ld of %ld), %ld stale, %ld evictions, "
+         "%ld of %ld entries used\n",
+         lookups > 0 ? hits * 100.0 / lookups : 0.0, hits, lookups,
+         now.stale - last->stale, now.evictions - last->evictions, now.used,
+         now.capacity);
+  *last = now;
+}
+
+int main(int argc, char *argv[]) {
+  Run_t run = {0};
+  run.games = argc > 1 ? atoi(argv[1]) : 64;
+  int threads = argc > 2 ? atoi(argv[2]) : 4;
+  run.pieces = argc > 3 ? atoi(argv[3]) : 500;
+  int bits = argc > 4 ? atoi(argv[4]) : 18;
+  PlaceCache_t *cache = place_cache_create(bits);
+  if (run.games <= 0 || threads <= 0 || run.pieces <= 0 || cache == NULL) {
+    fprintf(stderr, "usage: %s [games] [threads] [pieces] [bits]\n",
+            argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  printf("%d games, %d threads, %d pieces at most, %d cache entries\n",
+         run.games, threads, run.pieces, PLACE_CACHE_WAYS << bits);
+  PlaceCacheStats_t last = {0};
+  play_all(&run, threads, "search");
+  run.cache = cache;
+  play_all(&run, threads, "cold");
+  print_stats(cache, &last);
+  play_all(&run, threads, "warm");
+  print_stats(cache, &last);
+  place_cache_free(cache);
+  return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file dataset_gen.c
+ * @brief Greedy bot games on all cores exported as a placement dataset
+ *
+ * Plays the same seeded games twice, first without and then with the
+ * export, to show what the export costs, then maps the file and reads
+ * samples at random. Every game has a piece limit and is numbered by its
+ * seed, so the dataset does not depend on the number of threads, only the
+ * order of the chunks does.
+ *
+ * Usage: dataset_gen.out [path] [games] [threads] [pieces]
+ */
+
+#include "../tetris/bot.h"
+#include "../tetris/dataset.h"
+
+/// Random samples read back
+#define READ_SAMPLES 1000000
+
+/**
+ * @brief Run shared by the threads
+ */
+typedef struct {
+  /// @brief Number of games
+  int games;
+  /// @brief Piece limit of a game
+  int pieces;
+  /// @brief Number of the next game nobody has taken yet
+  int next;
+  /// @brief File the samples go to, NULL to play without exporting
+  DatasetWriter_t *writer;
+  /// @brief Tetrominos placed in all games
+  long placed;
+  /// @brief Set if a stream failed
+  int failed;
+} Run_t;
+
+/**
+ * @brief Thread playing games until none are left
+ * @param[in] *arg Run
+ * @return NULL
+ */
+static void *play(void *arg) {
+  Run_t *run = arg;
+  DatasetStream_t *stream =
+      run->writer != NULL ? dataset_stream(run->writer) : NULL;
+  if (stream != NULL) set_lock_hook(dataset_lock_hook, stream);
+  GameInfo_t game;
+  Placement_t move;
+  long placed = 0;
+  int g;
+  while ((g = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) <
+         run->games) {
+    FSM_STATES_g state = SPAWN;
+    bind_game_state(&game);
+    stats_init(&game);
+    stats_seed(&game, g + 1);
+    if (stream != NULL) stream->game = g;
+    userInput(&state, 0);
+    for (int p = 0; state == MOVING && p < run->pieces; p++, placed++) {
+      if (bot_greedy(&game, &move)) break;
+      bot_execute(&state, &move);
+    }
+    bind_game_state(NULL);
+  }
+  set_lock_hook(NULL, NULL);
+  if (run->writer != NULL && (stream == NULL || dataset_stream_close(stream)))
+    __atomic_store_n(&run->failed, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&run->placed, placed, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+/**
+ * @brief Plays all games on a number of threads
+ * @param[in] *run Run
+ * @param[in] threads Number of threads
+ * @return Returns the time taken, s
+ */
+static double play_all(Run_t *run, int threads) {
+  pthread_t workers[64];
+  if (threads > 64) threads = 64;
+  run->next = 0;
+  run->placed = 0;
+  long start = get_time_us();
+  int started = 0;
+  while (started < threads &&
+         pthread_create(&workers[started], NULL, play, run) == 0)
+    started++;
+  if (started == 0) play(run);
+  for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+  return (get_time_us() - start) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = argc > 1 ? argv[1] : "dataset.bin";
+  Run_t run = {0};
+  run.games = argc > 2 ? atoi(argv[2]) : 64;
+  int threads = argc > 3 ? atoi(argv[3]) : 4;
+  run.pieces = argc > 4 ? atoi(argv[4]) : 500;
+  if (run.games <= 0 || threads <= 0 || run.pieces <= 0) {
+    fprintf(stderr, "usage: %s [path] [games] [threads] [pieces]\n",
+            argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  double plain = play_all(&run, threads);
+  run.writer = dataset_create(path);
+  if (run.writer == NULL) {
+    fprintf(stderr, "%s: cannot create\n", path);
+    return 1;
+  }
+  double exported = play_all(&run, threads);
+  if (dataset_close(run.writer) || run.failed) {
+    fprintf(stderr, "%s: write failed\n", path);
+    return 1;
+  }
+  printf("%d games, %ld samples, %d threads\n", run.games, run.placed,
+         threads);
+  printf("play only: %.0f samples/s, with export: %.0f samples/s (%+.1f%%)\n",
+         run.placed / plain, run.placed / exported,
+         (plain / exported - 1) * 100);
+
+  DatasetView_t view;
+  if (run.placed == 0) return 0;
+  if (dataset_open(path, &view)) {
+    fprintf(stderr, "%s: not a complete dataset\n", path);
+    return 1;
+  }
+  printf("%s: %lu samples in %lu chunks, %.1f bytes/sample\n", path,
+         (unsigned long)view.header->sample_count,
+         (unsigned long)view.header->chunk_count,
+         (double)view.size / view.header->sample_count);
+  DatasetSample_t sample;
+  unsigned int seed = 1;
+  long reward = 0;
+  long start = get_time_us();
+  for (int i = 0; i < READ_SAMPLES; i++) {
+    uint64_t k = ((uint64_t)rand_r(&seed) << 31 | rand_r(&seed)) %
+                 view.header->sample_count;
+    dataset_sample(&view, k, &sample);
+    reward += sample.reward;
+  }
+  double seconds = (get_time_us() - start) / 1e6;
+  printf("random reads: %.0f samples/s (mean reward %.1f)\n",
+         READ_SAMPLES / seconds, (double)reward / READ_SAMPLES);
+  dataset_unmap(&view);
+  return 0;
+}
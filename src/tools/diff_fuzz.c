@@ -0,0 +1,125 @@
+/**
+ * @file diff_fuzz.c
+ * @brief Differential fuzzing of an optimized engine against tetris.c on
+ * all cores
+ *
+ * Every thread plays cases on its own engine instance and reference game
+ * until the time is up: every fourth case is a case of the corpus with a
+ * few signals changed, the others are random. The first case that diverges
+ * is shrunk and printed, ready to be pasted into a test.
+ *
+ * Usage: diff_fuzz.out [seconds] [threads] [steps] [batch|packed]
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "../tetris/difftest.h"
+
+/// Cases of the corpus at most
+#define FUZZ_CORPUS 32
+/// Signals changed in a corpus case
+#define FUZZ_MUTATIONS 8
+
+/**
+ * @brief Run shared by the threads
+ */
+typedef struct {
+  /// @brief Engine under test
+  const DiffEngine_t *engine;
+  /// @brief Seed corpus
+  DiffCase_t corpus[FUZZ_CORPUS];
+  /// @brief Number of cases in the corpus
+  int corpus_size;
+  /// @brief Signals of a random case
+  int steps;
+  /// @brief Time to stop at, us
+  long deadline;
+  /// @brief Cases played
+  long cases;
+  /// @brief Steps played
+  long played;
+  /// @brief Set once a thread found a divergence
+  int found;
+  /// @brief Shrunk divergence
+  DiffCase_t failure;
+  /// @brief Where it diverges
+  DiffReport_t report;
+} Run_t;
+
+/**
+ * @brief Thread playing cases until the time is up or a case diverges
+ * @param[in] *arg Run
+ * @return NULL
+ */
+static void *fuzz(void *arg) {
+  Run_t *run = arg;
+  static __thread DiffCase_t test;
+  DiffReport_t report;
+  unsigned int rng = (unsigned int)(uintptr_t)&test ^ get_time_us();
+  void *instance = run->engine->create();
+  long cases = 0, played = 0;
+  while (instance != NULL && get_time_us() < run->deadline &&
+         !__atomic_load_n(&run->found, __ATOMIC_RELAXED)) {
+    if (cases % 4 == 0) {
+      test = run->corpus[cases / 4 % run->corpus_size];
+      for (int i = 0; i < FUZZ_MUTATIONS; i++)
+        test.sigs[rand_r(&rng) % test.len] = rand_r(&rng) % 2 ? Left : Action;
+    } else {
+      diff_random(&test, &rng, run->steps);
+    }
+    int diverged = diff_run(run->engine, instance, &test, &report);
+    cases++;
+    played += report.played;
+    if (diverged && !__atomic_exchange_n(&run->found, 1, __ATOMIC_ACQ_REL)) {
+      diff_shrink(run->engine, instance, &test, &report);
+      run->failure = test;
+      run->report = report;
+    }
+  }
+  if (instance != NULL) run->engine->destroy(instance);
+  __atomic_fetch_add(&run->cases, cases, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&run->played, played, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  static Run_t run;
+  int seconds = argc > 1 ? atoi(argv[1]) : 10;
+  int threads = argc > 2 ? atoi(argv[2]) : 4;
+  run.steps = argc > 3 ? atoi(argv[3]) : 1000;
+  const char *name = argc > 4 ? argv[4] : "batch";
+  run.engine = strcmp(name, "packed") == 0  ? &diff_packed_engine
+               : strcmp(name, "batch") == 0 ? &diff_batch_engine
+                                            : NULL;
+  if (seconds <= 0 || threads <= 0 || run.steps <= 0 ||
+      run.steps > DIFF_MAX_STEPS || run.engine == NULL) {
+    fprintf(stderr, "usage: %s [seconds] [threads] [steps] [batch|packed]\n",
+            argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  run.corpus_size = diff_corpus(run.corpus, FUZZ_CORPUS);
+  printf("%s against tetris.c: %d s, %d threads, %d steps a case, %d "
+         "corpus cases\n",
+         run.engine->name, seconds, threads, run.steps, run.corpus_size);
+  pthread_t workers[64];
+  if (threads > 64) threads = 64;
+  long start = get_time_us();
+  run.deadline = start + seconds * 1000000L;
+  int started = 0;
+  while (started < threads &&
+         pthread_create(&workers[started], NULL, fuzz, &run) == 0)
+    started++;
+  if (started == 0) fuzz(&run);
+  for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+  double elapsed = (get_time_us() - start) / 1e6;
+  printf("%ld cases, %.0f cases/min, %.0f steps/s\n", run.cases,
+         run.cases * 60 / elapsed, run.played / elapsed);
+  if (!run.found) {
+    printf("no divergence\n");
+    return 0;
+  }
+  diff_print(run.engine, &run.failure, &run.report, stdout);
+  return 1;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file fsm_bench.c
+ * @brief Cost of the table-driven state machine against the switch it
+ * replaced
+ *
+ * Feeds the same seeded signal stream to userInput() and to a copy of the
+ * switch it used to be, built on the same public functions, and checks
+ * both end in the same game. Then measures the dispatch alone, signals the
+ * falling tetromino does not expect, and userInput() with the states timed.
+ * Prints the counters of the timed run.
+ *
+ * Usage: fsm_bench.out [signals] [seed]
+ */
+
+#include <string.h>
+
+#include "../tetris/tetris.h"
+
+/// Signals of the dispatch-only run
+#define BENCH_IDLE 10000000
+
+/// Names of the states, as FSM_STATES_g orders them
+static const char *const state_names[EXIT_STATE + 1] = {
+    "start", "spawn", "moving", "pause", "attaching", "game over", "exit"};
+
+/**
+ * @brief Game pause as the switch handled it
+ * @param[in] *state Current game state
+ * @param[in] sig Human-readable signal from user
+ */
+static void legacy_pause(FSM_STATES_g *state, UserAction_t sig) {
+  GameInfo_t *stats = updateCurrentState();
+  stats->pause += 1;
+  if (sig == Terminate) {
+    *state = EXIT_STATE;
+  } else if (sig == Pause && stats->pause > 1) {
+    *state = MOVING;
+    stats->pause = 0;
+  }
+}
+
+/**
+ * @brief Moving state as the switch handled it
+ * @param[in] *state Current game state
+ * @param[in] sig Human-readable signal from user
+ */
+static void legacy_moving(FSM_STATES_g *state, UserAction_t sig) {
+  if (sig == Action || sig == Left || sig == Right || sig == Down)
+    updateCurrentState()->counters.actions++;
+  switch (sig) {
+    case Action:
+      rotate();
+      break;
+    case Left:
+      move_left();
+      break;
+    case Right:
+      move_right();
+      break;
+    case Down:
+      move_down(state);
+      break;
+    case Terminate:
+      *state = EXIT_STATE;
+      break;
+    case Pause:
+      *state = PAUSE;
+      legacy_pause(state, sig);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief userInput() as the switch it used to be
+ * @param[in] *state Current game state
+ * @param[in] sig Human-readable signal from user
+ */
+static void legacy_input(FSM_STATES_g *state, UserAction_t sig) {
+  switch (*state) {
+    case START:
+      if (sig == Start)
+        *state = SPAWN;
+      else if (sig == Terminate)
+        *state = EXIT_STATE;
+      break;
+    case SPAWN:
+      spawn_state(state);
+      break;
+    case MOVING:
+      legacy_moving(state, sig);
+      break;
+    case ATTACHING:
+      attaching_state();
+      *state = SPAWN;
+      break;
+    case GAME_OVER:
+      if (sig == Start) {
+        stats_init(updateCurrentState());
+        *state = SPAWN;
+      } else if (sig == Terminate) {
+        *state = EXIT_STATE;
+      }
+      save_score();
+      break;
+    case PAUSE:
+      legacy_pause(state, sig);
+      break;
+    case EXIT_STATE:
+      break;
+  }
+}
+
+/**
+ * @brief Fills the signal stream: mostly moves and turns, with pauses and
+ * idle ticks, Start once the game is over, never Terminate
+ * @param[out] *signals Signals
+ * @param[in] count Number of signals
+ * @param[in] seed Seed of the stream
+ */
+static void make_stream(UserAction_t *signals, long count, unsigned seed) {
+  static const UserAction_t mix[16] = {Left,   Right, Left,  Right, Down, Down,
+                                       Down,   Down,  Down,  Down,  Action,
+                                       Action, 0,     0,     Pause, Start};
+  for (long i = 0; i < count; i++) signals[i] = mix[rand_r(&seed) % 16];
+}
+
+/**
+ * @brief Plays the stream through a dispatcher on a fresh seeded game
+ * @param[in] input Dispatcher
+ * @param[in] *signals Signals
+ * @param[in] count Number of signals
+ * @param[in] seed Seed of the game and of the ones Start begins after it
+ * @param[out] *game Game after the stream
+ * @return Returns the time taken, us
+ */
+static long play(void (*input)(FSM_STATES_g *, UserAction_t),
+                 const UserAction_t *signals, long count, unsigned seed,
+                 GameInfo_t *game) {
+  FSM_STATES_g state = SPAWN;
+  bind_game_state(game);
+  srand(seed);
+  stats_init(game);
+  stats_seed(game, seed);
+  long start = get_time_us();
+  for (long i = 0; i < count; i++) input(&state, signals[i]);
+  long us = get_time_us() - start;
+  bind_game_state(NULL);
+  return us;
+}
+
+/**
+ * @brief Gives a tetromino that is falling signals it does not expect
+ * @param[in] input Dispatcher
+ * @param[in] *game Game to use
+ * @return Returns the time taken per signal, ns
+ */
+static double idle(void (*input)(FSM_STATES_g *, UserAction_t),
+                   GameInfo_t *game) {
+  FSM_STATES_g state = SPAWN;
+  bind_game_state(game);
+  stats_init(game);
+  input(&state, 0);
+  long start = get_time_us();
+  for (long i = 0; i < BENCH_IDLE; i++) input(&state, Up);
+  double ns = (get_time_us() - start) * 1e3 / BENCH_IDLE;
+  bind_game_state(NULL);
+  return ns;
+}
+
+int main(int argc, char *argv[]) {
+  long count = argc > 1 ? atol(argv[1]) : 20000000;
+  unsigned seed = argc > 2 ? (unsigned)atol(argv[2]) : 1;
+  UserAction_t *signals = count > 0 ? malloc(count * sizeof(*signals)) : NULL;
+  if (signals == NULL) {
+    fprintf(stderr, "usage: %s [signals] [seed]\n", argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  make_stream(signals, count, seed);
+  static GameInfo_t legacy, table, timed;
+  long legacy_us = play(legacy_input, signals, count, seed, &legacy);
+  fsm_stats_reset(0);
+  long table_us = play(userInput, signals, count, seed, &table);
+  fsm_stats_reset(1);
+  long timed_us = play(userInput, signals, count, seed, &timed);
+  FsmStats_t stats;
+  fsm_stats(&stats);
+  int same = memcmp(legacy.field, table.field, sizeof(legacy.field)) == 0 &&
+             legacy.score == table.score && table.score == timed.score &&
+             legacy.counters.pieces == table.counters.pieces;
+  printf("%ld signals, last score %d, %s\n", count, table.score,
+         same ? "same game" : "GAMES DIFFER");
+  printf("switch: %.1f ns per signal\n", legacy_us * 1e3 / count);
+  printf("table:  %.1f ns per signal\n", table_us * 1e3 / count);
+  printf("timed:  %.1f ns per signal\n", timed_us * 1e3 / count);
+  printf("idle:   switch %.1f ns, table %.1f ns per unexpected signal\n",
+         idle(legacy_input, &legacy), idle(userInput, &table));
+
+  printf("%-10s %12s %12s %12s\n", "state", "entries", "ms", "unexpected");
+  for (int s = 0; s <= EXIT_STATE; s++)
+    printf("%-10s %12ld %12.1f %12ld\n", state_names[s], stats.entries[s],
+           stats.time_ns[s] / 1e6, stats.unexpected[s]);
+  free(signals);
+  return same ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file journal_recover.c
+ * @brief Rebuilds a game from the session log of a crashed run
+ *
+ * Prints what was found in the log and, if a game could be rebuilt, writes
+ * it to the save file, so the next launch resumes it from a pause. The game
+ * itself recovers from the log on launch too, the tool is for looking into a
+ * log and for recovering it by hand.
+ *
+ * Usage: journal_recover.out [log] [save]
+ */
+
+#include "../tetris/journal.h"
+
+int main(int argc, char *argv[]) {
+  const char *path = argc > 1 ? argv[1] : "session.log";
+  const char *save = argc > 2 ? argv[2] : "suspended";
+  GameInfo_t game;
+  FSM_STATES_g state;
+  JournalReport_t report;
+  set_score_file(NULL);
+  int result = journal_recover(path, &game, &state, &report);
+  if (result == 1 && report.records == 0) {
+    fprintf(stderr, "%s: not a session log\n", path);
+    return 1;
+  }
+  printf("%s: %s, %u valid records, last %u\n", path,
+         report.clean ? "closed" : "not closed", report.records, report.last);
+  if (report.snapshot == 0) {
+    printf("no snapshot to start from\n");
+    return 1;
+  }
+  printf("snapshot %u, %u records replayed, %u attachings verified, "
+         "%u dropped\n",
+         report.snapshot, report.replayed, report.verified, report.dropped);
+  if (result == 2) {
+    printf("the game had ended, nothing to resume\n");
+    return 0;
+  }
+  if (result == 3) {
+    printf("the session ended normally, nothing to resume\n");
+    return 0;
+  }
+  printf("score %d, level %d, %d tetrominos\n", game.score, game.level,
+         game.counters.pieces);
+  if (save_game(save, &game)) {
+    fprintf(stderr, "%s: cannot write\n", save);
+    return 1;
+  }
+  printf("saved to %s\n", save);
+  return 0;
+}
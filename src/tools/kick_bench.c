@@ -0,0 +1,143 @@
+/**
+ * @file kick_bench.c
+ * @brief Cost of SRS turns with kicks on random fields
+ *
+ * Turns every tetromino from every rotation at every position of seeded
+ * random fields, with board_kick() and with the same kicks tested row by row
+ * through board_collides(), checks both pick the same kick, and reports the
+ * time a turn takes either way and how the turns ended: in place, kicked or
+ * blocked. Then runs the move generator from the spawn position on the same
+ * fields and reports the placements it finds.
+ *
+ * Usage: kick_bench.out [fields] [seed]
+ */
+
+#include "../tetris/movegen.h"
+
+/// Times every field is turned on
+#define BENCH_REPEAT 20
+
+/**
+ * @brief Fills a field with ragged columns with holes
+ * @param[out] *rows Field rows
+ * @param[in,out] *seed State of the generator
+ */
+static void random_field(uint16_t *rows, unsigned *seed) {
+  for (int r = 0; r < BOARD_HEIGHT; r++) rows[r] = BOARD_EMPTY_ROW;
+  for (int x = 0; x < BOARD_WIDTH; x++) {
+    int height = rand_r(seed) % 14;
+    for (int r = BOARD_HEIGHT - height; r < BOARD_HEIGHT; r++) {
+      if (rand_r(seed) % 5 != 0) rows[r] |= 1 << (x + BOARD_SHIFT);
+    }
+  }
+}
+
+/**
+ * @brief Finds the kick a tetromino turns with by testing it row by row
+ * @param[in] *rows Field rows
+ * @param[in] type Tetromino type
+ * @param[in] rot Rotation before the turn
+ * @param[in] x Column of mask bit 0
+ * @param[in] row Field row of mask row 0
+ * @return Returns the index of the first kick that fits, -1 if none does
+ */
+static int naive_kick(const uint16_t *rows, int type, int rot, int x,
+                      int row) {
+  const uint8_t *mask = piece_masks[type][(rot + 1) & 3];
+  for (int k = 0; k < BOARD_KICKS; k++) {
+    const BoardKick_t *kick = &board_kicks[type][rot][k];
+    if (!board_collides(rows, mask, x + kick->x, row + kick->y)) return k;
+  }
+  return -1;
+}
+
+/**
+ * @brief Turns every tetromino at every position of a field
+ * @param[in] *rows Field rows
+ * @param[in] kick Function finding the kick
+ * @param[in,out] *ends Turns that took every kick, blocked ones last, NULL
+ * not to count them
+ * @param[in,out] *mismatches Turns board_kick() and naive_kick() disagree
+ * on, NULL not to compare them
+ * @return Returns the sum of the kicks found, to keep the calls
+ */
+static long turn_all(const uint16_t *rows,
+                     int (*kick)(const uint16_t *, int, int, int, int),
+                     long *ends, long *mismatches) {
+  long sum = 0;
+  for (int type = 0; type < RAND; type++) {
+    if (type == PIECE_O) continue;
+    for (int rot = 0; rot < 4; rot++) {
+      for (int x = -BOARD_SHIFT; x < BOARD_WIDTH; x++) {
+        for (int row = -1; row < BOARD_HEIGHT - 1; row++) {
+          int k = kick(rows, type, rot, x, row);
+          if (ends != NULL) ends[k < 0 ? BOARD_KICKS : k]++;
+          if (mismatches != NULL)
+            *mismatches += k != naive_kick(rows, type, rot, x, row);
+          sum += k;
+        }
+      }
+    }
+  }
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  int fields = argc > 1 ? atoi(argv[1]) : 2000;
+  unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+  if (fields <= 0) {
+    fprintf(stderr, "usage: %s [fields] [seed]\n", argv[0]);
+    return 1;
+  }
+  uint16_t(*rows)[BOARD_HEIGHT] = malloc(fields * sizeof(*rows));
+  static MoveGen_t gen;
+  if (rows == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  for (int f = 0; f < fields; f++) random_field(rows[f], &seed);
+
+  long ends[BOARD_KICKS + 1] = {0}, mismatches = 0, turns = 0;
+  for (int f = 0; f < fields; f++)
+    turn_all(rows[f], board_kick, ends, &mismatches);
+  for (int k = 0; k <= BOARD_KICKS; k++) turns += ends[k];
+
+  long sum = 0, start = get_time_us();
+  for (int i = 0; i < BENCH_REPEAT; i++) {
+    for (int f = 0; f < fields; f++)
+      sum += turn_all(rows[f], naive_kick, NULL, NULL);
+  }
+  double naive = (get_time_us() - start) * 1e3 / (turns * BENCH_REPEAT);
+  start = get_time_us();
+  for (int i = 0; i < BENCH_REPEAT; i++) {
+    for (int f = 0; f < fields; f++)
+      sum -= turn_all(rows[f], board_kick, NULL, NULL);
+  }
+  double words = (get_time_us() - start) * 1e3 / (turns * BENCH_REPEAT);
+
+  long placements = 0, states = 0, searches = 0;
+  start = get_time_us();
+  for (int f = 0; f < fields; f++) {
+    for (int type = 0; type < RAND; type++) {
+      if (board_collides(rows[f], piece_masks[type][0], 4, 0)) continue;
+      placements += movegen_run(&gen, rows[f], type, 0, 4, 1);
+      states += gen.states;
+      searches++;
+    }
+  }
+  double search = (get_time_us() - start) / (double)(searches + !searches);
+
+  printf("%ld turns on %d fields, %s\n", turns, fields,
+         mismatches == 0 && sum == 0 ? "same kicks" : "KICKS DIFFER");
+  printf("in place %.1f%%, kicked %.1f%%, blocked %.1f%%\n",
+         100.0 * ends[0] / turns,
+         100.0 * (turns - ends[0] - ends[BOARD_KICKS]) / turns,
+         100.0 * ends[BOARD_KICKS] / turns);
+  printf("row by row: %.1f ns a turn\n", naive);
+  printf("word masks: %.1f ns a turn\n", words);
+  printf("move generator: %.1f placements, %.0f states, %.1f us a search\n",
+         (double)placements / (searches + !searches),
+         (double)states / (searches + !searches), search);
+  free(rows);
+  return mismatches == 0 && sum == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file packed_bench.c
+ * @brief Simulation throughput of many games by the layout of their state
+ *
+ * Steps the same number of games, round after round, each game getting one
+ * random signal a round, kept three ways: GameInfo_t games stepped through
+ * userInput() as difftest.h defines a step, PackedGame_t games in one
+ * array, and the structure of arrays of the batch engine. A game that is
+ * over restarts. Reports the state size of a game and the steps per second
+ * for every number of games, from a set that fits in L1 to one far past L2.
+ *
+ * Usage: packed_bench.out [steps a run]
+ */
+
+#include "../tetris/batch.h"
+#include "../tetris/packed.h"
+
+/// Signals the games are given
+static const UserAction_t choice[] = {0, Left, Right, Down, Action};
+
+/**
+ * @brief Fills the signals of one round
+ * @param[out] *actions Signal for every game
+ * @param[in] games Number of games
+ * @param[in,out] *seed State of the signal generator
+ */
+static void round_signals(UserAction_t *actions, int games, unsigned *seed) {
+  for (int g = 0; g < games; g++) actions[g] = choice[rand_r(seed) % 5];
+}
+
+/**
+ * @brief Steps GameInfo_t games through the state machine
+ * @param[in] games Number of games
+ * @param[in] rounds Number of rounds
+ * @param[in] *actions Buffer of one round of signals
+ * @return Returns the time taken, us, -1 if out of memory
+ */
+static long run_classic(int games, int rounds, UserAction_t *actions) {
+  GameInfo_t *stats = malloc(games * sizeof(GameInfo_t));
+  FSM_STATES_g *states = malloc(games * sizeof(FSM_STATES_g));
+  if (stats == NULL || states == NULL) {
+    free(stats);
+    free(states);
+    return -1;
+  }
+  for (int g = 0; g < games; g++) {
+    bind_game_state(&stats[g]);
+    stats_init(&stats[g]);
+    stats_seed(&stats[g], g + 1);
+    states[g] = SPAWN;
+    userInput(&states[g], 0);
+  }
+  unsigned seed = 1;
+  long start = get_time_us();
+  for (int r = 0; r < rounds; r++) {
+    round_signals(actions, games, &seed);
+    for (int g = 0; g < games; g++) {
+      FSM_STATES_g *state = &states[g];
+      bind_game_state(&stats[g]);
+      userInput(state, actions[g]);
+      if (*state == MOVING) move_down(state);
+      if (*state == ATTACHING) {
+        userInput(state, 0);
+        userInput(state, 0);
+      }
+      if (*state == GAME_OVER) {
+        stats_init(&stats[g]);
+        stats_seed(&stats[g], rand_r(&seed));
+        *state = SPAWN;
+        userInput(state, 0);
+      }
+    }
+  }
+  long us = get_time_us() - start;
+  bind_game_state(NULL);
+  free(stats);
+  free(states);
+  return us;
+}
+
+/**
+ * @brief Steps packed games
+ * @param[in] games Number of games
+ * @param[in] rounds Number of rounds
+ * @param[in] *actions Buffer of one round of signals
+ * @return Returns the time taken, us, -1 if out of memory
+ */
+static long run_packed(int games, int rounds, UserAction_t *actions) {
+  PackedGame_t *packed = aligned_alloc(64, games * sizeof(PackedGame_t));
+  if (packed == NULL) return -1;
+  for (int g = 0; g < games; g++) packed_reset(&packed[g], g + 1);
+  unsigned seed = 1;
+  int reward;
+  long start = get_time_us();
+  for (int r = 0; r < rounds; r++) {
+    round_signals(actions, games, &seed);
+    for (int g = 0; g < games; g++) {
+      if (packed_step(&packed[g], actions[g], &reward))
+        packed_reset(&packed[g], rand_r(&seed));
+    }
+  }
+  long us = get_time_us() - start;
+  free(packed);
+  return us;
+}
+
+/**
+ * @brief Steps the games of a batch
+ * @param[in] games Number of games
+ * @param[in] rounds Number of rounds
+ * @param[in] *actions Buffer of one round of signals
+ * @return Returns the time taken, us, -1 if out of memory
+ */
+static long run_batch(int games, int rounds, UserAction_t *actions) {
+  TetrisBatch_t *batch = batch_create(games, 1);
+  int *rewards = malloc(games * sizeof(int));
+  int *dones = malloc(games * sizeof(int));
+  long us = -1;
+  if (batch != NULL && rewards != NULL && dones != NULL) {
+    unsigned seed = 1;
+    long start = get_time_us();
+    for (int r = 0; r < rounds; r++) {
+      round_signals(actions, games, &seed);
+      tetris_batch_step(batch, actions, rewards, dones);
+    }
+    us = get_time_us() - start;
+  }
+  batch_free(batch);
+  free(rewards);
+  free(dones);
+  return us;
+}
+
+int main(int argc, char *argv[]) {
+  long steps = argc > 1 ? atol(argv[1]) : 8000000;
+  static const int sizes[] = {16, 256, 4096, 65536};
+  UserAction_t *actions = malloc(65536 * sizeof(UserAction_t));
+  if (steps <= 0 || actions == NULL) {
+    fprintf(stderr, "usage: %s [steps a run]\n", argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  printf("state of a game: GameInfo_t %zu bytes, PackedGame_t %zu bytes\n",
+         sizeof(GameInfo_t), sizeof(PackedGame_t));
+  printf("%8s %12s %12s %12s  (Msteps/s)\n", "games", "GameInfo_t",
+         "packed", "batch");
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(*sizes)); i++) {
+    int games = sizes[i];
+    int rounds = steps / games > 0 ? steps / games : 1;
+    double total = (double)games * rounds;
+    long classic = run_classic(games, rounds, actions);
+    long packed = run_packed(games, rounds, actions);
+    long batch = run_batch(games, rounds, actions);
+    if (classic < 0 || packed < 0 || batch < 0) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    printf("%8d %12.1f %12.1f %12.1f\n", games, total / (classic + 1),
+           total / (packed + 1), total / (batch + 1));
+  }
+  free(actions);
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file plugin_bench.c
+ * @brief Games played by a bot controller loaded from a shared object
+ *
+ * Plays seeded games with the controller, every decision going through
+ * plugin_plan() and its signals through the state machine, and reports the
+ * speed, the mean score and the time spent in the controller. Then measures
+ * the cost of the interface alone: plugin_plan() on a controller linked in
+ * that answers at once, called on a live game.
+ *
+ * Usage: plugin_bench.out [controller.so] [games] [pieces]
+ */
+
+#include "../tetris/plugin.h"
+
+/// Calls of the empty controller measured
+#define BENCH_CALLS 1000000
+
+/**
+ * @brief Controller answering at once with no signals
+ * @param[in] *bot Unused
+ * @param[in] *view Unused
+ * @param[out] *decision Empty signal list
+ * @return 0
+ */
+static int empty_decide(void *bot, const BotView_t *view,
+                        BotDecision_t *decision) {
+  (void)bot;
+  (void)view;
+  decision->kind = BOT_DECIDE_SIGNALS;
+  decision->count = 0;
+  return 0;
+}
+
+/// Entry points of the empty controller
+static const BotPlugin_t empty = {BOT_PLUGIN_ABI, sizeof(BotPlugin_t),
+                                  "empty",        NULL,
+                                  empty_decide,   NULL};
+
+int main(int argc, char *argv[]) {
+  const char *path = argc > 1 ? argv[1] : "./bot_plugin_example.so";
+  int games = argc > 2 ? atoi(argv[2]) : 20;
+  int pieces = argc > 3 ? atoi(argv[3]) : 500;
+  GameInfo_t *stats = updateCurrentState();
+  Plugin_t *plugin = plugin_load(path, stats);
+  if (games <= 0 || pieces <= 0 || plugin == NULL) {
+    fprintf(stderr, "usage: %s [controller.so] [games] [pieces]\n", argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  long placed = 0, score = 0, failed = 0;
+  long start = get_time_us();
+  for (int g = 0; g < games; g++) {
+    FSM_STATES_g state = SPAWN;
+    Placement_t plan;
+    stats_init(stats);
+    stats_seed(stats, g + 1);
+    userInput(&state, 0);
+    for (int p = 0; state == MOVING && p < pieces; p++, placed++) {
+      if (plugin_plan(plugin, &plan) != 0) {
+        plan.path_len = 0;
+        failed++;
+      }
+      bot_execute(&state, &plan);
+    }
+    score += stats->score;
+  }
+  double seconds = (get_time_us() - start) / 1e6;
+  printf("%s: %.0f pieces/s, mean score %.1f, %.1f pieces/game, %ld "
+         "refused\n",
+         plugin->api->name, placed / seconds, (double)score / games,
+         (double)placed / games, failed);
+  printf("%s: %.0f ns in decide() per call\n", plugin->api->name,
+         (double)plugin->call_ns / plugin->calls);
+  plugin_free(plugin);
+
+  FSM_STATES_g state = SPAWN;
+  Placement_t plan;
+  stats_init(stats);
+  userInput(&state, 0);
+  plugin = plugin_attach(&empty, stats);
+  start = get_time_us();
+  for (int i = 0; i < BENCH_CALLS; i++) plugin_plan(plugin, &plan);
+  double ns = (get_time_us() - start) * 1e3 / BENCH_CALLS;
+  printf("empty: %.1f ns per plugin_plan(), %.1f ns in decide()\n", ns,
+         (double)plugin->call_ns / plugin->calls);
+  plugin_free(plugin);
+  return 0;
+}
@@ -0,0 +1,475 @@
+/**
+ * @file pty_bench.c
+ * @brief End-to-end keypress-to-paint latency of the game under a
+ * pseudo-terminal
+ *
+ * Runs the game in a pseudo-terminal of 24 by 80 in a scratch directory, so
+ * the score, save and log files of the real game are not touched. Sends a
+ * fixed cycle of arrow, space and down keys on a fixed schedule and feeds
+ * everything the game writes through a small terminal emulator. A key
+ * counts as painted when the field on the emulated screen first differs
+ * from what it was when the key was sent; a key that changes nothing, like
+ * a move into a wall, is reported apart. Gravity also changes the field, so
+ * a drop that lands between a key and its paint is taken for the paint.
+ *
+ * The game's own renderer choice is kept: run with TETRIS_RENDER=ansi to
+ * measure the ANSI renderer. A frame is a read from the terminal after which
+ * the emulated screen changed.
+ *
+ * Usage: pty_bench.out [binary] [keys] [interval_ms]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../tetris/tetris.h"
+
+/// Rows of the emulated terminal
+#define TERM_ROWS 24
+/// Columns of the emulated terminal
+#define TERM_COLS 80
+/// Rows of the field including its borders
+#define FIELD_ROWS 22
+/// Columns of the field including its borders
+#define FIELD_COLS 22
+/// Longest wait for the game to start or quit, us
+#define WAIT_US 3000000
+/// Numeric parameters kept from one control sequence
+#define MAX_PARAMS 8
+
+/**
+ * @brief Emulated terminal screen
+ */
+typedef struct {
+  /// @brief Character in every cell, UTF-8 sequences count as one
+  uint32_t cells[TERM_ROWS][TERM_COLS];
+  /// @brief Cursor row
+  int row;
+  /// @brief Cursor column
+  int col;
+  /// @brief Last character written, for repeats
+  uint32_t last;
+  /// @brief Parser state: 0 text, 1 after ESC, 2 in CSI, 3 charset select
+  int mode;
+  /// @brief Parameters of the control sequence being read
+  int params[MAX_PARAMS];
+  /// @brief Number of parameters, the one being read included
+  int count;
+  /// @brief UTF-8 character being read
+  uint32_t utf8;
+} Term_t;
+
+/**
+ * @brief Game running under a pseudo-terminal
+ */
+typedef struct {
+  /// @brief Master side of the pseudo-terminal
+  int fd;
+  /// @brief Process id of the game
+  pid_t pid;
+  /// @brief Emulated screen
+  Term_t term;
+  /// @brief Screen after the last frame
+  uint32_t frame[TERM_ROWS][TERM_COLS];
+  /// @brief Frames painted
+  long frames;
+  /// @brief Bytes the game wrote
+  long bytes;
+} Pty_t;
+
+/**
+ * @brief Clears the cells of a row from one column up to another
+ * @param[in] *term Terminal
+ * @param[in] row Row
+ * @param[in] from First column
+ * @param[in] to Column after the last
+ */
+static void term_erase(Term_t *term, int row, int from, int to) {
+  if (from < 0) from = 0;
+  if (to > TERM_COLS) to = TERM_COLS;
+  for (int c = from; c < to; c++) term->cells[row][c] = ' ';
+}
+
+/**
+ * @brief Puts a character at the cursor and moves it on
+ * @param[in] *term Terminal
+ * @param[in] ch Character
+ */
+static void term_put(Term_t *term, uint32_t ch) {
+  if (term->col >= TERM_COLS) {
+    term->col = 0;
+    if (term->row < TERM_ROWS - 1) term->row++;
+  }
+  term->cells[term->row][term->col++] = ch;
+  term->last = ch;
+}
+
+/**
+ * @brief Parameter of a control sequence
+ * @param[in] *term Terminal
+ * @param[in] i Number of the parameter
+ * @param[in] fallback Value if it was left out or is 0
+ * @return Returns the value
+ */
+static int term_param(const Term_t *term, int i, int fallback) {
+  return i < term->count && term->params[i] > 0 ? term->params[i] : fallback;
+}
+
+/**
+ * @brief Carries out a control sequence
+ *
+ * Only what ncurses and the ANSI renderer send for this game is carried
+ * out: cursor moves, erasing, repeats, inserting and deleting characters.
+ * Modes and colours are ignored.
+ * @param[in] *term Terminal
+ * @param[in] final Last byte of the sequence
+ */
+static void term_csi(Term_t *term, char final) {
+  int n = term_param(term, 0, 1);
+  switch (final) {
+    case 'H':
+    case 'f':
+      term->row = term_param(term, 0, 1) - 1;
+      term->col = term_param(term, 1, 1) - 1;
+      break;
+    case 'A':
+      term->row -= n;
+      break;
+    case 'B':
+      term->row += n;
+      break;
+    case 'C':
+      term->col += n;
+      break;
+    case 'D':
+      term->col -= n;
+      break;
+    case 'G':
+    case '`':
+      term->col = n - 1;
+      break;
+    case 'd':
+      term->row = n - 1;
+      break;
+    case 'J': {
+      int how = term->count > 0 ? term->params[0] : 0;
+      for (int r = 0; r < TERM_ROWS; r++) {
+        if ((how == 0 && r > term->row) || (how == 1 && r < term->row) ||
+            how >= 2)
+          term_erase(term, r, 0, TERM_COLS);
+      }
+      if (how == 0) term_erase(term, term->row, term->col, TERM_COLS);
+      if (how == 1) term_erase(term, term->row, 0, term->col + 1);
+      break;
+    }
+    case 'K': {
+      int how = term->count > 0 ? term->params[0] : 0;
+      term_erase(term, term->row, how == 0 ? term->col : 0,
+                 how == 1 ? term->col + 1 : TERM_COLS);
+      break;
+    }
+    case 'X':
+      term_erase(term, term->row, term->col, term->col + n);
+      break;
+    case 'b':
+      for (int i = 0; i < n && i < TERM_COLS; i++) term_put(term, term->last);
+      break;
+    case 'P':
+    case '@': {
+      uint32_t *line = term->cells[term->row];
+      if (n > TERM_COLS - term->col) n = TERM_COLS - term->col;
+      int keep = TERM_COLS - term->col - n;
+      if (final == 'P') {
+        memmove(line + term->col, line + term->col + n, keep * sizeof(*line));
+        term_erase(term, term->row, TERM_COLS - n, TERM_COLS);
+      } else {
+        memmove(line + term->col + n, line + term->col, keep * sizeof(*line));
+        term_erase(term, term->row, term->col, term->col + n);
+      }
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Feeds bytes the game wrote through the terminal
+ * @param[in] *term Terminal
+ * @param[in] *data Bytes
+ * @param[in] len Number of bytes
+ */
+static void term_feed(Term_t *term, const char *data, int len) {
+  for (int i = 0; i < len; i++) {
+    unsigned char ch = data[i];
+    if (term->mode == 1) {
+      term->mode = ch == '[' ? 2 : ch == '(' || ch == ')' ? 3 : 0;
+      term->count = 0;
+      memset(term->params, 0, sizeof(term->params));
+    } else if (term->mode == 3) {
+      term->mode = 0;
+    } else if (term->mode == 2) {
+      if (ch >= '0' && ch <= '9') {
+        if (term->count == 0) term->count = 1;
+        int *p = &term->params[term->count - 1];
+        if (*p < 10000) *p = *p * 10 + ch - '0';
+      } else if (ch == ';') {
+        if (term->count == 0) term->count = 1;
+        if (term->count < MAX_PARAMS) term->count++;
+      } else if (ch >= 0x40 && ch <= 0x7E) {
+        term->mode = 0;
+        term_csi(term, ch);
+      }
+    } else if (ch == 0x1B) {
+      term->mode = 1;
+    } else if (ch == '\r') {
+      term->col = 0;
+    } else if (ch == '\n') {
+      if (term->row < TERM_ROWS - 1) term->row++;
+    } else if (ch == '\b') {
+      if (term->col > 0) term->col--;
+    } else if (ch >= 0x80 && ch < 0xC0) {
+      term->utf8 = term->utf8 << 6 | (ch & 0x3F);
+      if (term->col > 0) term->cells[term->row][term->col - 1] = term->utf8;
+    } else if (ch >= 0xC0) {
+      term->utf8 = ch;
+      term_put(term, ch);
+    } else if (ch >= ' ') {
+      term_put(term, ch);
+    }
+    if (term->row < 0) term->row = 0;
+    if (term->row >= TERM_ROWS) term->row = TERM_ROWS - 1;
+    if (term->col < 0) term->col = 0;
+    if (term->col > TERM_COLS) term->col = TERM_COLS;
+  }
+}
+
+/**
+ * @brief Looks for a text anywhere on the screen
+ * @param[in] *term Terminal
+ * @param[in] *text ASCII text
+ * @return Returns 1 if it is on the screen
+ */
+static int term_shows(const Term_t *term, const char *text) {
+  int len = strlen(text);
+  for (int r = 0; r < TERM_ROWS; r++) {
+    for (int c = 0; c + len <= TERM_COLS; c++) {
+      int k = 0;
+      while (k < len && term->cells[r][c + k] == (unsigned char)text[k]) k++;
+      if (k == len) return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Copies the field, borders included, off the screen
+ * @param[in] *term Terminal
+ * @param[out] *field Cells of the field
+ */
+static void term_field(const Term_t *term, uint32_t *field) {
+  for (int r = 0; r < FIELD_ROWS; r++)
+    memcpy(field + r * FIELD_COLS, term->cells[r],
+           FIELD_COLS * sizeof(uint32_t));
+}
+
+/**
+ * @brief Starts the game under a pseudo-terminal in a scratch directory
+ * @param[out] *pty Game
+ * @param[in] *binary Path of the game
+ * @param[in] *dir Scratch directory
+ * @return Returns 0 on success, 1 on an error
+ */
+static int pty_start(Pty_t *pty, const char *binary, const char *dir) {
+  memset(pty, 0, sizeof(Pty_t));
+  for (int r = 0; r < TERM_ROWS; r++) term_erase(&pty->term, r, 0, TERM_COLS);
+  memcpy(pty->frame, pty->term.cells, sizeof(pty->frame));
+  struct winsize size = {TERM_ROWS, TERM_COLS, 0, 0};
+  pty->pid = forkpty(&pty->fd, NULL, NULL, &size);
+  if (pty->pid < 0) return 1;
+  if (pty->pid == 0) {
+    if (getenv("TERM") == NULL) setenv("TERM", "xterm", 1);
+    if (chdir(dir) == 0) execl(binary, binary, (char *)NULL);
+    _exit(127);
+  }
+  return 0;
+}
+
+/**
+ * @brief Reads what the game writes until a moment or until it exits
+ * @param[in] *pty Game
+ * @param[in] until Moment to stop, us
+ * @param[in] *field Field to compare with, NULL not to
+ * @return Returns the moment the field first differed, 0 if it did not,
+ * -1 if the game closed the terminal
+ */
+static long pty_pump(Pty_t *pty, long until, const uint32_t *field) {
+  uint32_t now_field[FIELD_ROWS * FIELD_COLS];
+  char buf[65536];
+  long changed = 0;
+  for (long now = get_time_us(); now < until; now = get_time_us()) {
+    struct pollfd fd = {pty->fd, POLLIN, 0};
+    if (poll(&fd, 1, (until - now + 999) / 1000) <= 0) continue;
+    int len = read(pty->fd, buf, sizeof(buf));
+    if (len <= 0) return len < 0 && errno == EINTR ? changed : -1;
+    long read_us = get_time_us();
+    pty->bytes += len;
+    term_feed(&pty->term, buf, len);
+    if (memcmp(pty->frame, pty->term.cells, sizeof(pty->frame)) != 0) {
+      memcpy(pty->frame, pty->term.cells, sizeof(pty->frame));
+      pty->frames++;
+    }
+    if (field != NULL && changed == 0) {
+      term_field(&pty->term, now_field);
+      if (memcmp(field, now_field, sizeof(now_field)) != 0) changed = read_us;
+    }
+  }
+  return changed;
+}
+
+/**
+ * @brief Waits for a text to appear on the screen
+ * @param[in] *pty Game
+ * @param[in] *text Text
+ * @return Returns the time it took, us, -1 if it did not appear
+ */
+static long pty_wait_for(Pty_t *pty, const char *text) {
+  long start = get_time_us();
+  while (!term_shows(&pty->term, text)) {
+    long now = get_time_us();
+    if (now - start > WAIT_US || pty_pump(pty, now + 1000, NULL) < 0)
+      return -1;
+  }
+  return get_time_us() - start;
+}
+
+/**
+ * @brief Sends the game a key
+ * @param[in] *pty Game
+ * @param[in] *key Bytes of the key
+ */
+static void pty_key(Pty_t *pty, const char *key) {
+  if (write(pty->fd, key, strlen(key)) < 0) return;
+}
+
+/**
+ * @brief Quits the game, killing it if it does not quit in time
+ * @param[in] *pty Game
+ */
+static void pty_stop(Pty_t *pty) {
+  pty_key(pty, "q");
+  long start = get_time_us();
+  int status;
+  while (waitpid(pty->pid, &status, WNOHANG) == 0) {
+    if (get_time_us() - start > WAIT_US) {
+      kill(pty->pid, SIGKILL);
+      waitpid(pty->pid, &status, 0);
+      break;
+    }
+    pty_pump(pty, get_time_us() + 10000, NULL);
+  }
+  close(pty->fd);
+}
+
+/**
+ * @brief Comparison of two latencies for qsort()
+ * @param[in] *a First latency
+ * @param[in] *b Second latency
+ * @return Returns a negative, zero or positive number
+ */
+static int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a, y = *(const long *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Removes the scratch directory and what the game left in it
+ * @param[in] *dir Scratch directory
+ */
+static void remove_scratch(const char *dir) {
+  const char *files[] = {"score", "suspended", "session.log"};
+  char path[PATH_MAX];
+  for (int i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+    remove(path);
+  }
+  rmdir(dir);
+}
+
+int main(int argc, char *argv[]) {
+  const char *binary = argc > 1 ? argv[1] : "BrickGame/tetris.out";
+  int keys = argc > 2 ? atoi(argv[2]) : 200;
+  int interval = argc > 3 ? atoi(argv[3]) : 50;
+  char path[PATH_MAX], dir[] = "/tmp/pty_bench.XXXXXX";
+  if (keys <= 0 || interval <= 0 || realpath(binary, path) == NULL) {
+    fprintf(stderr, "usage: %s [binary] [keys] [interval_ms]\n", argv[0]);
+    return 1;
+  }
+  static const char *cycle[] = {"\x1b[D", "\x1b[C", " ", "\x1b[C",
+                                "\x1b[D", " ",      "\x1b[B"};
+  static Pty_t pty;
+  long *latency = calloc(keys, sizeof(long));
+  if (latency == NULL || mkdtemp(dir) == NULL || pty_start(&pty, path, dir)) {
+    fprintf(stderr, "cannot start %s\n", path);
+    return 1;
+  }
+  long startup = pty_wait_for(&pty, "PRESS ENTER");
+  pty_key(&pty, "\n");
+  if (startup < 0 || pty_wait_for(&pty, "SCORE") < 0) {
+    fprintf(stderr, "%s did not start\n", path);
+    pty_stop(&pty);
+    remove_scratch(dir);
+    return 1;
+  }
+
+  uint32_t field[FIELD_ROWS * FIELD_COLS];
+  int painted = 0, unchanged = 0, restarts = 0;
+  long bytes = pty.bytes, frames = pty.frames;
+  long start = get_time_us();
+  for (int k = 0; k < keys; k++) {
+    long due = start + (long)(k + 1) * interval * 1000;
+    if (term_shows(&pty.term, "GAME OVER")) {
+      pty_key(&pty, "\n");
+      restarts++;
+      if (pty_pump(&pty, due, NULL) < 0) break;
+      continue;
+    }
+    term_field(&pty.term, field);
+    pty_key(&pty, cycle[k % 7]);
+    long sent = get_time_us();
+    long changed = pty_pump(&pty, due, field);
+    if (changed < 0) break;
+    if (changed > 0)
+      latency[painted++] = changed - sent;
+    else
+      unchanged++;
+  }
+  double seconds = (get_time_us() - start) / 1e6;
+  bytes = pty.bytes - bytes;
+  frames = pty.frames - frames;
+  pty_stop(&pty);
+  remove_scratch(dir);
+
+  const char *render = getenv("TETRIS_RENDER");
+  printf("%s (%s): %d keys every %d ms, %d painted, %d without a change, "
+         "%d restarts\n",
+         binary, render != NULL ? render : "ncurses", keys, interval, painted,
+         unchanged, restarts);
+  if (painted > 0) {
+    qsort(latency, painted, sizeof(long), compare_long);
+    printf("keypress to paint: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, "
+           "max %.2f ms\n",
+           latency[painted / 2] / 1e3, latency[painted * 9 / 10] / 1e3,
+           latency[painted * 99 / 100] / 1e3, latency[painted - 1] / 1e3);
+  }
+  printf("startup %.1f ms, %.1f frames/s, %.0f bytes/s, %.1f bytes/frame\n",
+         startup / 1e3, frames / seconds, bytes / seconds,
+         frames > 0 ? (double)bytes / frames : 0.0);
+  free(latency);
+  return 0;
+}
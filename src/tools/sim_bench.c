@@ -0,0 +1,120 @@
+/**
+ * @file sim_bench.c
+ * @brief Throughput of tetris-sim through a pipe
+ *
+ * Starts tetris-sim with its stdin and stdout on pipes, feeds it random
+ * signals from a second thread, a new seeded game every SIM_GAME_STEPS
+ * steps, and reads the frames back. Reports steps per second end to end.
+ *
+ * Usage: sim_bench.out [steps] [path to tetris-sim]
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../tetris/sim.h"
+
+/// Steps of one game
+#define SIM_GAME_STEPS 100
+/// Bytes written at once
+#define SIM_WRITE 16384
+
+/**
+ * @brief Stream fed to the simulator
+ */
+typedef struct {
+  /// @brief Write end of the pipe to its stdin
+  int fd;
+  /// @brief Steps to feed
+  long steps;
+  /// @brief Commands fed, steps and new games
+  long commands;
+} Feed_t;
+
+/**
+ * @brief Thread writing the commands
+ * @param[in] *arg Stream
+ * @return NULL
+ */
+static void *feed(void *arg) {
+  static const uint8_t signals[] = {0, Left, Right, Down, Action, Up};
+  Feed_t *f = arg;
+  static uint8_t buf[SIM_WRITE + 8];
+  unsigned int rng = 1;
+  long games = 0;
+  size_t len = 0;
+  for (long step = 0; step < f->steps; step++) {
+    if (step % SIM_GAME_STEPS == 0) {
+      buf[len++] = SIM_NEW_GAME;
+      for (int b = 0; b < 4; b++) buf[len++] = games >> 8 * b & 0xFF;
+      games++;
+      f->commands++;
+    }
+    buf[len++] = signals[rand_r(&rng) % 6];
+    f->commands++;
+    if (len >= SIM_WRITE || step + 1 == f->steps) {
+      for (size_t done = 0; done < len;) {
+        ssize_t n = write(f->fd, buf + done, len - done);
+        if (n <= 0) return NULL;
+        done += n;
+      }
+      len = 0;
+    }
+  }
+  close(f->fd);
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  static SimFrame_t frames[4096];
+  Feed_t f = {0};
+  f.steps = argc > 1 ? atol(argv[1]) : 20000000;
+  const char *path = argc > 2 ? argv[2] : "./tetris-sim";
+  int to[2], from[2];
+  if (f.steps <= 0 || pipe(to) != 0 || pipe(from) != 0) {
+    fprintf(stderr, "usage: %s [steps] [path to tetris-sim]\n", argv[0]);
+    return 1;
+  }
+  long start = get_time_us();
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(to[0], STDIN_FILENO);
+    dup2(from[1], STDOUT_FILENO);
+    close(to[0]);
+    close(to[1]);
+    close(from[0]);
+    close(from[1]);
+    execl(path, path, (char *)NULL);
+    _exit(127);
+  }
+  close(to[0]);
+  close(from[1]);
+  f.fd = to[1];
+  pthread_t writer;
+  pthread_create(&writer, NULL, feed, &f);
+  long bytes = 0, moving = 0;
+  ssize_t n;
+  size_t have = 0;
+  while ((n = read(from[0], (char *)frames + have, sizeof(frames) - have)) >
+         0) {
+    have += n;
+    size_t whole = have / sizeof(SimFrame_t);
+    for (size_t i = 0; i < whole; i++) moving += frames[i].state == MOVING;
+    bytes += whole * sizeof(SimFrame_t);
+    have -= whole * sizeof(SimFrame_t);
+    memmove(frames, (char *)frames + whole * sizeof(SimFrame_t), have);
+  }
+  pthread_join(writer, NULL);
+  close(from[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  double seconds = (get_time_us() - start) / 1e6;
+  long count = bytes / sizeof(SimFrame_t);
+  printf("%ld commands, %ld frames (%ld moving) in %.2f s: %.0f steps/s, "
+         "%.1f MB/s out\n",
+         f.commands, count, moving, seconds, count / seconds,
+         bytes / seconds / 1e6);
+  return count != f.commands || !WIFEXITED(status) || WEXITSTATUS(status);
+}
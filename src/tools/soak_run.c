@@ -0,0 +1,160 @@
+/**
+ * @file soak_run.c
+ * @brief Headless soak run: greedy bot games back to back, sampled for drift
+ *
+ * Plays games through the same path the kiosk takes: every game ends in
+ * GAME_OVER, the score is saved as main.c does when a game ends, and the
+ * next game starts with Start, so stats_init() reads the score file again.
+ * A game that lasts SOAK_GAME_PIECES tetrominos is ended there, as the
+ * greedy bot rarely loses. The score file is reset to 0 at the start, so the
+ * first game sets a record; after every game the high score read back must
+ * be the best score so far, or the run fails.
+ *
+ * Every interval the resident memory, open descriptors and the percentiles
+ * of the step latency, the time the engine takes to move one tetromino from
+ * spawn to the next spawn, restarts included, are written as one line of a
+ * comma-separated series. The first sample is warm-up; the next SOAK_WINDOW
+ * make the baseline. The run stops and fails as soon as a sample drifts past
+ * the limits below.
+ *
+ * Only the baseline and the newest window are kept, so the run itself does
+ * not grow however long it lasts.
+ *
+ * Usage: soak_run.out [seconds, 0 to run until stopped] [interval] [series]
+ * [score file]
+ */
+
+#include <string.h>
+
+#include "../tetris/bot.h"
+#include "../tetris/soak.h"
+#include "../tetris/telemetry.h"
+
+/// Tetrominos a game is ended after
+#define SOAK_GAME_PIECES 1000
+/// Resident memory growth allowed, KiB
+#define SOAK_RSS_KB 1024
+/// Descriptors allowed to be left open
+#define SOAK_FDS 0
+/// Factor the p99 step latency may rise by
+#define SOAK_LATENCY 2.0
+/// Width of a latency histogram bin, us
+#define SOAK_BIN_US 0.25
+
+/**
+ * @brief Current time with nanoseconds, step latencies being a few us
+ * @return Returns the monotonic time, us
+ */
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Ends the game if it is over or long enough and starts the next one
+ *
+ * The score is saved before Start, as finish_game() in main.c does.
+ * @param[in,out] *state Current game state
+ * @param[in,out] *pieces Tetrominos attached in the game
+ * @param[in,out] *sample Sample counting the games and the records
+ * @return Returns 0 on success, 1 if the high score read back by the next
+ * game is not the best score so far
+ */
+static int restart(FSM_STATES_g *state, int *pieces, SoakSample_t *sample) {
+  if (*state == MOVING && *pieces < SOAK_GAME_PIECES) return 0;
+  GameInfo_t *stats = updateCurrentState();
+  int score = stats->score, high = stats->high_score;
+  *state = GAME_OVER;
+  save_score();
+  userInput(state, Start);
+  userInput(state, 0);
+  *pieces = 0;
+  sample->games++;
+  sample->records += score > high;
+  return stats->high_score != (score > high ? score : high);
+}
+
+int main(int argc, char *argv[]) {
+  long seconds = argc > 1 ? atol(argv[1]) : 60;
+  long interval = argc > 2 ? atol(argv[2]) : 5;
+  const char *series = argc > 3 ? argv[3] : "-";
+  const char *score = argc > 4 ? argv[4] : "soak_score";
+  FILE *out = strcmp(series, "-") == 0 ? stdout : fopen(series, "w");
+  if (seconds < 0 || interval <= 0 || out == NULL) {
+    fprintf(stderr, "usage: %s [seconds] [interval] [series] [score file]\n",
+            argv[0]);
+    return 1;
+  }
+  FILE *fp = fopen(score, "w");
+  if (fp == NULL || fputs("0", fp) == EOF || fclose(fp) != 0) {
+    fprintf(stderr, "%s: cannot write\n", score);
+    return 1;
+  }
+  set_score_file(score);
+  const SoakLimits_t limits = {SOAK_RSS_KB, SOAK_FDS, SOAK_LATENCY};
+  SoakSample_t kept[2 * SOAK_WINDOW], sample = {0};
+  int samples = 0;
+  Histogram_t latency;
+  histogram_init(&latency, 0, SOAK_BIN_US);
+  double slowest = 0;
+  char why[128];
+
+  GameInfo_t *stats = updateCurrentState();
+  FSM_STATES_g state = SPAWN;
+  Placement_t move;
+  int pieces = 0;
+  stats_init(stats);
+  userInput(&state, 0);
+  soak_print_header(out);
+  long start = get_time_us(), next = start + interval * 1000000;
+  for (;;) {
+    if (bot_greedy(stats, &move) != 0) state = GAME_OVER;
+    double t = now_us();
+    if (state == MOVING) {
+      bot_execute(&state, &move);
+      pieces++;
+      sample.pieces++;
+    }
+    if (restart(&state, &pieces, &sample)) {
+      fprintf(stderr, "game %ld: the score file was not saved or read back\n",
+              sample.games);
+      return 1;
+    }
+    t = now_us() - t;
+    histogram_add(&latency, t);
+    if (t > slowest) slowest = t;
+
+    long now = get_time_us();
+    if (now < next) continue;
+    next += interval * 1000000;
+    sample.time_ms = (now - start) / 1000;
+    sample.rss_kb = soak_rss_kb();
+    sample.fds = soak_fd_count();
+    sample.p50_us = histogram_percentile(&latency, 50);
+    sample.p99_us = histogram_percentile(&latency, 99);
+    sample.max_us = slowest;
+    soak_print(&sample, out);
+    histogram_init(&latency, 0, SOAK_BIN_US);
+    slowest = 0;
+    if (samples++ > 0) {
+      int k = samples - 2;
+      if (k >= 2 * SOAK_WINDOW) {
+        memmove(&kept[SOAK_WINDOW], &kept[SOAK_WINDOW + 1],
+                (SOAK_WINDOW - 1) * sizeof(SoakSample_t));
+        k = 2 * SOAK_WINDOW - 1;
+      }
+      kept[k] = sample;
+      if (soak_drift(kept, k + 1, &limits, why, sizeof(why))) {
+        fprintf(stderr, "drift after %ld s: %s\n", sample.time_ms / 1000,
+                why);
+        return 1;
+      }
+    }
+    if (seconds > 0 && now - start >= seconds * 1000000) break;
+  }
+  fprintf(stderr, "%ld pieces, %ld games, %ld records in %ld s, no drift\n",
+          sample.pieces, sample.games, sample.records, sample.time_ms / 1000);
+  if (out != stdout) fclose(out);
+  return 0;
+}
@@ -0,0 +1,219 @@
+/**
+ * @file telemetry_agg.c
+ * @brief Merges telemetry streams into histograms
+ *
+ * Every stream is read in large blocks and summarized on its own, then the
+ * per-stream histograms are merged. Records with a foreign layout and a torn
+ * record at the end of a stream are skipped and counted.
+ *
+ * Usage: telemetry_agg.out stream...
+ *        telemetry_agg.out -g count stream   (appends synthetic records)
+ */
+
+#include <string.h>
+
+#include "../tetris/telemetry.h"
+
+/// Records read from a stream at once
+#define AGG_BLOCK 4096
+
+/**
+ * @brief Everything gathered from one or more streams
+ */
+typedef struct {
+  /// @brief Final scores
+  Histogram_t score;
+  /// @brief Pieces per game
+  Histogram_t pieces;
+  /// @brief Pieces per second
+  Histogram_t pps;
+  /// @brief Actions per minute
+  Histogram_t apm;
+  /// @brief Active time per game, s
+  Histogram_t active;
+  /// @brief Paused time per game, s
+  Histogram_t paused;
+  /// @brief Clears of 1, 2, 3 and 4 rows
+  long clears[4];
+  /// @brief Time in every state, ms
+  long state_ms[EXIT_STATE + 1];
+  /// @brief Records skipped
+  long invalid;
+} Summary_t;
+
+/**
+ * @brief Empty summary initialization
+ * @param[in] *sum Summary
+ */
+static void summary_init(Summary_t *sum) {
+  memset(sum, 0, sizeof(Summary_t));
+  histogram_init(&sum->score, 0, 500);
+  histogram_init(&sum->pieces, 0, 10);
+  histogram_init(&sum->pps, 0, 0.1);
+  histogram_init(&sum->apm, 0, 20);
+  histogram_init(&sum->active, 0, 15);
+  histogram_init(&sum->paused, 0, 5);
+}
+
+/**
+ * @brief Adds one game to a summary
+ * @param[in] *sum Summary
+ * @param[in] *rec Record of the game
+ */
+static void summary_add(Summary_t *sum, const TelemetryRecord_t *rec) {
+  histogram_add(&sum->score, rec->score);
+  histogram_add(&sum->pieces, rec->pieces);
+  histogram_add(&sum->pps, telemetry_pps(rec));
+  histogram_add(&sum->apm, telemetry_apm(rec));
+  histogram_add(&sum->active, telemetry_active_ms(rec) / 1000.0);
+  histogram_add(&sum->paused, rec->state_ms[PAUSE] / 1000.0);
+  for (int i = 0; i < 4; i++) sum->clears[i] += rec->clears[i];
+  for (int i = 0; i <= EXIT_STATE; i++) sum->state_ms[i] += rec->state_ms[i];
+}
+
+/**
+ * @brief Adds one summary to another
+ * @param[in] *into Summary receiving the games
+ * @param[in] *from Summary to add
+ */
+static void summary_merge(Summary_t *into, const Summary_t *from) {
+  histogram_merge(&into->score, &from->score);
+  histogram_merge(&into->pieces, &from->pieces);
+  histogram_merge(&into->pps, &from->pps);
+  histogram_merge(&into->apm, &from->apm);
+  histogram_merge(&into->active, &from->active);
+  histogram_merge(&into->paused, &from->paused);
+  for (int i = 0; i < 4; i++) into->clears[i] += from->clears[i];
+  for (int i = 0; i <= EXIT_STATE; i++) into->state_ms[i] += from->state_ms[i];
+  into->invalid += from->invalid;
+}
+
+/**
+ * @brief Summarizes one stream
+ * @param[in] *path Stream file
+ * @param[out] *sum Summary of the stream
+ * @return Returns 0 on success, 1 if the stream cannot be read
+ */
+static int read_stream(const char *path, Summary_t *sum) {
+  static TelemetryRecord_t block[AGG_BLOCK];
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) return 1;
+  size_t n;
+  while ((n = fread(block, sizeof(TelemetryRecord_t), AGG_BLOCK, fp)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      if (telemetry_valid(&block[i]))
+        summary_add(sum, &block[i]);
+      else
+        sum->invalid++;
+    }
+  }
+  if (ftell(fp) % sizeof(TelemetryRecord_t) != 0) sum->invalid++;
+  fclose(fp);
+  return 0;
+}
+
+/**
+ * @brief Appends synthetic records, for measuring the aggregator
+ * @param[in] *path Stream file
+ * @param[in] count Number of records
+ * @return Returns 0 on success, 1 on a write error
+ */
+static int generate(const char *path, long count) {
+  static TelemetryRecord_t block[AGG_BLOCK];
+  FILE *fp = fopen(path, "ab");
+  if (fp == NULL) return 1;
+  unsigned int seed = 1;
+  GameInfo_t game = {0};
+  while (count > 0) {
+    int n = count < AGG_BLOCK ? count : AGG_BLOCK;
+    for (int i = 0; i < n; i++) {
+      game.counters = (GameCounters_t){0};
+      game.counters.pieces = 20 + rand_r(&seed) % 400;
+      game.counters.actions = game.counters.pieces * (2 + rand_r(&seed) % 6);
+      game.counters.clears[rand_r(&seed) % 4] = game.counters.pieces / 10;
+      game.counters.state_ticks[MOVING] =
+          game.counters.pieces * (30 + rand_r(&seed) % 150);
+      game.counters.state_ticks[PAUSE] = rand_r(&seed) % 3000;
+      game.score = game.counters.pieces * 25;
+      telemetry_record(&game, &block[i]);
+    }
+    if (fwrite(block, sizeof(TelemetryRecord_t), n, fp) != (size_t)n) {
+      fclose(fp);
+      return 1;
+    }
+    count -= n;
+  }
+  return fclose(fp) != 0;
+}
+
+/**
+ * @brief Prints the mean and the percentiles of a histogram
+ * @param[in] *name Name of the value
+ * @param[in] *hist Histogram
+ */
+static void print_summary(const char *name, const Histogram_t *hist) {
+  printf("%-8s mean %8.2f  p50 %8.2f  p90 %8.2f  p99 %8.2f\n", name,
+         hist->count > 0 ? hist->sum / hist->count : 0,
+         histogram_percentile(hist, 50), histogram_percentile(hist, 90),
+         histogram_percentile(hist, 99));
+}
+
+/**
+ * @brief Prints the non-empty bins of a histogram as bars
+ * @param[in] *name Name of the value
+ * @param[in] *hist Histogram
+ */
+static void print_bars(const char *name, const Histogram_t *hist) {
+  long top = 1;
+  for (int i = 0; i < HISTOGRAM_BINS; i++)
+    if (hist->bins[i] > top) top = hist->bins[i];
+  printf("\n%s:\n", name);
+  for (int i = 0; i < HISTOGRAM_BINS; i++) {
+    if (hist->bins[i] == 0) continue;
+    printf("%8.2f %10ld ", hist->min + i * hist->width, hist->bins[i]);
+    for (long k = 0; k < hist->bins[i] * 50 / top; k++) putchar('#');
+    putchar('\n');
+  }
+  if (hist->over > 0) printf("   above %10ld\n", hist->over);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc == 4 && strcmp(argv[1], "-g") == 0)
+    return generate(argv[3], atol(argv[2]));
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s stream...\n       %s -g count stream\n",
+            argv[0], argv[0]);
+    return 1;
+  }
+  static Summary_t total, part;
+  summary_init(&total);
+  long start = get_time_us();
+  for (int i = 1; i < argc; i++) {
+    summary_init(&part);
+    if (read_stream(argv[i], &part) != 0) {
+      fprintf(stderr, "%s: cannot read\n", argv[i]);
+      continue;
+    }
+    summary_merge(&total, &part);
+  }
+  long elapsed = get_time_us() - start;
+  long games = total.score.count;
+  printf("%ld games, %ld skipped records, %.1f M records/s\n", games,
+         total.invalid, elapsed > 0 ? (double)games / elapsed : 0);
+  printf("clears: 1 row %ld, 2 rows %ld, 3 rows %ld, 4 rows %ld\n",
+         total.clears[0], total.clears[1], total.clears[2], total.clears[3]);
+  printf("time: playing %.1f h, paused %.1f h\n\n",
+         (total.state_ms[SPAWN] + total.state_ms[MOVING] +
+          total.state_ms[ATTACHING]) /
+             3.6e6,
+         total.state_ms[PAUSE] / 3.6e6);
+  print_summary("score", &total.score);
+  print_summary("pieces", &total.pieces);
+  print_summary("pps", &total.pps);
+  print_summary("apm", &total.apm);
+  print_summary("active s", &total.active);
+  print_summary("paused s", &total.paused);
+  print_bars("pieces per second", &total.pps);
+  print_bars("actions per minute", &total.apm);
+  return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file tetris_sim.c
+ * @brief tetris-sim: the engine as a filter, commands on stdin, frames on
+ * stdout
+ *
+ * Speaks the protocol of sim.h and links neither ncurses nor the frontend.
+ * Input is read in chunks of SIM_CHUNK bytes; the frames of a whole chunk
+ * go out with one write(), nothing is allocated or flushed per frame.
+ *
+ * Usage: tetris-sim [seed of the first game]
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "../tetris/sim.h"
+
+/// Bytes of input processed at once
+#define SIM_CHUNK 16384
+
+/**
+ * @brief Writes a whole buffer
+ * @param[in] fd Descriptor
+ * @param[in] *buf Buffer
+ * @param[in] len Bytes in buf
+ * @return Returns 0 on success, 1 on an error
+ */
+static int write_all(int fd, const void *buf, size_t len) {
+  const char *p = buf;
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return 1;
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  static uint8_t in[SIM_CHUNK];
+  static SimFrame_t out[SIM_CHUNK];
+  static Sim_t sim;
+  set_score_file(NULL);
+  sim_init(&sim, argc > 1 ? strtoul(argv[1], NULL, 0) : 0);
+  for (;;) {
+    ssize_t n = read(STDIN_FILENO, in, sizeof(in));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return n < 0;
+    for (size_t done = 0, used; done < (size_t)n; done += used) {
+      size_t frames =
+          sim_feed(&sim, in + done, n - done, out, SIM_CHUNK, &used);
+      if (write_all(STDOUT_FILENO, out, frames * sizeof(SimFrame_t)))
+        return 1;
+    }
+  }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file versus_sim.c
+ * @brief Headless bot-vs-bot versus matches on all cores
+ *
+ * Every match is seeded by its number, so a run is reproducible whatever
+ * the number of threads. Both sides play greedy; side A gives a signal
+ * every interval_a ticks and side B every interval_b ticks. Matches last
+ * at most limit_s seconds of game time. Reports the results, the garbage
+ * exchanged and the throughput in matches and ticks per second.
+ *
+ * Usage: versus_sim.out [matches] [threads] [limit_s] [interval_a]
+ * [interval_b]
+ */
+
+#include "../tetris/versus.h"
+
+/**
+ * @brief Run shared by the threads
+ */
+typedef struct {
+  /// @brief Number of matches
+  int matches;
+  /// @brief Ticks a match lasts at most
+  long tick_limit;
+  /// @brief Ticks between two signals of each side
+  int interval[2];
+  /// @brief Number of the next match nobody has taken yet
+  int next;
+  /// @brief Winner of every match
+  int *winner;
+  /// @brief Ticks every match lasted
+  long *ticks;
+  /// @brief Garbage rows every match sent, both sides together
+  int *garbage;
+} Run_t;
+
+/**
+ * @brief Thread playing matches until none are left
+ * @param[in] *arg Run
+ * @return NULL
+ */
+static void *play(void *arg) {
+  Run_t *run = arg;
+  Versus_t match;
+  int m;
+  while ((m = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) <
+         run->matches) {
+    versus_init(&match, m + 1);
+    match.tick_limit = run->tick_limit;
+    for (int i = 0; i < 2; i++) match.sides[i].bot.interval = run->interval[i];
+    while (match.winner == VERSUS_PLAYING) versus_tick(&match);
+    run->winner[m] = match.winner;
+    run->ticks[m] = match.tick;
+    run->garbage[m] = match.sides[0].sent + match.sides[1].sent;
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  Run_t run = {0};
+  run.matches = argc > 1 ? atoi(argv[1]) : 1000;
+  int threads = argc > 2 ? atoi(argv[2]) : 4;
+  run.tick_limit = (argc > 3 ? atol(argv[3]) : 60) * 1000 / TICK_MS;
+  run.interval[0] = argc > 4 ? atoi(argv[4]) : 1;
+  run.interval[1] = argc > 5 ? atoi(argv[5]) : 2;
+  if (run.matches <= 0 || threads <= 0 || run.tick_limit <= 0 ||
+      run.interval[0] <= 0 || run.interval[1] <= 0) {
+    fprintf(stderr,
+            "usage: %s [matches] [threads] [limit_s] [interval_a] "
+            "[interval_b]\n",
+            argv[0]);
+    return 1;
+  }
+  set_score_file(NULL);
+  run.winner = calloc(run.matches, sizeof(int));
+  run.ticks = calloc(run.matches, sizeof(long));
+  run.garbage = calloc(run.matches, sizeof(int));
+  pthread_t *workers = calloc(threads, sizeof(pthread_t));
+  if (!run.winner || !run.ticks || !run.garbage || !workers) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  long start = get_time_us();
+  int started = 0;
+  while (started < threads &&
+         pthread_create(&workers[started], NULL, play, &run) == 0)
+    started++;
+  if (started == 0) play(&run);
+  for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+  double seconds = (get_time_us() - start) / 1e6;
+
+  long results[3] = {0}, ticks = 0, garbage = 0;
+  for (int m = 0; m < run.matches; m++) {
+    results[run.winner[m]]++;
+    ticks += run.ticks[m];
+    garbage += run.garbage[m];
+  }
+  printf("%d matches, %d threads, limit %ld s, intervals %d/%d ticks\n",
+         run.matches, started > 0 ? started : 1,
+         run.tick_limit * TICK_MS / 1000, run.interval[0], run.interval[1]);
+  printf("A wins %ld, B wins %ld, draws %ld\n", results[0], results[1],
+         results[VERSUS_DRAW]);
+  printf("mean match %.1f s of game time, %.1f garbage rows sent\n",
+         (double)ticks * TICK_MS / 1000 / run.matches,
+         (double)garbage / run.matches);
+  printf("%.0f matches/s, %.0f ticks/s\n", run.matches / seconds,
+         ticks / seconds);
+  free(run.winner);
+  free(run.ticks);
+  free(run.garbage);
+  free(workers);
+  return 0;
+}